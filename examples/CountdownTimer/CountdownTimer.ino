@@ -101,6 +101,8 @@ void loop()
 
     debugDrawCrossCenter();
     debugDrawInnerCross();
+
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
 }
 
 
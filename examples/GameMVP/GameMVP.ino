@@ -5,22 +5,26 @@
                 on the clip projected in the Resolume composition, displaying the score count of the game in real time.
  * Author: José Paulo Seibt Neto
  * Created: Mar - 2025
- * Last Modified: Sep - 2025
+ * Last Modified: Oct - 2026
 */
 
 #include <Arduino.h>
 #include <NBAPark.h>
 #include <Ethernet.h>
 #include <EthernetUDP.h>
-#include <string.h>       // strncmp
 
 #define RSTPIN A5 // Pin number used to trigger the board RESET pin
+#define SENSOR_TRACE 0 // 1 = stream the raw IR edges and the patterns to trace_port (replay with extras/host/trace)
 
 // Time
 Timer high_score_timer;  // Instance used to reset the high score of the game or reset the Arduino (sending LOW to RESET pin) based on elapsed time
 Timer game_timer;        // Instance used to setup game logic such as the valid sensors to check at any given time
 uint32_t now;
 
+// Cooperative tasks, run from loop()
+TaskScheduler<1> tasks;
+uint8_t hard_reset_task;
+
 // MVP hoops and sensors
 MVPHoops mvp_hoops;
 BitmapPattern curr_mvp_pattern;
@@ -75,7 +79,7 @@ uint16_t high_score_count;
 uint16_t score_count;
 
 // OSC messages and network configuration
-uint8_t osc_message_buffer[255];
+uint8_t osc_message_buffer[256]; // Received packets, split in two by osc_pump
 EthernetUDP udp;
 const uint8_t board_mac[] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0x05};
 const IPAddress board_ip(172, 30, 6, 199);
@@ -89,10 +93,48 @@ enum ScoreType : uint8_t
     HIGH_SCORE
 };
 
+// Pre-encoded OSC headers (padded address and type tags) stored in flash, only the argument bytes are added on each send
+OSC_HEADER_TEMPLATE(score_header, RESOLUME_SCORE_ADDRESS, ",s");
+OSC_HEADER_TEMPLATE(high_score_header, RESOLUME_HIGH_SCORE_ADDRESS, ",s");
+OSC_HEADER_TEMPLATE(new_high_score_header, RESOLUME_NEW_HIGH_SCORE_ADDRESS, ",");
+
+// Received OSC address -> handler, filled in setup()
+OSCRouter<3> osc_router;
+OSCPump osc_pump(osc_message_buffer, sizeof(osc_message_buffer));
+
+// Latest score, high score and pop-up trigger, sent to Resolume at most once per OSC_OUTBOX_INTERVAL
+OSCOutbox<3> osc_outbox;
+
+// Loop stats published to Bitfocus Companion every PROFILE_PUBLISH_INTERVAL (build with NBAPARK_PROFILE 1)
+PROFILE_STAT(loop_stat, "loop");
+PROFILE_STAT(send_stat, "send");
+#if NBAPARK_PROFILE
+const int companion_in_port = 12321;
+Timer stats_timer;
+uint32_t ball_micros; // Detection timestamp of the oldest ball not reported yet
+bool ball_pending = false;
+#endif
+
+#if SENSOR_TRACE
+const int trace_port = 7002;
+SensorTrace sensor_trace;
+Timer trace_timer;
+BitmapPattern traced_pattern = BitmapPattern::LAYOUT_0; // Pattern of the last TRACE_PATTERN event
+#endif
+
 // Prototypes
-bool send_score_to_resolume(ScoreType in_type, uint16_t in_score);
+bool post_score(ScoreType in_type, uint16_t in_score);
+bool send_outbox();
+void on_game_start(const OSCView&, void*);
+void on_game_wait(const OSCView&, void*);
+void on_hard_reset(const OSCView&, void*);
 void reset_game_state();
 void game_update();
+TaskState hard_reset(Task& in_task);
+#if SENSOR_TRACE
+void trace_pattern();
+void send_trace();
+#endif
 
 void setup()
 {
@@ -108,6 +150,21 @@ void setup()
     Ethernet.begin(board_mac, board_ip);
     udp.begin(resolume_out_port);
 
+    osc_router.add(RESOLUME_MVPGAME_ADDRESS, on_game_start);
+    osc_router.add(RESOLUME_MVPWAIT_ADDRESS, on_game_wait);
+    osc_router.add(MVP_HARD_RESET_OSC, on_hard_reset);
+
+    hard_reset_task = tasks.add(hard_reset, nullptr, false);
+
+    // Latch the beam breaks on interrupts where the pin supports it, polling otherwise
+    for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i)
+    {
+        baskets[i].attach_interrupt();
+#if SENSOR_TRACE
+        baskets[i].set_trace(&sensor_trace, i);
+#endif
+    }
+
     high_score_timer.reset();
     now = game_timer.reset();
 
@@ -118,38 +175,18 @@ void setup()
 
 void loop()
 {
-    // Check for new messages
-    if (udp.parsePacket())
-    {
-        udp.read(osc_message_buffer, sizeof(osc_message_buffer));
-        OSCPark msg(osc_message_buffer);
+    PROFILE_SCOPE(loop_stat);
+    FrameClock::tick(); // Same millis() for every timer and sensor cooldown in this loop() pass
+    tasks.run(FrameClock::now_ms());
 
-        if (strncmp(msg.get_addr_cmp(), RESOLUME_MVPGAME_ADDRESS, OSC_MAX_ADDRESS_LEN) == 0)
-        {
-            if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
-            {
-                reset_game_state();
-                send_score_to_resolume(SCORE, 0);
-                send_score_to_resolume(HIGH_SCORE, high_score_count);
-            }
-        }
-        else if (strncmp(msg.get_addr_cmp(), RESOLUME_MVPWAIT_ADDRESS, OSC_MAX_ADDRESS_LEN) == 0)
-        {
-            debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
-            mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
-        }
-        else if (strncmp(msg.get_addr_cmp(), MVP_HARD_RESET_OSC, OSC_MAX_ADDRESS_LEN) == 0)
-        {   // Hard reset triggered, reseting board (message can be send by Bitfocus Companion)
-            debugSkt("GOT MVP_HARD_RESET_OSC\n"); delay(500);
-            pinMode(RSTPIN, OUTPUT);
-            digitalWrite(RSTPIN, LOW);
-        }
-    }
+    // Handle every message received since the last loop() (within OSC_RECEIVE_BUDGET), only the newest of consecutive
+    // messages to the same address (e.g. the transport position streamed by Resolume) is dispatched
+    osc_pump.poll(udp, osc_router);
 
     if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
     {
         // Check if it is time to reset the current highest score
-        if (high_score_timer.get_elapsed_time() > HIGH_SCORE_RESET_TIME || high_score_count > 100)
+        if (high_score_timer.get_elapsed_time(true, FrameClock::now_ms()) > HIGH_SCORE_RESET_TIME || high_score_count > 100)
         {
             high_score_count = DEFAULT_HIGH_SCORE;
             high_score_timer.reset();
@@ -159,7 +196,7 @@ void loop()
     }
     else
     {   // GAME
-        now = game_timer.get_elapsed_time();
+        now = game_timer.get_elapsed_time(true, FrameClock::now_ms());
         mvp_state = mvp_hoops.update(now);
         curr_mvp_pattern = mvp_hoops.get_curr_pattern();
 
@@ -177,6 +214,28 @@ void loop()
             game_update();
         }
     }
+
+    // Score updates posted in this pass (or suppressed by newer ones since the last flush) go out in one datagram
+    if (osc_outbox.is_due(FrameClock::now_ms()))
+    {
+        send_outbox();
+    }
+
+#if SENSOR_TRACE
+    send_trace();
+#endif
+
+#if NBAPARK_PROFILE
+    if (stats_timer.get_elapsed_time(false, FrameClock::now_ms()) >= PROFILE_PUBLISH_INTERVAL)
+    {
+        stats_timer.reset(FrameClock::now_ms());
+        udp.beginPacket(pc_ip, companion_in_port);
+        Profiler::publish(udp);
+        udp.endPacket();
+    }
+#endif
+
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
 }
 
 // Check sensors and update stat variables
@@ -184,64 +243,83 @@ void game_update()
 {
     debugSkt("[game_update] Current Layout: ");
     debugSktVal(curr_mvp_pattern, BIN);
+#if SENSOR_TRACE
+    trace_pattern(); // Before the sensor reads it applies to
+#endif
 
+    uint8_t shots_converted = 0;
     for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i)
     {
-        if (((curr_mvp_pattern >> i) & 1) && baskets[i].ball_detected())
+        if (((curr_mvp_pattern >> i) & 1) && baskets[i].ball_detected(FrameClock::now_ms()))
+        {
+            ++shots_converted;
+#if NBAPARK_PROFILE
+            if (!ball_pending)
+            {   // The beam break edge in interrupt mode, this loop() pass otherwise
+                ball_micros = baskets[i].is_irq_mode() ? baskets[i].get_detection_micros() : FrameClock::now_us();
+                ball_pending = true;
+            }
+#endif
+        }
+    }
+
+    if (shots_converted > 0)
+    {
+        score_count += shots_converted * 2; // Each shot converted grants 2 points
+        debugSkt("BALL DETECTED! ball count: ");
+        debugSkt(score_count);
+
+        // Posted to the outbox, the score, high score and the new high score pop-up go out together from loop()
+        post_score(SCORE, score_count);
+
+        // Check for new high score
+        if (score_count > high_score_count)
         {
-            score_count += 2; // Each shot converted grants 2 points
-            send_score_to_resolume(SCORE, score_count);
-            debugSkt("BALL DETECTED! ball count: ");
-            debugSkt(score_count);
-
-            // Check for new high score
-            if (score_count > high_score_count)
-            {
-                high_score_count = score_count;
-                send_score_to_resolume(HIGH_SCORE, high_score_count);
-
-                // Check if the new high score clip was already triggered
-                if (!new_high_score)
-                {   // Activate the new high score pop-up clip on Resolume Arena
-                    debugSkt(" | NEW HIGH SCORE!");
-                    snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_NEW_HIGH_SCORE_ADDRESS);
-                    OSCPark msg(reinterpret_cast<char*>(osc_message_buffer));
-                    udp.beginPacket(pc_ip, resolume_in_port);
-                    msg.send(udp);
-                    udp.endPacket();
-                    new_high_score = true;
-                }
+            high_score_count = score_count;
+            post_score(HIGH_SCORE, high_score_count);
+
+            // Check if the new high score clip was already triggered
+            if (!new_high_score)
+            {   // Activate the new high score pop-up clip on Resolume Arena
+                debugSkt(" | NEW HIGH SCORE!");
+                size_t capacity;
+                uint8_t* element = osc_outbox.begin_post(capacity);
+                osc_outbox.end_post(new_high_score_header.write(element, capacity));
+                new_high_score = true;
             }
         }
     }
     debugSktln();
 }
 
-// Send OSC message to change the value in the High Score or Score text block in Resolume Arena
-bool send_score_to_resolume(ScoreType in_type, uint16_t in_score)
+void on_game_start(const OSCView&, void*)
 {
-    debugSkt("[send_score_to_resolume] ");
-    memset(osc_message_buffer, 0, sizeof(osc_message_buffer));
-
-    // Set string value
-    // Construct the OSC address using snprintf to write into the global buffer (based in the ScoreType argument)
-    switch (in_type)
+    if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
     {
-        case SCORE:
-            debugSkt("Sending score: "); debugSkt(in_score); debugSkt(" points\n");
-            snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_SCORE_ADDRESS);
-            break;
-        case HIGH_SCORE:
-            debugSkt("Sending high score: "); debugSkt(in_score); debugSkt(" points\n");
-            snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_HIGH_SCORE_ADDRESS);
-            break;
-        default:
-            debugSkt("Invalid ScoreType argument...\n");
-            return false;
-            break;
+        reset_game_state();
+
+        post_score(SCORE, 0);
+        post_score(HIGH_SCORE, high_score_count);
     }
+}
+
+void on_game_wait(const OSCView&, void*)
+{
+    debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
+    mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
+}
+
+// Hard reset triggered, reseting board (message can be send by Bitfocus Companion)
+void on_hard_reset(const OSCView&, void*)
+{
+    debugSkt("GOT MVP_HARD_RESET_OSC\n");
+    tasks.start(hard_reset_task);
+}
 
-    OSCPark msg(reinterpret_cast<char*>(osc_message_buffer));
+// Post the OSC message that changes the value in the High Score or Score text block in Resolume Arena to osc_outbox
+bool post_score(ScoreType in_type, uint16_t in_score)
+{
+    debugSkt("[post_score] ");
 
     char score_buffer[4]; // Store chars for the numbers of the high score or score
     itoa(in_score, score_buffer, 10);
@@ -262,15 +340,46 @@ bool send_score_to_resolume(ScoreType in_type, uint16_t in_score)
         score_buffer[3] = '\0';
     }
 
-    // Set score buffer as the value for the OSCPark instance
-    msg.set_string(score_buffer);
+    // Encode the message in place: the pre-encoded header of the text block address followed by the score string
+    size_t capacity;
+    uint8_t* element = osc_outbox.begin_post(capacity);
+    size_t len;
+    switch (in_type)
+    {
+        case SCORE:
+            debugSkt("Sending score: "); debugSkt(in_score); debugSkt(" points\n");
+            len = score_header.write_string(element, capacity, score_buffer);
+            break;
+        case HIGH_SCORE:
+            debugSkt("Sending high score: "); debugSkt(in_score); debugSkt(" points\n");
+            len = high_score_header.write_string(element, capacity, score_buffer);
+            break;
+        default:
+            debugSkt("Invalid ScoreType argument...\n");
+            return false;
+            break;
+    }
+    return osc_outbox.end_post(len);
+}
+
+// Send the pending messages of osc_outbox through EthernetUDP global instance
+bool send_outbox()
+{
+    if (!osc_outbox.get_pending()) return false;
 
-    // Send message through EthernetUDP global instance
+    PROFILE_SCOPE(send_stat);
     udp.beginPacket(pc_ip, resolume_in_port);
-    msg.send(udp);
-    udp.endPacket();
+    osc_outbox.flush(udp, FrameClock::now_ms());
+    bool sent = udp.endPacket();
 
-    return true;
+#if NBAPARK_PROFILE
+    if (ball_pending)
+    {
+        PROFILE_RECORD(Profiler::ball_latency, micros() - ball_micros);
+        ball_pending = false;
+    }
+#endif
+    return sent;
 }
 
 // Reset global instances used in the game logic, like layouts, sensors, and some counters
@@ -282,3 +391,39 @@ void reset_game_state()
     new_high_score = false;
     score_count = 0;
 }
+
+// Pull the RESET pin LOW after a short delay, letting pending serial/UDP output go out first
+TaskState hard_reset(Task& in_task)
+{
+    TASK_BEGIN(in_task);
+    TASK_SLEEP(in_task, 500);
+    pinMode(RSTPIN, OUTPUT);
+    digitalWrite(RSTPIN, LOW);
+    TASK_END(in_task);
+}
+
+#if SENSOR_TRACE
+// Record the pattern changes, LAYOUT_0 while no game is running
+void trace_pattern()
+{
+    BitmapPattern pattern = (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER) ? BitmapPattern::LAYOUT_0 : curr_mvp_pattern;
+    if (pattern != traced_pattern)
+    {
+        traced_pattern = pattern;
+        sensor_trace.record(TRACE_PATTERN, 0, pattern, FrameClock::now_us());
+    }
+}
+
+// Send the trace every 100 ms or when half full
+void send_trace()
+{
+    trace_pattern();
+    if (sensor_trace.get_pending() < TRACE_QUEUE_SIZE / 2 && trace_timer.get_elapsed_time(false, FrameClock::now_ms()) < 100) return;
+
+    trace_timer.reset(FrameClock::now_ms());
+    if (!sensor_trace.get_pending()) return;
+    udp.beginPacket(pc_ip, trace_port);
+    sensor_trace.send(udp);
+    udp.endPacket();
+}
+#endif
@@ -10,7 +10,7 @@
                 the winners and menu screens. (Work in Progress)
  * Author: José Paulo Seibt Neto
  * Created: May - 2025
- * Last Modified: Jul - 2025
+ * Last Modified: Oct - 2026
 */
 
 #define DEBUG_DISPLAY 0 // 0 = None, 2 = active
@@ -68,12 +68,34 @@ uint8_t last_ss;
 Button button(BUTTON);
 int16_t buzzer_feedback;
 
+// IR sensors, in interrupt mode when the pin supports it so short beam breaks are not lost between display draws
+IRBasketSensor ir_0(IR_0); // EST side
+IRBasketSensor ir_1(IR_1); // WST side
+
+// Scorer highlight, runs as a task so the button and buzzer keep being serviced while the frames blink
+struct HighlightFrame
+{
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    uint32_t timeout;
+    uint32_t end_time;
+    uint8_t bg_r, bg_g, bg_b; // Background color of the scorer conference
+    uint8_t r, g, b;          // Current frame color
+};
+
+HighlightFrame highlight;
+TaskScheduler<1> tasks;
+uint8_t highlight_task;
+
 // Prototypes
 void menu_screen();
 void game_reset();
 void game_over();
 void winner_screen(uint8_t in_conf);
-void highlight_frame(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint32_t in_timeout, uint8_t in_bgR, uint8_t in_bgG, uint8_t in_bgB);
+void start_highlight_frame(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint32_t in_timeout, uint8_t in_bgR, uint8_t in_bgG, uint8_t in_bgB);
+TaskState highlight_frame(Task& in_task);
 void timer_setup();
 void draw_static_elements();
 void draw_clock_dynamic();
@@ -87,8 +109,6 @@ void setup()
     Serial.begin(115200);
 
     pinMode(BUZZER, OUTPUT);
-    pinMode(IR_0, INPUT);    // EST side
-    pinMode(IR_1, INPUT);    // WST side 
     pinMode(RELAY_LED_0, OUTPUT); // EST side
     pinMode(RELAY_LED_1, OUTPUT); // WST side
 
@@ -129,6 +149,11 @@ void setup()
     // Set the default font for the project
     ucg.setFont(ucg_font_logisoso42_tr);
 
+    highlight_task = tasks.add(highlight_frame, nullptr, false);
+
+    ir_0.attach_interrupt();
+    ir_1.attach_interrupt();
+
     menu_screen();
     c.run();
 }
@@ -137,6 +162,7 @@ void loop()
 {
     now = c.update();
     button.update();
+    tasks.run(millis());
 
     // Check buzzer feedback sound logic
     buzzer_feedback = (button.curr_press_dur < R_BATTLE_HARD_RESET_TRIGGER)
@@ -171,30 +197,34 @@ void loop()
     debugSkt("button press duration= "); debugSkt(button.curr_press_dur); debugSktln();
     debugSkt("relese_time= "); debugSkt(button.release_time); debugSktln();
 
-    if (c.is_running())
+    if (tasks.is_running(highlight_task))
+    {   // Clock stopped while the scorer is highlighted, resumed by the task when it ends
+        // Balls passing through during the highlight don't count
+        ir_0.reset();
+        ir_1.reset();
+    }
+    else if (c.is_running())
     {
         draw_clock_dynamic();
         
         // Check IR sensors for points
-        if (digitalRead(IR_0) == LOW)
+        if (ir_0.ball_detected())
         {   // WST scored
             c.stop();
             button.reset();
 
             ++wst_score;
             draw_score_dynamic();
-            highlight_frame(ElementCoordinate::WST_X - 43, ElementCoordinate::CONF_Y - 5, 90, 55, R_BATTLE_SCORER_TIMEOUT, 255, 0, 0); // WST scored
-            c.run();
+            start_highlight_frame(ElementCoordinate::WST_X - 43, ElementCoordinate::CONF_Y - 5, 90, 55, R_BATTLE_SCORER_TIMEOUT, 255, 0, 0); // WST scored
         }
-        else if (digitalRead(IR_1) == LOW)
+        else if (ir_1.ball_detected())
         {   // EST scored
             c.stop();
             button.reset();
 
             ++est_score;
             draw_score_dynamic();
-            highlight_frame(ElementCoordinate::EST_X / 2 - 15, ElementCoordinate::CONF_Y - 5, 90, 55, R_BATTLE_SCORER_TIMEOUT, 0, 0, 222); // EST scored
-            c.run();
+            start_highlight_frame(ElementCoordinate::EST_X / 2 - 15, ElementCoordinate::CONF_Y - 5, 90, 55, R_BATTLE_SCORER_TIMEOUT, 0, 0, 222); // EST scored
         }
     }
     else
@@ -207,12 +237,16 @@ void loop()
 
     debugDrawCrossCenter();
     debugDrawInnerCross();
+
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
 }
 
 
 /*-------------------FUNCTION DEFINITIONS----------------------*/
 void menu_screen()
 {
+    tasks.stop(highlight_task); // Drop a highlight still running from the previous game
+
     ucg.setFont(ucg_font_logisoso42_tr); // Make sure default font is set
 
     int16_t str_width;
@@ -340,6 +374,10 @@ void game_reset()
     draw_clock_dynamic();
     draw_score_dynamic();
 
+    // Drop detections from before the game start
+    ir_0.reset();
+    ir_1.reset();
+
     c.run();
 }
 
@@ -378,42 +416,65 @@ void game_over()
 }
 
 /* Draw three square frames (coordinates and dimension passed as arguments) that switch colors for the duration of the received in_timeout (milliseconds).
-   The function stays on a loop for all timeout duration, "highlighting" the area; then "erases" the lines by drawing three square frames with
-   the in_bgR, in_bgG, in_bgB color combination in the same location of the previous frame drawings. Those arguments should match the background color. */
-void highlight_frame(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint32_t in_timeout, uint8_t in_bgR, uint8_t in_bgG, uint8_t in_bgB)
+   The highlight runs as a task, blinking the area every 50 ms without blocking loop(); then "erases" the lines by drawing three square frames with
+   the in_bgR, in_bgG, in_bgB color combination in the same location of the previous frame drawings. Those arguments should match the background color.
+   The game clock is resumed when the highlight ends. */
+void start_highlight_frame(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint32_t in_timeout, uint8_t in_bgR, uint8_t in_bgG, uint8_t in_bgB)
 {
+    highlight.x = in_x;
+    highlight.y = in_y;
+    highlight.width = in_width;
+    highlight.height = in_height;
+    highlight.timeout = in_timeout;
+    highlight.bg_r = in_bgR;
+    highlight.bg_g = in_bgG;
+    highlight.bg_b = in_bgB;
+
+    tasks.start(highlight_task);
+}
+
+TaskState highlight_frame(Task& in_task)
+{
+    TASK_BEGIN(in_task);
+
     // Set variables to change the colors of the frames in rapid succession
-    uint8_t r = 255;
-    uint8_t g = 255;
-    uint8_t b = 255;
+    highlight.r = 255;
+    highlight.g = 255;
+    highlight.b = 255;
+    highlight.end_time = in_task.now + highlight.timeout;
 
-    Timer scorer_timer;
     do
     {
         // Draw outter frame
-        ucg.setColor(0, r, g, b);
-        ucg.drawFrame(in_x, in_y, in_width, in_height);
-        ucg.drawFrame(in_x + 2, in_y + 2, in_width - 4, in_height - 4); 
+        ucg.setColor(0, highlight.r, highlight.g, highlight.b);
+        ucg.drawFrame(highlight.x, highlight.y, highlight.width, highlight.height);
+        ucg.drawFrame(highlight.x + 2, highlight.y + 2, highlight.width - 4, highlight.height - 4);
 
-        r = (r != 255) ? 255 : 235;
-        g = (g != 255) ? 255 : 20;
-        b = (b != 255) ? 255 : 235;
+        highlight.r = (highlight.r != 255) ? 255 : 235;
+        highlight.g = (highlight.g != 255) ? 255 : 20;
+        highlight.b = (highlight.b != 255) ? 255 : 235;
 
         // Draw inner frame
-        ucg.setColor(0, r, g, b);
-        ucg.drawFrame(in_x + 1, in_y + 1, in_width - 2, in_height - 2); 
-        delay(50);
+        ucg.setColor(0, highlight.r, highlight.g, highlight.b);
+        ucg.drawFrame(highlight.x + 1, highlight.y + 1, highlight.width - 2, highlight.height - 2);
+
+        // Reset to standard color, other elements may be drawn before the next frame
+        ucg.setColor(0, 255, 255, 255);
+        TASK_SLEEP(in_task, 50);
     }
-    while (scorer_timer.get_elapsed_time(false) < in_timeout);
+    while (static_cast<int32_t>(in_task.now - highlight.end_time) < 0);
 
     // Clear the frame with the background color of the scorer conference
-    ucg.setColor(0, in_bgR, in_bgG, in_bgB);
-    ucg.drawFrame(in_x, in_y, in_width, in_height);
-    ucg.drawFrame(in_x + 2, in_y + 2, in_width - 4, in_height - 4);
-    ucg.drawFrame(in_x + 1, in_y + 1, in_width - 2, in_height - 2);
+    ucg.setColor(0, highlight.bg_r, highlight.bg_g, highlight.bg_b);
+    ucg.drawFrame(highlight.x, highlight.y, highlight.width, highlight.height);
+    ucg.drawFrame(highlight.x + 2, highlight.y + 2, highlight.width - 4, highlight.height - 4);
+    ucg.drawFrame(highlight.x + 1, highlight.y + 1, highlight.width - 2, highlight.height - 2);
 
     // Reset to standard color
     ucg.setColor(0, 255, 255, 255);
+
+    c.run();
+    TASK_END(in_task);
 }
 
 // Configuration screen to setup the game match duration
@@ -3,11 +3,13 @@
  * Description: Example program to test BasketSensor, Layout, and MVPHoops objects working to demonstrate dynamic sensor check
  * Author: José Paulo Seibt Neto
  * Created: Fev - 2025
- * Last Modified: May - 2025
+ * Last Modified: Oct - 2026
 */
 
 #include <NBAPark.h>
 
+// Original wiring. Only pin 3 has an external interrupt (INT1 on the Uno, INT5 on the Mega), see setup() for the others.
+// On a Mega, moving the echoes to {3, 18, 19} puts all three hoops in interrupt mode
 int trig_pins[] = {2, 4, 6};
 int echo_pins[] = {3, 5, 7};
 
@@ -48,6 +50,14 @@ void setup()
 
     test_mvp.reset();
 
+    // Non-blocking measurements timestamped by the echo interrupt, so one hoop no longer stalls the others while waiting
+    // for its echo. The hoops whose echo pin has no interrupt keep the blocking reads, as this loop is too slow
+    // (delay() and prints) to sample the echo
+    for (int i = 0; i < NUM_MVP_HOOPS; ++i)
+    {
+        hoops[i].set_async(hoops[i].attach_interrupt());
+    }
+
     ball_count = 0;
 }
 
@@ -77,5 +87,6 @@ void loop()
     }
 
     debugSktVal(curr_mvp_pattern, BIN); debugSktln();
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
     delay(10);
 }
\ No newline at end of file
@@ -59,6 +59,8 @@ void loop()
         delay(20);
     }
 
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
+
     delay(100);
 }
 
@@ -46,8 +46,8 @@ void loop()
     }
     else
     {
-        udp.read(osc_msg_buffer, sizeof(osc_msg_buffer));
-        osc_msg.init(osc_msg_buffer);
+        int len = udp.read(osc_msg_buffer, sizeof(osc_msg_buffer));
+        if (len > 0) osc_msg.init(osc_msg_buffer, len);
         osc_msg.print();
         osc_msg.info();
         osc_msg.clear();
@@ -1,6 +1,6 @@
 /*
  * NBA Park Arduino Library
- * Description: Example program that reads messages send by Serial (e.g. Serial Monitor) to read values from a ThreeBasketSensors obj
+ * Description: Example program that reads OSC messages send by Serial (SLIP framed, OSC 1.1) to read values from a ThreeBasketSensors obj
                 working in conjunction with a MVPHoops instance to count basketballs that go through the rim at specific times, displaying
                 the score count of the game and other information through the Arduino Serial Monitor (primarily used for debugging).
  * Author: José Paulo Seibt Neto
@@ -9,7 +9,6 @@
 */
 
 #include <NBAPark.h>
-#include <string.h>       // strcmp
 
 #define RSTPIN 12 // Pin number used to trigger the board RESET pin
 
@@ -71,13 +70,17 @@ ThreeBasketSensors tbs(trig_pins, echo_pins);
 uint16_t high_score_count;
 uint16_t score_count;
 
-const int BUFFER_SIZE = 64;
-char buffer[BUFFER_SIZE];
-uint8_t buffer_pos;
-bool new_message;
+// OSC over Serial, packets are SLIP framed (e.g. by a Companion/Resolume serial bridge)
+uint8_t osc_message_buffer[64];
+SLIPDecoder slip_in(osc_message_buffer, sizeof(osc_message_buffer));
+SLIPEncoder slip_out(Serial);
+OSCRouter<2> osc_router;
 
 // Prototypes
-void read_to_buffer();
+void handle_osc_message(const uint8_t* in_msg, size_t in_len);
+void on_game_start(const OSCView& in_msg, void* in_ctx);
+void on_game_wait(const OSCView& in_msg, void* in_ctx);
+void send_score();
 void reset_game_state();
 void game_update();
 
@@ -98,29 +101,16 @@ void setup()
     high_score_count = DEFAULT_HIGH_SCORE;
     score_count = 0;
 
-    buffer[0] = '\0';
-    buffer_pos = 0;
-    new_message = false;
+    osc_router.add(RESOLUME_MVPGAME_ADDRESS, on_game_start);
+    osc_router.add(RESOLUME_MVPWAIT_ADDRESS, on_game_wait);
 }
 
 void loop()
 {
-    // Check for new messages
-    if (Serial.available() > 1)
+    // Check for new messages, only the bytes already received are consumed (never blocks for the rest of a packet)
+    while (slip_in.read(Serial))
     {
-        while (!new_message) read_to_buffer();
-
-        if (strncmp(buffer, RESOLUME_MVPGAME_ADDRESS, BUFFER_SIZE) == 0)
-        {
-            debugSkt("GOT RESOLUME_MVPGAME_ADDRESS\n");
-            reset_game_state();
-        }
-        else if (strncmp(buffer, RESOLUME_MVPWAIT_ADDRESS, BUFFER_SIZE) == 0)
-        {
-            debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
-            mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
-        }
-        new_message = false;
+        handle_osc_message(slip_in.get_frame(), slip_in.get_frame_len());
     }
 
     if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
@@ -185,32 +175,45 @@ void game_update()
 
         debugSkt(" | high score: ");
         debugSkt(high_score_count); debugSktln();
+        send_score();
         delay(1000);
     }
 }
 
-void read_to_buffer()
+// Act on a received OSC packet, read in place from the SLIP buffer
+void handle_osc_message(const uint8_t* in_msg, size_t in_len)
 {
-    debugSkt("READING MESSAGE...\n");
-    delay(1000);
-    while (Serial.available() > 0)
+    OSCView msg(in_msg, in_len);
+    if (!msg.is_valid())
     {
-        char msg_byte = Serial.read();
-
-        if (msg_byte != '\0' && msg_byte != '\n' && msg_byte != '\r' && buffer_pos < BUFFER_SIZE - 1)
-        {   // Append msg_byte to the buffer and increment buffer_pos
-            buffer[buffer_pos++] = msg_byte;
-        }
-        else
-        {   // End of the message or max length reached
-            buffer[buffer_pos] = '\0';
-            buffer_pos = 0;
-            debugSkt("New message buffered... | buffer: ");
-            debugSkt(buffer); debugSktln();
-            delay(2000);
-            new_message = true;
-        }
+        debugSkt("[handle_osc_message] Malformed message dropped\n");
+        return;
     }
+    osc_router.dispatch(msg);
+}
+
+void on_game_start(const OSCView& in_msg, void* in_ctx)
+{
+    debugSkt("GOT RESOLUME_MVPGAME_ADDRESS\n");
+    reset_game_state();
+    send_score();
+}
+
+void on_game_wait(const OSCView& in_msg, void* in_ctx)
+{
+    debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
+    mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
+}
+
+// Send the score to the Resolume Arena text block as a SLIP frame
+void send_score()
+{
+    char score_buffer[6];
+    itoa(score_count, score_buffer, 10);
+
+    OSCPark msg(RESOLUME_SCORE_ADDRESS);
+    msg.set_string(score_buffer);
+    slip_out.send(msg);
 }
 
 // Reset global instances used in the game logic, like layouts, sensors, and some counters
@@ -5,13 +5,12 @@
                 on the clip projected in the Resolume composition, displaying the score count of the game in real time.
  * Author: José Paulo Seibt Neto
  * Created: Apr - 2025
- * Last Modified: Aug - 2025
+ * Last Modified: Oct - 2026
 */
 
 #include <NBAPark.h>
 #include <Ethernet.h>
 #include <EthernetUDP.h>
-#include <string.h>       // strncmp
 
 #define RSTPIN A0 // Pin number used to trigger the board RESET pin
 
@@ -25,8 +24,10 @@ MVPHoops mvp_hoops;
 BitmapPattern curr_mvp_pattern;
 MVPHoops::MVPState mvp_state;
 
+// Echo pins with an external interrupt on the Mega (INT5, INT3, INT2) for the trigger()/poll() sweeps, on the Uno
+// only pin 3 has one and the sketch falls back to check_sensors()
 const uint8_t trig_pins[] = {2, 4, 6};
-const uint8_t echo_pins[] = {3, 5, 7};
+const uint8_t echo_pins[] = {3, 18, 19};
 
 ThreeBasketSensors tbs(trig_pins, echo_pins);
 
@@ -70,7 +71,7 @@ uint16_t high_score_count;
 uint16_t score_count;
 
 // OSC messages and network configuration
-uint8_t osc_message_buffer[255];
+uint8_t osc_message_buffer[256]; // Received packets, split in two by osc_pump
 EthernetUDP udp;
 const uint8_t board_mac[] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0x05};
 const IPAddress board_ip(172, 30, 6, 199);
@@ -84,8 +85,24 @@ enum ScoreType : uint8_t
     HIGH_SCORE
 };
 
+// Pre-encoded OSC headers (padded address and type tags) stored in flash, only the argument bytes are added on each send
+OSC_HEADER_TEMPLATE(score_header, RESOLUME_SCORE_ADDRESS, ",s");
+OSC_HEADER_TEMPLATE(high_score_header, RESOLUME_HIGH_SCORE_ADDRESS, ",s");
+OSC_HEADER_TEMPLATE(new_high_score_header, RESOLUME_NEW_HIGH_SCORE_ADDRESS, ",");
+
+// Received OSC address -> handler, filled in setup()
+OSCRouter<3> osc_router;
+OSCPump osc_pump(osc_message_buffer, sizeof(osc_message_buffer));
+
+// Latest score, high score and pop-up trigger, sent to Resolume at most once per OSC_OUTBOX_INTERVAL
+OSCOutbox<3> osc_outbox;
+
 // Prototypes
-bool send_score_to_resolume(ScoreType in_type, uint16_t in_score);
+bool post_score(ScoreType in_type, uint16_t in_score);
+bool send_outbox();
+void on_game_start(const OSCView& in_msg, void* in_ctx);
+void on_game_wait(const OSCView& in_msg, void* in_ctx);
+void on_hard_reset(const OSCView& in_msg, void* in_ctx);
 void reset_game_state();
 void game_update();
 
@@ -103,6 +120,20 @@ void setup()
     Ethernet.begin(board_mac, board_ip);
     udp.begin(resolume_out_port);
 
+    osc_router.add(RESOLUME_MVPGAME_ADDRESS, on_game_start);
+    osc_router.add(RESOLUME_MVPWAIT_ADDRESS, on_game_wait);
+    osc_router.add(MVP_HARD_RESET_OSC, on_hard_reset);
+
+    // Use the non-blocking trigger()/poll() sweeps when all echo pins support interrupts (Mega), check_sensors() otherwise
+    if (tbs.attach_interrupts())
+    {
+        debugSkt("[GameMVP.ino] Echo pins in interrupt mode\n");
+    }
+    else
+    {
+        debugSkt("[GameMVP.ino] Echo pins without interrupts, polling the sensors\n");
+    }
+
     high_score_timer.reset();
     now = game_timer.reset();
 
@@ -113,33 +144,9 @@ void setup()
 
 void loop()
 {
-    // Check for new messages
-    if (udp.parsePacket())
-    {
-        udp.read(osc_message_buffer, sizeof(osc_message_buffer));
-        OSCPark msg(osc_message_buffer);
-
-        if (strncmp(msg.get_addr_cmp(), RESOLUME_MVPGAME_ADDRESS, OSC_MAX_ADDRESS_LEN) == 0)
-        {
-            if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
-            {   
-                reset_game_state();
-                send_score_to_resolume(SCORE, 0);
-                send_score_to_resolume(HIGH_SCORE, high_score_count);
-            }
-        }
-        else if (strncmp(msg.get_addr_cmp(), RESOLUME_MVPWAIT_ADDRESS, OSC_MAX_ADDRESS_LEN) == 0)
-        {
-            debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
-            mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
-        }
-        else if (strncmp(msg.get_addr_cmp(), MVP_HARD_RESET_OSC, OSC_MAX_ADDRESS_LEN) == 0)
-        {   // Hard reset triggered, reseting board (message can be send by Bitfocus Companion)
-            debugSkt("GOT MVP_HARD_RESET_OSC\n"); delay(500);
-            pinMode(RSTPIN, OUTPUT);
-            digitalWrite(RSTPIN, LOW);
-        }
-    }
+    // Handle every message received since the last loop() (within OSC_RECEIVE_BUDGET), only the newest of consecutive
+    // messages to the same address (e.g. the transport position streamed by Resolume) is dispatched
+    osc_pump.poll(udp, osc_router);
 
     if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
     {
@@ -172,6 +179,14 @@ void loop()
             game_update();
         }
     }
+
+    // Score updates posted in this pass (or suppressed by newer ones since the last flush) go out in one datagram
+    if (osc_outbox.is_due(millis()))
+    {
+        send_outbox();
+    }
+
+    debugLibDrain(); // Send the deferred library debug records while the loop is idle
 }
 
 // Check sensors and update stat variables
@@ -180,33 +195,42 @@ void game_update()
     debugSkt("[game_update] Current Layout: ");
     debugSktVal(curr_mvp_pattern, BIN);
 
-    // Add a delay before checking the sensors to prevent interferences from previous readings (ultrasonic sensors are finicky)
-    delayMicroseconds(BALL_DETECTION_READ_DELAY);
-    BitmapPattern checks = tbs.check_sensors();
+    BitmapPattern checks;
+    if (tbs.is_irq_mode())
+    {   // Start a sweep if none is in flight and come back on the next loop() until the echoes are in
+        if (!tbs.is_sweep_active()) tbs.trigger();
+        if (!tbs.poll(checks)) return;
+    }
+    else
+    {
+        // Add a delay before checking the sensors to prevent interferences from previous readings (ultrasonic sensors are finicky)
+        delayMicroseconds(BALL_DETECTION_READ_DELAY);
+        checks = tbs.check_sensors();
+    }
     uint8_t shots_converted = tbs.filter_sensor_readings(curr_mvp_pattern, checks);
 
     if (shots_converted > 0)
     {
         score_count += shots_converted * 2; // Each shot converted grants 2 points
-        send_score_to_resolume(SCORE, score_count);
         debugSkt("BALL DETECTED! ball count: ");
         debugSkt(score_count);
 
+        // Posted to the outbox, the score, high score and the new high score pop-up go out together from loop()
+        post_score(SCORE, score_count);
+
         // Check for new high score
         if (score_count > high_score_count)
         {
             high_score_count = score_count;
-            send_score_to_resolume(HIGH_SCORE, high_score_count);
+            post_score(HIGH_SCORE, high_score_count);
 
             // Check if the new high score clip was already triggered
             if (!new_high_score)
             {   // Activate the new high score pop-up clip on Resolume Arena
                 debugSkt(" | NEW HIGH SCORE!");
-                snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_NEW_HIGH_SCORE_ADDRESS);
-                OSCPark msg(reinterpret_cast<char*>(osc_message_buffer));
-                udp.beginPacket(pc_ip, resolume_in_port);
-                msg.send(udp);
-                udp.endPacket();
+                size_t capacity;
+                uint8_t* element = osc_outbox.begin_post(capacity);
+                osc_outbox.end_post(new_high_score_header.write(element, capacity));
                 new_high_score = true;
             }
         }
@@ -214,31 +238,35 @@ void game_update()
     debugSktln();
 }
 
-// Send OSC message to change the value in the High Score or Score text block in Resolume Arena
-bool send_score_to_resolume(ScoreType in_type, uint16_t in_score)
+void on_game_start(const OSCView& in_msg, void* in_ctx)
 {
-    debugSkt("[send_score_to_resolume] ");
-    memset(osc_message_buffer, 0, sizeof(osc_message_buffer));
-
-    // Set string value
-    // Construct the OSC address using snprintf to write into the global buffer (based in the ScoreType argument)
-    switch (in_type)
+    if (mvp_state == MVPHoops::MVPState::MVP_GAME_OVER)
     {
-        case SCORE:
-            debugSkt("Sending score: "); debugSkt(in_score); debugSkt(" points\n");
-            snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_SCORE_ADDRESS);
-            break;
-        case HIGH_SCORE:
-            debugSkt("Sending high score: "); debugSkt(in_score); debugSkt(" points\n");
-            snprintf(reinterpret_cast<char*>(osc_message_buffer), sizeof(osc_message_buffer), RESOLUME_HIGH_SCORE_ADDRESS);
-            break;
-        default:
-            debugSkt("Invalid ScoreType argument...\n");
-            return false;
-            break;
+        reset_game_state();
+
+        post_score(SCORE, 0);
+        post_score(HIGH_SCORE, high_score_count);
     }
+}
 
-    OSCPark msg(reinterpret_cast<char*>(osc_message_buffer));
+void on_game_wait(const OSCView& in_msg, void* in_ctx)
+{
+    debugSkt("GOT RESOLUME_MVPWAIT_ADDRESS\n");
+    mvp_state = MVPHoops::MVPState::MVP_GAME_OVER;
+}
+
+// Hard reset triggered, reseting board (message can be send by Bitfocus Companion)
+void on_hard_reset(const OSCView& in_msg, void* in_ctx)
+{
+    debugSkt("GOT MVP_HARD_RESET_OSC\n"); delay(500);
+    pinMode(RSTPIN, OUTPUT);
+    digitalWrite(RSTPIN, LOW);
+}
+
+// Post the OSC message that changes the value in the High Score or Score text block in Resolume Arena to osc_outbox
+bool post_score(ScoreType in_type, uint16_t in_score)
+{
+    debugSkt("[post_score] ");
 
     char score_buffer[4]; // Store chars for the numbers of the high score or score
     itoa(in_score, score_buffer, 10);
@@ -259,15 +287,36 @@ bool send_score_to_resolume(ScoreType in_type, uint16_t in_score)
         score_buffer[3] = '\0';
     }
 
-    // Set score buffer as the value for the OSCPark instance
-    msg.set_string(score_buffer);
+    // Encode the message in place: the pre-encoded header of the text block address followed by the score string
+    size_t capacity;
+    uint8_t* element = osc_outbox.begin_post(capacity);
+    size_t len;
+    switch (in_type)
+    {
+        case SCORE:
+            debugSkt("Sending score: "); debugSkt(in_score); debugSkt(" points\n");
+            len = score_header.write_string(element, capacity, score_buffer);
+            break;
+        case HIGH_SCORE:
+            debugSkt("Sending high score: "); debugSkt(in_score); debugSkt(" points\n");
+            len = high_score_header.write_string(element, capacity, score_buffer);
+            break;
+        default:
+            debugSkt("Invalid ScoreType argument...\n");
+            return false;
+            break;
+    }
+    return osc_outbox.end_post(len);
+}
 
-    // Send message through EthernetUDP global instance
-    udp.beginPacket(pc_ip, resolume_in_port);
-    msg.send(udp);
-    udp.endPacket();
+// Send the pending messages of osc_outbox through EthernetUDP global instance
+bool send_outbox()
+{
+    if (!osc_outbox.get_pending()) return false;
 
-    return true;
+    udp.beginPacket(pc_ip, resolume_in_port);
+    osc_outbox.flush(udp, millis());
+    return udp.endPacket();
 }
 
 // Reset global instances used in the game logic, like layouts, sensors, and some counters
@@ -0,0 +1,72 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Example program that replaces hand-polled deadlines with a TimerWheel: a periodic status blink,
+                a one-shot buzzer feedback window started by an IR basket detection, and a daily high score reset.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <NBAPark.h>
+
+#define BUZZER 2
+#define IR_OUT 3
+#define STATUS_LED LED_BUILTIN
+
+// Up to 8 timers, 16 slots of 10 milliseconds
+TimerWheel<8> wheel;
+uint16_t buzzer_timer_id = TimerWheel<8>::INVALID_ID;
+
+IRBasketSensor basket(IR_OUT);
+uint16_t high_score;
+uint16_t score;
+
+void blink_status(void*)
+{
+    digitalWrite(STATUS_LED, !digitalRead(STATUS_LED));
+}
+
+void stop_buzzer(void*)
+{
+    digitalWrite(BUZZER, LOW);
+    buzzer_timer_id = TimerWheel<8>::INVALID_ID;
+}
+
+void reset_high_score(void*)
+{
+    high_score = DEFAULT_HIGH_SCORE;
+    debugSkt("HIGH SCORE RESET...\n");
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    pinMode(BUZZER, OUTPUT);
+    pinMode(STATUS_LED, OUTPUT);
+
+    high_score = DEFAULT_HIGH_SCORE;
+    score = 0;
+
+    uint32_t now = millis();
+    wheel.schedule(now, 500, blink_status, nullptr, 500);
+    wheel.schedule(now, HIGH_SCORE_RESET_TIME * 1000UL, reset_high_score, nullptr, HIGH_SCORE_RESET_TIME * 1000UL);
+}
+
+void loop()
+{
+    FrameClock::tick();
+    wheel.tick(FrameClock::now_ms());
+
+    if (basket.ball_detected(FrameClock::now_ms()))
+    {
+        score += 2;
+        if (score > high_score) high_score = score;
+        debugSkt("BALL DETECTED! score: "); debugSkt(score); debugSktln();
+
+        // Restart the buzzer feedback window
+        wheel.cancel(buzzer_timer_id);
+        digitalWrite(BUZZER, HIGH);
+        buzzer_timer_id = wheel.schedule(FrameClock::now_ms(), R_BATTLE_BUZZER_FEEDBACK_DUR, stop_buzzer);
+    }
+}
@@ -0,0 +1,164 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host (Linux) stand-in for the Arduino core API used by the library, so src/NBAPark.cpp builds and runs
+                off-board. Time comes from a virtual clock and the pins from scripted waveforms, both driven through
+                HostHAL.h. Only the subset of the AVR core the library needs is provided.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#ifndef NBAPARK_HOST_ARDUINO_H
+#define NBAPARK_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>  // Included by the core Print.h, the library relies on it for snprintf()
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Pins and interrupts
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+#define HOST_NUM_PINS 64U
+
+// Number bases used by Print
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<const void* const*>(addr))
+
+class __FlashStringHelper;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Time (virtual clock, see HostHAL.h)
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long in_ms);
+void delayMicroseconds(unsigned int in_us);
+void yield();
+
+// Digital I/O (scripted levels, see HostHAL.h)
+void pinMode(uint8_t in_pin, uint8_t in_mode);
+void digitalWrite(uint8_t in_pin, uint8_t in_level);
+int digitalRead(uint8_t in_pin);
+unsigned long pulseIn(uint8_t in_pin, uint8_t in_state, unsigned long in_timeout = 1000000UL);
+
+// Input registers of the ATmega328P ports (Uno/Nano pinout: pins 0-7 on PD, 8-13 on PB, 14-19 on PC), read from the
+// scripted pin levels, so the library's direct port I/O paths build and run on the host too
+#define NBAPARK_HOST_PORTS 1
+#define PB 2
+#define PC 3
+#define PD 4
+uint8_t host_port_read(uint8_t in_port);
+#define PINB host_port_read(PB)
+#define PINC host_port_read(PC)
+#define PIND host_port_read(PD)
+
+// External interrupts, every pin is interrupt capable unless host::set_interrupt_capable() says otherwise
+int host_pin_to_interrupt(uint8_t in_pin);
+#define digitalPinToInterrupt(p) host_pin_to_interrupt(p)
+void attachInterrupt(uint8_t in_interrupt, void (*in_isr)(), int in_mode);
+void detachInterrupt(uint8_t in_interrupt);
+void noInterrupts();
+void interrupts();
+
+// AVR libc conversions
+char* itoa(int in_value, char* out_buffer, int in_base);
+char* utoa(unsigned int in_value, char* out_buffer, int in_base);
+char* ltoa(long in_value, char* out_buffer, int in_base);
+char* ultoa(unsigned long in_value, char* out_buffer, int in_base);
+char* dtostrf(double in_value, signed char in_width, unsigned char in_precision, char* out_buffer);
+
+// Print, same interface as the Arduino core one (write() is the only pure virtual)
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t in_byte) = 0;
+    virtual size_t write(const uint8_t* in_buffer, size_t in_len);
+    size_t write(const char* in_str) { return in_str ? write(reinterpret_cast<const uint8_t*>(in_str), strlen(in_str)) : 0; }
+    size_t write(const char* in_buffer, size_t in_len) { return write(reinterpret_cast<const uint8_t*>(in_buffer), in_len); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* in_str) { return write(reinterpret_cast<const char*>(in_str)); }
+    size_t print(const char* in_str) { return write(in_str); }
+    size_t print(char in_c) { return write(static_cast<uint8_t>(in_c)); }
+    size_t print(unsigned char in_value, int in_base = DEC) { return print(static_cast<unsigned long>(in_value), in_base); }
+    size_t print(int in_value, int in_base = DEC) { return print(static_cast<long>(in_value), in_base); }
+    size_t print(unsigned int in_value, int in_base = DEC) { return print(static_cast<unsigned long>(in_value), in_base); }
+    size_t print(long in_value, int in_base = DEC);
+    size_t print(unsigned long in_value, int in_base = DEC);
+    size_t print(double in_value, int in_digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template<typename T>
+    size_t println(T in_value) { size_t n = print(in_value); return n + println(); }
+    template<typename T>
+    size_t println(T in_value, int in_format) { size_t n = print(in_value, in_format); return n + println(); }
+
+private:
+    size_t print_number(unsigned long in_value, uint8_t in_base);
+};
+
+// Stream, only the non-blocking part of the Arduino core one
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(uint8_t* out_buffer, size_t in_len);
+    size_t readBytes(char* out_buffer, size_t in_len) { return readBytes(reinterpret_cast<uint8_t*>(out_buffer), in_len); }
+};
+
+/* Serial port stand-in: the sketch output is captured (host::get_serial_output()) and the input is scripted
+   (host::feed_serial()). */
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long in_baud) { (void)in_baud; }
+    void end() {}
+    operator bool() const { return true; }
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t in_byte);
+    size_t write(const uint8_t* in_buffer, size_t in_len);
+    int availableForWrite() { return 64; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NBAPARK_HOST_ARDUINO_H
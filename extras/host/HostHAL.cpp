@@ -0,0 +1,686 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Definitions of the host HAL, the Arduino API from Arduino.h and the controls from HostHAL.h
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include "HostHAL.h"
+#include <stdio.h>
+#include <map>
+
+// State (start)
+struct PinEvent
+{
+    uint8_t pin;
+    uint8_t level;
+};
+
+struct PinState
+{
+    uint8_t level;
+    uint8_t mode;
+    bool driven; // Level set by a script, INPUT_PULLUP doesn't override it
+    bool interrupt_capable;
+};
+
+struct InterruptState
+{
+    void (*isr)();
+    int mode;
+    bool pending; // Edge seen while interrupts were disabled (one flag per vector, like the AVR)
+    uint32_t count;
+};
+
+struct EchoResponder
+{
+    bool active;
+    uint8_t echo_pin;
+    uint32_t width_us; // 0 = no echo
+    uint32_t latency_us;
+    uint32_t triggers;       // Trigger pulses since set_echo_responder()
+    uint64_t last_trigger_ns;
+    uint64_t min_gap_ns;     // Shortest time between two trigger pulses, UINT64_MAX before the second
+};
+
+static uint64_t s_now_ns = 0;
+static uint64_t s_clock_offset_us = 0; // Added to the clock by micros()/millis()
+static host::Costs s_costs = host::AVR_16MHZ_COSTS;
+static bool s_advancing = false;
+static std::multimap<uint64_t, PinEvent> s_events; // By time in ns, same time events keep their scheduling order
+
+static PinState s_pins[HOST_NUM_PINS];
+static InterruptState s_interrupts[HOST_NUM_PINS];
+static bool s_interrupts_enabled = true;
+static EchoResponder s_responders[HOST_NUM_PINS];
+
+static std::deque<uint8_t> s_serial_input;
+static std::string s_serial_output;
+static bool s_serial_echo = false;
+
+HardwareSerial Serial;
+// State (end)
+
+
+// Clock and events (start)
+static void apply_level(uint8_t in_pin, uint8_t in_level);
+
+// Move the clock to in_target_ns, applying the pin events on the way. Time spent in an ISR (or by an event) only moves
+// the clock forward, the events it passed are applied right after, like the interrupts queued on a real MCU
+static void advance_to(uint64_t in_target_ns)
+{
+    if (s_advancing)
+    {
+        if (in_target_ns > s_now_ns) s_now_ns = in_target_ns;
+        return;
+    }
+
+    s_advancing = true;
+    while (!s_events.empty())
+    {
+        std::multimap<uint64_t, PinEvent>::iterator it = s_events.begin();
+        uint64_t limit = (in_target_ns > s_now_ns) ? in_target_ns : s_now_ns;
+        if (it->first > limit) break;
+
+        PinEvent event = it->second;
+        if (it->first > s_now_ns) s_now_ns = it->first;
+        s_events.erase(it);
+        apply_level(event.pin, event.level);
+    }
+    if (in_target_ns > s_now_ns) s_now_ns = in_target_ns;
+    s_advancing = false;
+}
+
+static void charge(uint32_t in_ns)
+{
+    advance_to(s_now_ns + in_ns);
+}
+
+static void schedule_at(uint64_t in_at_ns, uint8_t in_pin, uint8_t in_level)
+{
+    if (in_pin >= HOST_NUM_PINS) return;
+
+    PinEvent event = {in_pin, in_level};
+    s_events.insert(std::make_pair(in_at_ns, event));
+    s_pins[in_pin].driven = true;
+}
+
+static uint64_t clock_us()
+{
+    return s_now_ns / 1000 + s_clock_offset_us;
+}
+// Clock and events (end)
+
+
+// Interrupts (start)
+static void service_pending();
+
+static void run_isr(uint8_t in_interrupt)
+{
+    InterruptState& state = s_interrupts[in_interrupt];
+    state.pending = false;
+    ++state.count;
+
+    // Interrupts stay disabled while an ISR runs
+    s_interrupts_enabled = false;
+    state.isr();
+    s_interrupts_enabled = true;
+}
+
+static void service_pending()
+{
+    for (uint8_t i = 0; i < HOST_NUM_PINS && s_interrupts_enabled; ++i)
+    {
+        if (s_interrupts[i].pending && s_interrupts[i].isr) run_isr(i);
+    }
+}
+
+static void apply_level(uint8_t in_pin, uint8_t in_level)
+{
+    if (in_pin >= HOST_NUM_PINS) return;
+
+    PinState& pin = s_pins[in_pin];
+    in_level = in_level ? HIGH : LOW;
+    if (pin.level == in_level) return;
+    pin.level = in_level;
+
+    // End of a trigger pulse, the ultrasonic sensor answers with the echo
+    EchoResponder& responder = s_responders[in_pin];
+    if (responder.active && in_level == LOW)
+    {
+        if (responder.triggers && s_now_ns - responder.last_trigger_ns < responder.min_gap_ns) responder.min_gap_ns = s_now_ns - responder.last_trigger_ns;
+        responder.last_trigger_ns = s_now_ns;
+        ++responder.triggers;
+    }
+    if (responder.active && in_level == LOW && responder.width_us > 0)
+    {
+        uint64_t rise = s_now_ns + static_cast<uint64_t>(responder.latency_us) * 1000;
+        schedule_at(rise, responder.echo_pin, HIGH);
+        schedule_at(rise + static_cast<uint64_t>(responder.width_us) * 1000, responder.echo_pin, LOW);
+    }
+
+    InterruptState& interrupt = s_interrupts[in_pin];
+    if (!interrupt.isr) return;
+    if (interrupt.mode == RISING && in_level != HIGH) return;
+    if (interrupt.mode == FALLING && in_level != LOW) return;
+
+    interrupt.pending = true;
+    if (s_interrupts_enabled) run_isr(in_pin);
+}
+// Interrupts (end)
+
+
+// Arduino API (start)
+uint32_t millis()
+{
+    charge(s_costs.millis_ns);
+    return static_cast<uint32_t>(clock_us() / 1000);
+}
+
+uint32_t micros()
+{
+    charge(s_costs.micros_ns);
+    return static_cast<uint32_t>(clock_us());
+}
+
+void delay(unsigned long in_ms)
+{
+    advance_to(s_now_ns + static_cast<uint64_t>(in_ms) * 1000000);
+}
+
+void delayMicroseconds(unsigned int in_us)
+{
+    advance_to(s_now_ns + static_cast<uint64_t>(in_us) * 1000);
+}
+
+void yield() {}
+
+void pinMode(uint8_t in_pin, uint8_t in_mode)
+{
+    if (in_pin >= HOST_NUM_PINS) return;
+
+    s_pins[in_pin].mode = in_mode;
+    if (in_mode == INPUT_PULLUP && !s_pins[in_pin].driven) apply_level(in_pin, HIGH);
+}
+
+void digitalWrite(uint8_t in_pin, uint8_t in_level)
+{
+    charge(s_costs.digital_write_ns);
+    apply_level(in_pin, in_level);
+}
+
+int digitalRead(uint8_t in_pin)
+{
+    charge(s_costs.digital_read_ns);
+    return (in_pin < HOST_NUM_PINS) ? s_pins[in_pin].level : LOW;
+}
+
+uint8_t host_port_read(uint8_t in_port)
+{
+    charge(s_costs.port_read_ns);
+
+    uint8_t first_pin, num_pins;
+    switch (in_port)
+    {
+        case PB: first_pin = 8; num_pins = 6; break;
+        case PC: first_pin = 14; num_pins = 6; break;
+        case PD: first_pin = 0; num_pins = 8; break;
+        default: return 0;
+    }
+
+    uint8_t value = 0;
+    for (uint8_t i = 0; i < num_pins; ++i) value |= (s_pins[first_pin + i].level ? 1 : 0) << i;
+    return value;
+}
+
+// Move the clock until in_pin is at in_level, false (clock at in_deadline_ns) if it doesn't happen before the deadline
+static bool wait_level(uint8_t in_pin, uint8_t in_level, uint64_t in_deadline_ns)
+{
+    while (s_pins[in_pin].level != in_level)
+    {
+        std::multimap<uint64_t, PinEvent>::iterator it = s_events.begin();
+        while (it != s_events.end() && it->first <= in_deadline_ns && it->second.pin != in_pin) ++it;
+
+        if (it == s_events.end() || it->first > in_deadline_ns)
+        {
+            advance_to(in_deadline_ns);
+            return false;
+        }
+        advance_to(it->first);
+    }
+    return true;
+}
+
+// Same steps as the core one: wait for the previous pulse to end, for the pulse to start, then time it
+unsigned long pulseIn(uint8_t in_pin, uint8_t in_state, unsigned long in_timeout)
+{
+    if (in_pin >= HOST_NUM_PINS) return 0;
+
+    uint8_t state = in_state ? HIGH : LOW;
+    uint64_t deadline = s_now_ns + static_cast<uint64_t>(in_timeout) * 1000;
+    if (!wait_level(in_pin, !state, deadline)) return 0;
+    if (!wait_level(in_pin, state, deadline)) return 0;
+
+    uint64_t start = s_now_ns;
+    if (!wait_level(in_pin, !state, deadline)) return 0;
+    return static_cast<unsigned long>((s_now_ns - start) / 1000);
+}
+
+int host_pin_to_interrupt(uint8_t in_pin)
+{
+    return (in_pin < HOST_NUM_PINS && s_pins[in_pin].interrupt_capable) ? in_pin : NOT_AN_INTERRUPT;
+}
+
+void attachInterrupt(uint8_t in_interrupt, void (*in_isr)(), int in_mode)
+{
+    if (in_interrupt >= HOST_NUM_PINS) return;
+
+    s_interrupts[in_interrupt].isr = in_isr;
+    s_interrupts[in_interrupt].mode = in_mode;
+    s_interrupts[in_interrupt].pending = false;
+}
+
+void detachInterrupt(uint8_t in_interrupt)
+{
+    if (in_interrupt >= HOST_NUM_PINS) return;
+
+    s_interrupts[in_interrupt].isr = nullptr;
+    s_interrupts[in_interrupt].pending = false;
+}
+
+void noInterrupts()
+{
+    s_interrupts_enabled = false;
+}
+
+void interrupts()
+{
+    s_interrupts_enabled = true;
+    service_pending();
+}
+
+static char* unsigned_to_str(unsigned long in_value, char* out_buffer, int in_base)
+{
+    if (in_base < 2 || in_base > 36) in_base = 10;
+
+    char digits[33];
+    uint8_t len = 0;
+    do
+    {
+        uint8_t digit = in_value % in_base;
+        digits[len++] = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+        in_value /= in_base;
+    } while (in_value);
+
+    for (uint8_t i = 0; i < len; ++i) out_buffer[i] = digits[len - 1 - i];
+    out_buffer[len] = '\0';
+    return out_buffer;
+}
+
+char* ltoa(long in_value, char* out_buffer, int in_base)
+{
+    if (in_base == 10 && in_value < 0)
+    {
+        out_buffer[0] = '-';
+        unsigned_to_str(0UL - static_cast<unsigned long>(in_value), out_buffer + 1, in_base);
+        return out_buffer;
+    }
+    return unsigned_to_str(static_cast<unsigned long>(in_value), out_buffer, in_base);
+}
+
+char* ultoa(unsigned long in_value, char* out_buffer, int in_base)
+{
+    return unsigned_to_str(in_value, out_buffer, in_base);
+}
+
+char* itoa(int in_value, char* out_buffer, int in_base)
+{
+    if (in_base != 10) return unsigned_to_str(static_cast<unsigned int>(in_value), out_buffer, in_base);
+    return ltoa(in_value, out_buffer, in_base);
+}
+
+char* utoa(unsigned int in_value, char* out_buffer, int in_base)
+{
+    return unsigned_to_str(in_value, out_buffer, in_base);
+}
+
+char* dtostrf(double in_value, signed char in_width, unsigned char in_precision, char* out_buffer)
+{
+    sprintf(out_buffer, "%*.*f", in_width, in_precision, in_value);
+    return out_buffer;
+}
+// Arduino API (end)
+
+
+// Print and Stream (start)
+size_t Print::write(const uint8_t* in_buffer, size_t in_len)
+{
+    size_t written = 0;
+    while (in_len--)
+    {
+        if (!write(*in_buffer++)) break;
+        ++written;
+    }
+    return written;
+}
+
+size_t Print::print_number(unsigned long in_value, uint8_t in_base)
+{
+    char buffer[8 * sizeof(long) + 1];
+    return write(unsigned_to_str(in_value, buffer, (in_base < 2) ? 10 : in_base));
+}
+
+size_t Print::print(long in_value, int in_base)
+{
+    if (in_base == 10 && in_value < 0)
+    {
+        size_t n = print('-');
+        return n + print_number(0UL - static_cast<unsigned long>(in_value), 10);
+    }
+    return print_number(static_cast<unsigned long>(in_value), in_base);
+}
+
+size_t Print::print(unsigned long in_value, int in_base)
+{
+    return print_number(in_value, in_base);
+}
+
+// Same output as the core printFloat()
+size_t Print::print(double in_value, int in_digits)
+{
+    if (isnan(in_value)) return print("nan");
+    if (isinf(in_value)) return print("inf");
+    if (in_value > 4294967040.0 || in_value < -4294967040.0) return print("ovf");
+
+    size_t n = 0;
+    if (in_value < 0.0)
+    {
+        n += print('-');
+        in_value = -in_value;
+    }
+
+    double rounding = 0.5;
+    for (int i = 0; i < in_digits; ++i) rounding /= 10.0;
+    in_value += rounding;
+
+    unsigned long int_part = static_cast<unsigned long>(in_value);
+    double remainder = in_value - static_cast<double>(int_part);
+    n += print(int_part);
+    if (in_digits > 0) n += print('.');
+
+    while (in_digits-- > 0)
+    {
+        remainder *= 10.0;
+        unsigned int digit = static_cast<unsigned int>(remainder);
+        n += print(digit);
+        remainder -= digit;
+    }
+    return n;
+}
+
+size_t Stream::readBytes(uint8_t* out_buffer, size_t in_len)
+{
+    size_t count = 0;
+    while (count < in_len && available() > 0)
+    {
+        int c = read();
+        if (c < 0) break;
+        out_buffer[count++] = static_cast<uint8_t>(c);
+    }
+    return count;
+}
+
+int HardwareSerial::available()
+{
+    return static_cast<int>(s_serial_input.size());
+}
+
+int HardwareSerial::read()
+{
+    if (s_serial_input.empty()) return -1;
+
+    uint8_t c = s_serial_input.front();
+    s_serial_input.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek()
+{
+    return s_serial_input.empty() ? -1 : s_serial_input.front();
+}
+
+size_t HardwareSerial::write(uint8_t in_byte)
+{
+    return write(&in_byte, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* in_buffer, size_t in_len)
+{
+    s_serial_output.append(reinterpret_cast<const char*>(in_buffer), in_len);
+    if (s_serial_echo) fwrite(in_buffer, 1, in_len, stdout);
+    return in_len;
+}
+
+size_t host::CapturePrint::write(uint8_t in_byte)
+{
+    m_data.push_back(in_byte);
+    ++m_writes;
+    return 1;
+}
+
+size_t host::CapturePrint::write(const uint8_t* in_buffer, size_t in_len)
+{
+    m_data.insert(m_data.end(), in_buffer, in_buffer + in_len);
+    ++m_writes;
+    return in_len;
+}
+
+void host::CapturePrint::clear()
+{
+    m_data.clear();
+    m_writes = 0;
+}
+
+int host::ScriptedStream::read()
+{
+    if (m_input.empty()) return -1;
+
+    uint8_t c = m_input.front();
+    m_input.pop_front();
+    return c;
+}
+// Print and Stream (end)
+
+
+// Host controls (start)
+void host::reset()
+{
+    s_now_ns = 0;
+    s_clock_offset_us = 0;
+    s_costs = AVR_16MHZ_COSTS;
+    s_advancing = false;
+    s_events.clear();
+
+    for (uint8_t i = 0; i < HOST_NUM_PINS; ++i)
+    {
+        s_pins[i].level = LOW;
+        s_pins[i].mode = INPUT;
+        s_pins[i].driven = false;
+        s_pins[i].interrupt_capable = true;
+        s_interrupts[i].isr = nullptr;
+        s_interrupts[i].mode = CHANGE;
+        s_interrupts[i].pending = false;
+        s_interrupts[i].count = 0;
+        s_responders[i].active = false;
+    }
+    s_interrupts_enabled = true;
+
+    s_serial_input.clear();
+    s_serial_output.clear();
+}
+
+void host::set_costs(const Costs& in_costs)
+{
+    s_costs = in_costs;
+}
+
+const host::Costs& host::get_costs()
+{
+    return s_costs;
+}
+
+uint64_t host::now_ns()
+{
+    return s_now_ns;
+}
+
+void host::advance_micros(uint32_t in_us)
+{
+    advance_to(s_now_ns + static_cast<uint64_t>(in_us) * 1000);
+}
+
+void host::advance_ns(uint64_t in_ns)
+{
+    advance_to(s_now_ns + in_ns);
+}
+
+void host::set_micros(uint32_t in_micros)
+{
+    s_clock_offset_us = static_cast<uint64_t>(in_micros) - s_now_ns / 1000; // Modulo 2^64, clock_us() wraps it back
+}
+
+void host::set_millis(uint32_t in_millis)
+{
+    s_clock_offset_us = static_cast<uint64_t>(in_millis) * 1000 - s_now_ns / 1000;
+}
+
+uint8_t host::get_pin(uint8_t in_pin)
+{
+    return (in_pin < HOST_NUM_PINS) ? s_pins[in_pin].level : LOW;
+}
+
+uint8_t host::get_pin_mode(uint8_t in_pin)
+{
+    return (in_pin < HOST_NUM_PINS) ? s_pins[in_pin].mode : INPUT;
+}
+
+void host::set_pin(uint8_t in_pin, uint8_t in_level)
+{
+    if (in_pin >= HOST_NUM_PINS) return;
+
+    s_pins[in_pin].driven = true;
+    apply_level(in_pin, in_level);
+}
+
+void host::schedule_level(uint8_t in_pin, uint32_t in_delay_us, uint8_t in_level)
+{
+    schedule_at(s_now_ns + static_cast<uint64_t>(in_delay_us) * 1000, in_pin, in_level);
+}
+
+void host::schedule_pulse(uint8_t in_pin, uint32_t in_delay_us, uint32_t in_width_us, uint8_t in_level)
+{
+    uint64_t start = s_now_ns + static_cast<uint64_t>(in_delay_us) * 1000;
+    schedule_at(start, in_pin, in_level);
+    schedule_at(start + static_cast<uint64_t>(in_width_us) * 1000, in_pin, !in_level);
+}
+
+void host::schedule_beam_break(uint8_t in_pin, uint32_t in_delay_us, uint32_t in_width_us)
+{
+    schedule_pulse(in_pin, in_delay_us, in_width_us, LOW);
+}
+
+void host::clear_events()
+{
+    s_events.clear();
+}
+
+size_t host::pending_events()
+{
+    return s_events.size();
+}
+
+void host::set_echo_responder(uint8_t in_trig_pin, uint8_t in_echo_pin, float in_distance_cm, uint32_t in_latency_us)
+{
+    set_echo_responder_width(in_trig_pin, in_echo_pin, echo_width_us(in_distance_cm), in_latency_us);
+}
+
+void host::set_echo_responder_width(uint8_t in_trig_pin, uint8_t in_echo_pin, uint32_t in_width_us, uint32_t in_latency_us)
+{
+    if (in_trig_pin >= HOST_NUM_PINS || in_echo_pin >= HOST_NUM_PINS) return;
+
+    EchoResponder& responder = s_responders[in_trig_pin];
+    responder.active = true;
+    responder.echo_pin = in_echo_pin;
+    responder.width_us = in_width_us;
+    responder.latency_us = in_latency_us;
+    responder.triggers = 0;
+    responder.min_gap_ns = UINT64_MAX;
+    s_pins[in_echo_pin].driven = true;
+}
+
+void host::clear_echo_responder(uint8_t in_trig_pin)
+{
+    if (in_trig_pin < HOST_NUM_PINS) s_responders[in_trig_pin].active = false;
+}
+
+uint32_t host::get_echo_triggers(uint8_t in_trig_pin)
+{
+    return (in_trig_pin < HOST_NUM_PINS) ? s_responders[in_trig_pin].triggers : 0;
+}
+
+uint32_t host::get_min_trigger_gap_us(uint8_t in_trig_pin)
+{
+    if (in_trig_pin >= HOST_NUM_PINS || s_responders[in_trig_pin].triggers < 2) return UINT32_MAX;
+    return static_cast<uint32_t>(s_responders[in_trig_pin].min_gap_ns / 1000);
+}
+
+// Round trip time of the sound for an object at in_distance_cm (inverse of the library's distance formula)
+uint32_t host::echo_width_us(float in_distance_cm)
+{
+    if (in_distance_cm <= 0) return 0;
+    return static_cast<uint32_t>(in_distance_cm * 2.0f / 0.0343f + 0.5f);
+}
+
+void host::set_interrupt_capable(uint8_t in_pin, bool in_capable)
+{
+    if (in_pin < HOST_NUM_PINS) s_pins[in_pin].interrupt_capable = in_capable;
+}
+
+uint32_t host::get_interrupt_count(uint8_t in_interrupt)
+{
+    return (in_interrupt < HOST_NUM_PINS) ? s_interrupts[in_interrupt].count : 0;
+}
+
+const std::string& host::get_serial_output()
+{
+    return s_serial_output;
+}
+
+void host::clear_serial_output()
+{
+    s_serial_output.clear();
+}
+
+void host::feed_serial(const uint8_t* in_data, size_t in_len)
+{
+    s_serial_input.insert(s_serial_input.end(), in_data, in_data + in_len);
+}
+
+void host::feed_serial(const char* in_str)
+{
+    feed_serial(reinterpret_cast<const uint8_t*>(in_str), strlen(in_str));
+}
+
+void host::set_serial_echo(bool in_echo)
+{
+    s_serial_echo = in_echo;
+}
+// Host controls (end)
+
+
+// Same state as after host::reset() when the program starts (constructed after the state above, same translation unit)
+static struct HostInit
+{
+    HostInit() { host::reset(); }
+} s_host_init;
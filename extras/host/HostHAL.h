@@ -0,0 +1,123 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Control side of the host HAL (Arduino.h in this folder): virtual clock, scripted pin waveforms,
+                ultrasonic echo responders and Print/Stream stand-ins that capture output.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#ifndef NBAPARK_HOST_HAL_H
+#define NBAPARK_HOST_HAL_H
+
+#include "Arduino.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace host
+{
+/* Virtual clock, in nanoseconds since host::reset(). It only moves when the code under test calls the Arduino API:
+   each call costs the time below (so busy-wait loops on micros() end) and delay()/delayMicroseconds() jump ahead.
+   Scripted pin events and the interrupts they trigger are applied in time order as the clock passes them. */
+struct Costs
+{
+    uint32_t micros_ns;
+    uint32_t millis_ns;
+    uint32_t digital_read_ns;
+    uint32_t digital_write_ns;
+    uint32_t port_read_ns; // PINB/PINC/PIND
+};
+
+// Rough figures of the Arduino core on an ATmega328P at 16 MHz (a port register read is a couple of cycles)
+static const Costs AVR_16MHZ_COSTS = {3500, 2000, 3500, 4000, 125};
+
+// Back to time 0, every pin LOW with no events, responders or interrupts, default costs and empty Serial
+void reset();
+
+void set_costs(const Costs& in_costs);
+const Costs& get_costs();
+
+uint64_t now_ns(); // Since reset(), not affected by set_micros()/set_millis()
+void advance_micros(uint32_t in_us);
+void advance_ns(uint64_t in_ns);
+
+// Shift what micros()/millis() return from now on (e.g. to right before their 32-bit wrap), the clock keeps running
+void set_micros(uint32_t in_micros);
+void set_millis(uint32_t in_millis);
+
+// Pins, the scheduled events are relative to now (in_delay_us from the current time)
+uint8_t get_pin(uint8_t in_pin);
+uint8_t get_pin_mode(uint8_t in_pin);
+void set_pin(uint8_t in_pin, uint8_t in_level); // Now, triggering the attached interrupt
+void schedule_level(uint8_t in_pin, uint32_t in_delay_us, uint8_t in_level);
+void schedule_pulse(uint8_t in_pin, uint32_t in_delay_us, uint32_t in_width_us, uint8_t in_level = HIGH);
+void clear_events();
+size_t pending_events();
+
+// Beam break of an IR receiver idle HIGH (LOW while the ball blocks the beam)
+void schedule_beam_break(uint8_t in_pin, uint32_t in_delay_us, uint32_t in_width_us);
+
+/* Ultrasonic sensor (HC-SR04) model: on the falling edge of a trigger pulse, echo_pin goes HIGH after in_latency_us
+   for the round trip time of an object at in_distance_cm. A distance <= 0 means no echo. */
+void set_echo_responder(uint8_t in_trig_pin, uint8_t in_echo_pin, float in_distance_cm, uint32_t in_latency_us = 0);
+// Same with the echo pulse width given directly (e.g. a recorded one), 0 means no echo
+void set_echo_responder_width(uint8_t in_trig_pin, uint8_t in_echo_pin, uint32_t in_width_us, uint32_t in_latency_us = 0);
+void clear_echo_responder(uint8_t in_trig_pin);
+uint32_t get_echo_triggers(uint8_t in_trig_pin);      // Trigger pulses seen by the responder since it was set
+uint32_t get_min_trigger_gap_us(uint8_t in_trig_pin); // Shortest time between two of them, UINT32_MAX if fewer than 2
+uint32_t echo_width_us(float in_distance_cm);
+
+// Pins without an external interrupt (digitalPinToInterrupt() returns NOT_AN_INTERRUPT), all capable by default
+void set_interrupt_capable(uint8_t in_pin, bool in_capable);
+uint32_t get_interrupt_count(uint8_t in_interrupt); // ISR calls since reset()
+
+// Serial
+const std::string& get_serial_output();
+void clear_serial_output();
+void feed_serial(const uint8_t* in_data, size_t in_len);
+void feed_serial(const char* in_str);
+void set_serial_echo(bool in_echo); // Also print the Serial output to stdout
+
+// Print that keeps everything written to it
+class CapturePrint : public Print
+{
+    std::vector<uint8_t> m_data;
+    size_t m_writes;
+
+public:
+    CapturePrint() : m_writes(0) {}
+
+    size_t write(uint8_t in_byte);
+    size_t write(const uint8_t* in_buffer, size_t in_len);
+    int availableForWrite() { return 0x7FFF; }
+    using Print::write;
+
+    void clear();
+    const std::vector<uint8_t>& get_data() const { return m_data; }
+    std::string get_string() const { return std::string(m_data.begin(), m_data.end()); }
+    size_t get_writes() const { return m_writes; } // write() calls, a run of bytes written at once counts as one
+};
+
+// Stream reading scripted input, written bytes are captured
+class ScriptedStream : public Stream
+{
+    std::deque<uint8_t> m_input;
+    CapturePrint m_output;
+
+public:
+    void feed(const uint8_t* in_data, size_t in_len) { m_input.insert(m_input.end(), in_data, in_data + in_len); }
+    void feed(const char* in_str) { feed(reinterpret_cast<const uint8_t*>(in_str), strlen(in_str)); }
+
+    int available() { return static_cast<int>(m_input.size()); }
+    int read();
+    int peek() { return m_input.empty() ? -1 : m_input.front(); }
+    size_t write(uint8_t in_byte) { return m_output.write(in_byte); }
+    size_t write(const uint8_t* in_buffer, size_t in_len) { return m_output.write(in_buffer, in_len); }
+    using Print::write;
+
+    CapturePrint& get_output() { return m_output; }
+};
+} // namespace host
+
+#endif // NBAPARK_HOST_HAL_H
@@ -0,0 +1,1303 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Benchmarks of the library hot paths on the host build: GameMVP loop latency, check_sensors() sweeps,
+                echo sampling rate of ThreeBasketSensors against FastThreeBasketSensors,
+                filter_sensor_readings(), OSC encode/decode, the per-field OSC send against OSCPark::send(),
+                MVPHoops::update() over long layout tables, TimerWheel against a linear scan of Timers and the
+                SPSCQueue throughput.
+                Every scenario is scripted on the virtual clock of HostHAL.h, so its virtual time (the board time under
+                the Arduino API costs of host::AVR_16MHZ_COSTS) and counts are reproducible and can be compared with a
+                baseline. Wall-clock figures are host CPU time, only comparable between runs on the same machine.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Report (start)
+enum MetricKind
+{
+    VIRTUAL, // Virtual clock time, deterministic
+    COUNT,   // Deterministic count or size
+    WALL     // Host wall-clock, depends on the machine
+};
+
+const char* const KIND_NAMES[] = {"virtual", "count", "wall"};
+
+// Direction of an improvement, a behavior count (e.g. detections) is expected to stay the same
+enum Better
+{
+    LOWER,
+    HIGHER,
+    EQUAL
+};
+
+const char* const BETTER_NAMES[] = {"lower", "higher", "equal"};
+
+struct Metric
+{
+    std::string scenario;
+    std::string variant;
+    std::string name;
+    std::string unit;
+    MetricKind kind;
+    Better better;
+    double value;
+
+    std::string key() const { return scenario + "/" + variant + "/" + name; }
+};
+
+// Filled by a scenario run: the wall time of the measured part, the virtual time of each operation and extra counts
+class Sample
+{
+    std::chrono::steady_clock::time_point m_wall_start;
+    uint64_t m_wall_ns;
+    uint64_t m_virtual_ns;
+    uint64_t m_virtual_max_ns;
+    bool m_has_virtual;
+
+public:
+    uint32_t ops;
+    uint64_t bytes;
+    struct Count
+    {
+        std::string name;
+        double value;
+        Better better;
+    };
+    std::vector<Count> counts;
+
+    Sample() : m_wall_ns(0), m_virtual_ns(0), m_virtual_max_ns(0), m_has_virtual(false), ops(0), bytes(0) {}
+
+    void begin() { m_wall_start = std::chrono::steady_clock::now(); }
+    void end()
+    {
+        m_wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_wall_start).count();
+    }
+
+    void add_virtual(uint64_t in_ns)
+    {
+        m_has_virtual = true;
+        m_virtual_ns += in_ns;
+        if (in_ns > m_virtual_max_ns) m_virtual_max_ns = in_ns;
+    }
+    void add_count(const char* in_name, double in_value, Better in_better = EQUAL)
+    {
+        Count count = {in_name, in_value, in_better};
+        counts.push_back(count);
+    }
+
+    uint64_t get_wall_ns() const { return m_wall_ns; }
+    uint64_t get_virtual_ns() const { return m_virtual_ns; }
+    uint64_t get_virtual_max_ns() const { return m_virtual_max_ns; }
+    bool has_virtual() const { return m_has_virtual; }
+};
+
+typedef void (*ScenarioFunc)(Sample& out_sample);
+
+struct Scenario
+{
+    const char* name;
+    const char* variant;
+    const char* op_unit; // What one operation is, e.g. "loop" or "msg"
+    ScenarioFunc run;
+};
+
+std::string json_escape(const std::string& in_str)
+{
+    std::string out;
+    for (size_t i = 0; i < in_str.size(); ++i)
+    {
+        if (in_str[i] == '"' || in_str[i] == '\\') out += '\\';
+        out += in_str[i];
+    }
+    return out;
+}
+
+void write_json(std::ostream& out, const std::vector<Metric>& in_metrics, uint32_t in_repeat)
+{
+    const host::Costs& costs = host::get_costs();
+    out << "{\n  \"suite\": \"nbapark_bench\",\n  \"repeat\": " << in_repeat << ",\n";
+    out << "  \"costs_ns\": {\"micros\": " << costs.micros_ns << ", \"millis\": " << costs.millis_ns
+        << ", \"digital_read\": " << costs.digital_read_ns << ", \"digital_write\": " << costs.digital_write_ns
+        << ", \"port_read\": " << costs.port_read_ns << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < in_metrics.size(); ++i)
+    {
+        const Metric& m = in_metrics[i];
+        out << "    {\"scenario\": \"" << json_escape(m.scenario) << "\", \"variant\": \"" << json_escape(m.variant)
+            << "\", \"metric\": \"" << json_escape(m.name) << "\", \"unit\": \"" << json_escape(m.unit)
+            << "\", \"kind\": \"" << KIND_NAMES[m.kind] << "\", \"better\": \"" << BETTER_NAMES[m.better]
+            << "\", \"value\": " << m.value << "}" << (i + 1 < in_metrics.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void write_csv(std::ostream& out, const std::vector<Metric>& in_metrics)
+{
+    out << "scenario,variant,metric,unit,kind,better,value\n";
+    for (size_t i = 0; i < in_metrics.size(); ++i)
+    {
+        const Metric& m = in_metrics[i];
+        out << m.scenario << ',' << m.variant << ',' << m.name << ',' << m.unit << ',' << KIND_NAMES[m.kind] << ','
+            << BETTER_NAMES[m.better] << ',' << m.value << "\n";
+    }
+}
+
+// Baseline in the CSV format above, returns false if the file can't be read
+bool read_baseline(const std::string& in_path, std::map<std::string, double>& out_values)
+{
+    std::ifstream in(in_path.c_str());
+    if (!in) return false;
+
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+        if (fields.size() != 7) continue;
+        out_values[fields[0] + "/" + fields[1] + "/" + fields[2]] = atof(fields[6].c_str());
+    }
+    return true;
+}
+
+/* Number of regressions beyond in_tolerance (fraction): a metric worse than its baseline or a behavior count that
+   changed. The wall-clock metrics are only compared with in_compare_wall. */
+uint32_t compare_baseline(const std::vector<Metric>& in_metrics, const std::map<std::string, double>& in_baseline,
+                          double in_tolerance, bool in_compare_wall)
+{
+    uint32_t regressions = 0;
+    for (size_t i = 0; i < in_metrics.size(); ++i)
+    {
+        const Metric& m = in_metrics[i];
+        if (m.kind == WALL && !in_compare_wall) continue;
+
+        std::map<std::string, double>::const_iterator it = in_baseline.find(m.key());
+        if (it == in_baseline.end())
+        {
+            std::cerr << "new      " << m.key() << " = " << m.value << " " << m.unit << "\n";
+            continue;
+        }
+
+        double base = it->second;
+        double change = (base != 0.0) ? (m.value - base) / base : (m.value != 0.0 ? 1.0 : 0.0);
+        bool worse, better;
+        switch (m.better)
+        {
+            case LOWER: worse = change > in_tolerance; better = change < -in_tolerance; break;
+            case HIGHER: worse = change < -in_tolerance; better = change > in_tolerance; break;
+            default: worse = change > in_tolerance || change < -in_tolerance; better = false; break;
+        }
+        if (worse || better)
+        {
+            const char* tag = worse ? (m.better == EQUAL ? "CHANGED  " : "REGRESS  ") : "improve  ";
+            std::cerr << tag << m.key() << ": " << base << " -> " << m.value << " " << m.unit << " (" << (change >= 0 ? "+" : "") << change * 100.0 << "%)\n";
+        }
+        if (worse) ++regressions;
+    }
+    return regressions;
+}
+// Report (end)
+
+
+// Host stand-ins (start)
+// Print that only counts what is written to it (the UDP packet being built)
+class CountingPrint : public Print
+{
+public:
+    uint64_t bytes;
+    uint32_t checksum;
+    uint32_t writes; // write() calls, each one is a W5100 SPI transaction on the board
+
+    CountingPrint() : bytes(0), checksum(0), writes(0) {}
+
+    size_t write(uint8_t in_byte) { ++bytes; ++writes; checksum += in_byte; return 1; }
+    size_t write(const uint8_t* in_buffer, size_t in_len)
+    {
+        bytes += in_len;
+        ++writes;
+        if (in_len) checksum += in_buffer[0] + in_buffer[in_len - 1];
+        return in_len;
+    }
+    using Print::write;
+};
+
+// Received datagrams, same parsePacket()/read() interface as EthernetUDP
+class ScriptedUDP
+{
+    std::deque<std::vector<uint8_t> > m_queue;
+    std::vector<uint8_t> m_packet;
+    size_t m_pos;
+
+public:
+    ScriptedUDP() : m_pos(0) {}
+
+    void push(const uint8_t* in_data, size_t in_len) { m_queue.push_back(std::vector<uint8_t>(in_data, in_data + in_len)); }
+
+    int parsePacket()
+    {
+        if (m_queue.empty())
+        {
+            m_packet.clear();
+            return 0;
+        }
+        m_packet.swap(m_queue.front());
+        m_queue.pop_front();
+        m_pos = 0;
+        return static_cast<int>(m_packet.size());
+    }
+
+    int read(uint8_t* out_buffer, size_t in_len)
+    {
+        size_t len = m_packet.size() - m_pos;
+        if (len > in_len) len = in_len;
+        memcpy(out_buffer, m_packet.data() + m_pos, len);
+        m_pos += len;
+        return static_cast<int>(len);
+    }
+};
+
+// Keeps the benchmarked results alive so the compiler can't drop the work
+volatile uint32_t g_sink;
+// Host stand-ins (end)
+
+
+// loop_latency (start)
+// The GameMVP.ino loop() with its globals in one object: router, pump, MVP layouts, three IR sensors and the outbox
+const MVPHoops::Layout GAME_LAYOUTS[] = {
+    MVPHoops::Layout(5, BitmapPattern::LAYOUT_1),
+    MVPHoops::Layout(12, BitmapPattern::LAYOUT_5),
+    MVPHoops::Layout(14, BitmapPattern::LAYOUT_4),
+    MVPHoops::Layout(21, BitmapPattern::LAYOUT_6),
+    MVPHoops::Layout(23, BitmapPattern::LAYOUT_2),
+    MVPHoops::Layout(27, BitmapPattern::LAYOUT_3),
+    MVPHoops::Layout(29, BitmapPattern::LAYOUT_1),
+    MVPHoops::Layout(33, BitmapPattern::LAYOUT_7),
+    MVPHoops::Layout(102, BitmapPattern::LAYOUT_STOP),
+};
+
+OSC_HEADER_TEMPLATE(bench_score_header, RESOLUME_SCORE_ADDRESS, ",s");
+OSC_HEADER_TEMPLATE(bench_high_score_header, RESOLUME_HIGH_SCORE_ADDRESS, ",s");
+
+const uint8_t IR_PINS[NUM_MVP_HOOPS] = {2, 4, 6};
+
+struct GameLoop
+{
+    uint8_t osc_buffer[256];
+    ScriptedUDP udp;
+    CountingPrint out;
+    OSCRouter<2> router;
+    OSCPump pump;
+    OSCOutbox<3> outbox;
+    MVPHoops mvp_hoops;
+    MVPHoops::MVPState mvp_state;
+    IRBasketSensor baskets[NUM_MVP_HOOPS];
+    Timer game_timer;
+    uint16_t score_count;
+    uint16_t high_score_count;
+    uint32_t detections;
+
+    GameLoop(bool in_irq)
+        : pump(osc_buffer, sizeof(osc_buffer)), mvp_state(MVPHoops::MVP_GAME_OVER),
+          baskets{IRBasketSensor(IR_PINS[0]), IRBasketSensor(IR_PINS[1]), IRBasketSensor(IR_PINS[2])},
+          score_count(0), high_score_count(DEFAULT_HIGH_SCORE), detections(0)
+    {
+        mvp_hoops.init(GAME_LAYOUTS, sizeof(GAME_LAYOUTS) / sizeof(GAME_LAYOUTS[0]));
+        router.add(RESOLUME_MVPGAME_ADDRESS, on_game_start, this);
+        router.add(RESOLUME_MVPWAIT_ADDRESS, on_game_wait, this);
+        for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i)
+        {
+            host::set_pin(IR_PINS[i], HIGH); // Beam not broken
+            if (in_irq) baskets[i].attach_interrupt();
+        }
+    }
+
+    ~GameLoop()
+    {
+        for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i) baskets[i].detach_interrupt();
+    }
+
+    void loop()
+    {
+        FrameClock::tick();
+        pump.poll(udp, router);
+
+        if (mvp_state != MVPHoops::MVP_GAME_OVER)
+        {
+            mvp_state = mvp_hoops.update(game_timer.get_elapsed_time(true, FrameClock::now_ms()));
+            if (mvp_state == MVPHoops::MVP_RUNNING) game_update();
+        }
+
+        if (outbox.is_due(FrameClock::now_ms()) && outbox.get_pending())
+        {
+            outbox.flush(out, FrameClock::now_ms());
+        }
+    }
+
+    void game_update()
+    {
+        BitmapPattern pattern = mvp_hoops.get_curr_pattern();
+        uint8_t shots_converted = 0;
+        for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i)
+        {
+            if (((pattern >> i) & 1) && baskets[i].ball_detected(FrameClock::now_ms())) ++shots_converted;
+        }
+        if (!shots_converted) return;
+
+        detections += shots_converted;
+        score_count += shots_converted * 2;
+        post_score(bench_score_header, score_count);
+        if (score_count > high_score_count)
+        {
+            high_score_count = score_count;
+            post_score(bench_high_score_header, high_score_count);
+        }
+    }
+
+    template<typename HEADER>
+    void post_score(const HEADER& in_header, uint16_t in_score)
+    {
+        char score_buffer[6];
+        utoa(in_score, score_buffer, 10);
+        size_t capacity;
+        uint8_t* element = outbox.begin_post(capacity);
+        outbox.end_post(in_header.write_string(element, capacity, score_buffer));
+    }
+
+    static void on_game_start(const OSCView&, void* in_ctx)
+    {
+        GameLoop* game = static_cast<GameLoop*>(in_ctx);
+        if (game->mvp_state != MVPHoops::MVP_GAME_OVER) return;
+        game->mvp_hoops.reset();
+        game->mvp_state = game->mvp_hoops.update(game->game_timer.reset(FrameClock::now_ms()));
+        game->score_count = 0;
+    }
+
+    static void on_game_wait(const OSCView&, void* in_ctx)
+    {
+        static_cast<GameLoop*>(in_ctx)->mvp_state = MVPHoops::MVP_GAME_OVER;
+    }
+};
+
+const uint32_t LOOP_PERIOD_US = 1000; // Board time between loop() passes (outside the measured pass)
+const uint32_t GAME_LOOPS = 40000;    // 40 s of game, through 7 layouts
+
+/* Resolume streams the transport position of the running clip: one /mvp/game packet every 4th pass, and a ball goes
+   through one of the hoops (round robin) every 150 ms */
+void run_game(Sample& out_sample, bool in_active, bool in_irq)
+{
+    GameLoop game(in_irq);
+
+    uint8_t transport[64];
+    OSCPark transport_msg(RESOLUME_MVPGAME_ADDRESS);
+    transport_msg.set_float(0.5f);
+    size_t transport_len = transport_msg.serialize(transport, sizeof(transport));
+
+    out_sample.begin();
+    for (uint32_t i = 0; i < GAME_LOOPS; ++i)
+    {
+        if (in_active)
+        {
+            if ((i & 3) == 0) game.udp.push(transport, transport_len);
+            if (i % 150 == 0) host::schedule_beam_break(IR_PINS[(i / 150) % NUM_MVP_HOOPS], 200, 12000);
+        }
+
+        uint64_t start = host::now_ns();
+        game.loop();
+        out_sample.add_virtual(host::now_ns() - start);
+        host::advance_micros(LOOP_PERIOD_US);
+    }
+    out_sample.end();
+
+    out_sample.ops = GAME_LOOPS;
+    out_sample.add_count("detections", game.detections);
+    out_sample.add_count("osc_bytes_sent", static_cast<double>(game.out.bytes));
+    g_sink = game.out.checksum;
+}
+
+void bench_loop_idle(Sample& out_sample) { run_game(out_sample, false, false); }
+void bench_loop_game_polled(Sample& out_sample) { run_game(out_sample, true, false); }
+void bench_loop_game_irq(Sample& out_sample) { run_game(out_sample, true, true); }
+// loop_latency (end)
+
+
+// check_sensors (start)
+const uint8_t TRIG_PINS[NUM_MVP_HOOPS] = {22, 24, 26};
+const uint8_t ECHO_PINS[NUM_MVP_HOOPS] = {23, 25, 27};
+const uint32_t SWEEPS = 2000;
+
+// One check_sensors() per loop pass, with an object at in_distances[i] cm from each sensor (<= 0 for no echo)
+void run_sweeps(Sample& out_sample, const float* in_distances)
+{
+    ThreeBasketSensors sensors(TRIG_PINS[0], TRIG_PINS[1], TRIG_PINS[2], ECHO_PINS[0], ECHO_PINS[1], ECHO_PINS[2]);
+    for (uint8_t i = 0; i < NUM_MVP_HOOPS; ++i)
+    {
+        pinMode(TRIG_PINS[i], OUTPUT);
+        pinMode(ECHO_PINS[i], INPUT);
+        host::set_echo_responder(TRIG_PINS[i], ECHO_PINS[i], in_distances[i]);
+    }
+
+    uint32_t detected = 0;
+    uint64_t samples = 0;
+    out_sample.begin();
+    for (uint32_t i = 0; i < SWEEPS; ++i)
+    {
+        uint64_t start = host::now_ns();
+        detected += sensors.check_sensors() != BitmapPattern::LAYOUT_0;
+        out_sample.add_virtual(host::now_ns() - start);
+        samples += sensors.get_last_sample_count();
+        host::advance_micros(BALL_DETECTION_READ_DELAY * 1000UL); // Let the late echoes end before the next trigger
+    }
+    out_sample.end();
+
+    out_sample.ops = SWEEPS;
+    out_sample.add_count("samples_per_sweep", static_cast<double>(samples) / SWEEPS, HIGHER);
+    out_sample.add_count("sweeps_detecting", detected);
+}
+
+void bench_sweep_no_echo(Sample& out_sample) { const float d[] = {0, 0, 0}; run_sweeps(out_sample, d); }
+void bench_sweep_10cm(Sample& out_sample) { const float d[] = {10, 10, 10}; run_sweeps(out_sample, d); }
+void bench_sweep_25cm(Sample& out_sample) { const float d[] = {25, 25, 25}; run_sweeps(out_sample, d); }
+void bench_sweep_50cm(Sample& out_sample) { const float d[] = {50, 50, 50}; run_sweeps(out_sample, d); }
+void bench_sweep_80cm(Sample& out_sample) { const float d[] = {80, 80, 80}; run_sweeps(out_sample, d); }
+void bench_sweep_mixed(Sample& out_sample) { const float d[] = {12, 60, 0}; run_sweeps(out_sample, d); }
+// check_sensors (end)
+
+
+// echo_sampler (start)
+// Uno pins, the direct port reads of FastThreeBasketSensors only exist for the ATmega328P pinout on the host
+const uint8_t SAMPLER_TRIG_PINS[3] = {8, 9, 10};
+const uint8_t SAMPLER_ECHO_PINS[3] = {2, 4, 6}; // All on PD
+const float SAMPLER_DISTANCES[3] = {10, 25, 40};
+
+/* Echo sampling rate of check_sensors() with runtime pins (digitalRead()) or compile-time pins (port registers),
+   all three echoes answering so each sweep lasts until the farthest one ends */
+template<class SENSORS>
+void run_sampler(Sample& out_sample, SENSORS& in_sensors, const uint8_t* in_echo_pins)
+{
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        pinMode(SAMPLER_TRIG_PINS[i], OUTPUT);
+        pinMode(in_echo_pins[i], INPUT);
+        host::set_echo_responder(SAMPLER_TRIG_PINS[i], in_echo_pins[i], SAMPLER_DISTANCES[i]);
+    }
+
+    uint32_t detected = 0;
+    uint64_t samples = 0;
+    uint64_t sweep_ns = 0;
+    out_sample.begin();
+    for (uint32_t i = 0; i < SWEEPS; ++i)
+    {
+        uint64_t start = host::now_ns();
+        detected += in_sensors.check_sensors() != BitmapPattern::LAYOUT_0;
+        sweep_ns += host::now_ns() - start;
+        out_sample.add_virtual(host::now_ns() - start);
+        samples += in_sensors.get_last_sample_count();
+        host::advance_micros(BALL_DETECTION_READ_DELAY * 1000UL);
+    }
+    out_sample.end();
+
+    out_sample.ops = SWEEPS;
+    out_sample.add_count("samples_per_sweep", static_cast<double>(samples) / SWEEPS, HIGHER);
+    out_sample.add_count("samples_per_us", static_cast<double>(samples) * 1000.0 / sweep_ns, HIGHER);
+    out_sample.add_count("sweeps_detecting", detected);
+}
+
+void bench_sampler_runtime(Sample& out_sample)
+{
+    ThreeBasketSensors sensors(SAMPLER_TRIG_PINS[0], SAMPLER_TRIG_PINS[1], SAMPLER_TRIG_PINS[2],
+                               SAMPLER_ECHO_PINS[0], SAMPLER_ECHO_PINS[1], SAMPLER_ECHO_PINS[2]);
+    run_sampler(out_sample, sensors, SAMPLER_ECHO_PINS);
+}
+
+void bench_sampler_fast_1_port(Sample& out_sample)
+{
+    FastThreeBasketSensors<8, 9, 10, 2, 4, 6> sensors;
+    run_sampler(out_sample, sensors, SAMPLER_ECHO_PINS);
+}
+
+void bench_sampler_fast_3_ports(Sample& out_sample)
+{
+    const uint8_t echo_pins[3] = {2, 11, 14}; // PD, PB and PC
+    FastThreeBasketSensors<8, 9, 10, 2, 11, 14> sensors;
+    run_sampler(out_sample, sensors, echo_pins);
+}
+// echo_sampler (end)
+
+
+// filter_sensor_readings (start)
+const uint32_t FILTER_CALLS = 200000;
+
+// Fixed seed xorshift, the same inputs on every run
+struct XorShift32
+{
+    uint32_t state;
+    XorShift32() : state(0x4E424150U) {}
+    uint32_t next() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; }
+};
+
+// Random layouts and sensor checks (1 in 8 readings sees a ball), one call per millisecond
+template<uint8_t N>
+void run_filter(Sample& out_sample)
+{
+    typedef typename BasketSensorArray<N>::pattern_t pattern_t;
+    uint8_t trig_pins[N];
+    uint8_t echo_pins[N];
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        trig_pins[i] = 22 + 2 * i;
+        echo_pins[i] = 23 + 2 * i;
+    }
+    BasketSensorArray<N> sensors(trig_pins, echo_pins);
+
+    XorShift32 rng;
+    std::vector<pattern_t> layouts(1024);
+    std::vector<pattern_t> checks(1024);
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        layouts[i] = static_cast<pattern_t>(rng.next() & HoopTraits<N>::ALL_HOOPS);
+        uint32_t r = rng.next();
+        checks[i] = static_cast<pattern_t>(((r & 7) == 0) ? ((r >> 3) & HoopTraits<N>::ALL_HOOPS) : 0);
+    }
+
+    uint32_t converted = 0;
+    out_sample.begin();
+    for (uint32_t i = 0; i < FILTER_CALLS; ++i)
+    {
+        converted += sensors.filter_sensor_readings(layouts[i & 1023], checks[(i * 7) & 1023], i);
+    }
+    out_sample.end();
+
+    out_sample.ops = FILTER_CALLS;
+    out_sample.add_count("shots_converted", converted);
+    g_sink = converted;
+}
+
+void bench_filter_3(Sample& out_sample) { run_filter<3>(out_sample); }
+void bench_filter_8(Sample& out_sample) { run_filter<8>(out_sample); }
+// filter_sensor_readings (end)
+
+
+// OSC encode/decode (start)
+const uint32_t OSC_MSGS = 100000;
+const uint8_t BLOB[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+void fill_mixed(OSCPark& out_msg)
+{
+    out_msg.init("/mvp/stats");
+    out_msg.add_int(1234);
+    out_msg.add_float(0.75f);
+    out_msg.add_string("hoop");
+    out_msg.add_blob(BLOB, sizeof(BLOB));
+}
+
+// OSCPark::init() + set_string() + send(), the score update of the sketches without templates
+void bench_encode_score_park(Sample& out_sample)
+{
+    CountingPrint out;
+    OSCPark msg;
+    char score[6];
+    out_sample.begin();
+    for (uint32_t i = 0; i < OSC_MSGS; ++i)
+    {
+        msg.init(RESOLUME_SCORE_ADDRESS);
+        utoa(i % 1000, score, 10);
+        msg.set_string(score);
+        msg.send(out);
+    }
+    out_sample.end();
+    out_sample.ops = OSC_MSGS;
+    out_sample.bytes = out.bytes;
+    g_sink = out.checksum;
+}
+
+// Same message from the PROGMEM OSCHeaderTemplate, as the sketches post it to OSCOutbox
+void bench_encode_score_template(Sample& out_sample)
+{
+    CountingPrint out;
+    uint8_t buffer[128];
+    char score[6];
+    out_sample.begin();
+    for (uint32_t i = 0; i < OSC_MSGS; ++i)
+    {
+        utoa(i % 1000, score, 10);
+        size_t len = bench_score_header.write_string(buffer, sizeof(buffer), score);
+        out.write(buffer, len);
+    }
+    out_sample.end();
+    out_sample.ops = OSC_MSGS;
+    out_sample.bytes = out.bytes;
+    g_sink = out.checksum;
+}
+
+void bench_encode_mixed(Sample& out_sample)
+{
+    CountingPrint out;
+    OSCPark msg;
+    out_sample.begin();
+    for (uint32_t i = 0; i < OSC_MSGS; ++i)
+    {
+        fill_mixed(msg);
+        msg.send(out);
+    }
+    out_sample.end();
+    out_sample.ops = OSC_MSGS;
+    out_sample.bytes = out.bytes;
+    g_sink = out.checksum;
+}
+
+/* The send path before OSCPark::serialize(): each field, null terminator and padding byte written on its own. Only
+   the single-argument messages (i, f or s) it supported, kept here as the reference of osc_send. */
+void send_per_field(const OSCPark& in_msg, Print& in_p)
+{
+    uint8_t padding_len = (4 - ((in_msg.get_addr_len() + 1) % 4)) % 4;
+    in_p.write(reinterpret_cast<const uint8_t*>(in_msg.get_addr()), in_msg.get_addr_len());
+    in_p.write('\0');
+    while (padding_len--) in_p.write('\0');
+    if (in_msg.get_arg_count() < 1) return;
+
+    char type = in_msg.get_arg_type(0);
+    in_p.write(static_cast<uint8_t>(','));
+    in_p.write(static_cast<uint8_t>(type));
+    in_p.write('\0');
+    padding_len = (4 - ((in_msg.get_type_len() + 2) % 4)) % 4;
+    while (padding_len--) in_p.write('\0');
+
+    if (type == 'i' || type == 'f')
+    {
+        uint8_t value[4];
+        uint32_t temp = static_cast<uint32_t>(in_msg.get_int());
+        if (type == 'f')
+        {
+            float f_value = in_msg.get_float();
+            memcpy(&temp, &f_value, sizeof(temp));
+        }
+        osc_write_be32(value, temp);
+        in_p.write(value, sizeof(value));
+    }
+    else if (type == 's')
+    {
+        size_t str_len = strlen(in_msg.get_str());
+        in_p.write(reinterpret_cast<const uint8_t*>(in_msg.get_str()), str_len);
+        in_p.write('\0');
+        padding_len = (4 - ((str_len + 1) % 4)) % 4;
+        while (padding_len--) in_p.write('\0');
+    }
+}
+
+// The score update and a transport message, sent per field or with OSCPark::send()
+template<bool PER_FIELD>
+void run_send(Sample& out_sample)
+{
+    CountingPrint out;
+    OSCPark msg;
+    char score[6];
+
+    // Both paths put the same bytes on the wire
+    uint32_t mismatches = 0;
+    for (uint8_t m = 0; m < 2; ++m)
+    {
+        msg.init(m ? RESOLUME_MVPGAME_ADDRESS : RESOLUME_SCORE_ADDRESS);
+        if (m) msg.set_float(0.5f);
+        else msg.set_string("123");
+        host::CapturePrint per_field;
+        host::CapturePrint single;
+        send_per_field(msg, per_field);
+        msg.send(single);
+        mismatches += per_field.get_data() != single.get_data();
+    }
+
+    out_sample.begin();
+    for (uint32_t i = 0; i < OSC_MSGS; ++i)
+    {
+        if (i & 1)
+        {
+            msg.init(RESOLUME_MVPGAME_ADDRESS);
+            msg.set_float((i & 2) ? 1.0f : 0.0f);
+        }
+        else
+        {
+            msg.init(RESOLUME_SCORE_ADDRESS);
+            utoa(i % 1000, score, 10);
+            msg.set_string(score);
+        }
+        if (PER_FIELD) send_per_field(msg, out);
+        else msg.send(out);
+    }
+    out_sample.end();
+    out_sample.ops = OSC_MSGS;
+    out_sample.bytes = out.bytes;
+    out_sample.add_count("writes_per_msg", static_cast<double>(out.writes) / OSC_MSGS, LOWER);
+    out_sample.add_count("mismatches", mismatches);
+    g_sink = out.checksum;
+}
+
+void bench_send_per_field(Sample& out_sample) { run_send<true>(out_sample); }
+void bench_send_single_write(Sample& out_sample) { run_send<false>(out_sample); }
+
+// Decode a packet encoded by in_fill with OSCPark::init() or OSCView::parse(), reading every argument
+template<bool VIEW>
+void run_decode(Sample& out_sample, void (*in_fill)(OSCPark&))
+{
+    OSCPark src;
+    in_fill(src);
+    uint8_t packet[128];
+    size_t len = src.serialize(packet, sizeof(packet));
+
+    uint32_t checksum = 0;
+    OSCPark park;
+    OSCView view;
+    out_sample.begin();
+    for (uint32_t i = 0; i < OSC_MSGS; ++i)
+    {
+        packet[len - 1] = static_cast<uint8_t>(i); // Defeat hoisting, last byte of the last argument
+        if (VIEW)
+        {
+            if (!view.parse(packet, len)) continue;
+            for (uint8_t a = 0; a < view.get_arg_count(); ++a) checksum += static_cast<uint32_t>(view.get_int(a)) + view.get_arg_type(a);
+            checksum += view.get_addr_len();
+        }
+        else
+        {
+            park.init(packet);
+            for (uint8_t a = 0; a < park.get_arg_count(); ++a) checksum += static_cast<uint32_t>(park.get_int(a)) + park.get_arg_type(a);
+            checksum += park.get_addr_len();
+        }
+    }
+    out_sample.end();
+    out_sample.ops = OSC_MSGS;
+    out_sample.bytes = static_cast<uint64_t>(len) * OSC_MSGS;
+    g_sink = checksum;
+}
+
+void fill_score(OSCPark& out_msg)
+{
+    out_msg.init(RESOLUME_SCORE_ADDRESS);
+    out_msg.set_string("27");
+}
+
+void fill_transport(OSCPark& out_msg)
+{
+    out_msg.init(RESOLUME_MVPGAME_ADDRESS);
+    out_msg.set_float(0.5f);
+}
+
+void bench_decode_park_transport(Sample& out_sample) { run_decode<false>(out_sample, fill_transport); }
+void bench_decode_view_transport(Sample& out_sample) { run_decode<true>(out_sample, fill_transport); }
+void bench_decode_park_score(Sample& out_sample) { run_decode<false>(out_sample, fill_score); }
+void bench_decode_view_score(Sample& out_sample) { run_decode<true>(out_sample, fill_score); }
+void bench_decode_park_mixed(Sample& out_sample) { run_decode<false>(out_sample, fill_mixed); }
+void bench_decode_view_mixed(Sample& out_sample) { run_decode<true>(out_sample, fill_mixed); }
+// OSC encode/decode (end)
+
+
+// mvp_update (start)
+const uint32_t MVP_STEP = 100; // Time units between layouts, update() is called every unit
+
+/* Plays whole games on a table of in_size layouts (sentinel included, at most 255 as init() takes an uint8_t),
+   calling update() for every time unit as the loop does */
+template<uint8_t N>
+void run_mvp_update(Sample& out_sample, uint8_t in_size, uint8_t in_games)
+{
+    typedef MVPHoopsArray<N> Hoops;
+    std::vector<typename Hoops::Layout> layouts(in_size);
+    XorShift32 rng;
+    for (uint8_t i = 0; i + 1 < in_size; ++i)
+    {
+        layouts[i] = typename Hoops::Layout((i + 1) * MVP_STEP, static_cast<typename Hoops::pattern_t>(rng.next() & HoopTraits<N>::ALL_HOOPS));
+    }
+    layouts[in_size - 1] = typename Hoops::Layout(in_size * MVP_STEP, static_cast<typename Hoops::pattern_t>(HoopTraits<N>::LAYOUT_STOP));
+
+    Hoops hoops;
+    if (!hoops.init(layouts.data(), in_size)) return;
+
+    uint32_t calls = 0;
+    uint32_t checksum = 0;
+    out_sample.begin();
+    for (uint8_t g = 0; g < in_games; ++g)
+    {
+        hoops.reset();
+        for (uint32_t t = 0; ; ++t)
+        {
+            ++calls;
+            if (hoops.update(t) == Hoops::MVP_GAME_OVER) break;
+            checksum += hoops.get_curr_pattern();
+        }
+    }
+    out_sample.end();
+
+    out_sample.ops = calls;
+    out_sample.add_count("updates_per_game", static_cast<double>(calls) / in_games);
+    g_sink = checksum;
+}
+
+void bench_mvp_16(Sample& out_sample) { run_mvp_update<3>(out_sample, 16, 64); }
+void bench_mvp_64(Sample& out_sample) { run_mvp_update<3>(out_sample, 64, 16); }
+void bench_mvp_255(Sample& out_sample) { run_mvp_update<3>(out_sample, 255, 4); }
+void bench_mvp_255_15_hoops(Sample& out_sample) { run_mvp_update<15>(out_sample, 255, 4); }
+// mvp_update (end)
+
+
+// timer_wheel (start)
+const uint32_t TIMER_TICK_MS = 10;
+const uint32_t TIMER_TICKS = 4000;                  // 40 s of ticks
+const uint32_t TIMER_START_MS = UINT32_MAX - 20000; // The millis() overflow comes half way
+const uint16_t TIMER_WHEEL_SLOTS = 64;              // 640 ms per turn, most delays take several turns
+
+// Linear scan reference: a Timer per callback and every tick checks all of them
+template<uint16_t CAPACITY>
+class TimerScan
+{
+    struct Entry
+    {
+        void (*callback)(void* in_ctx); // nullptr while the entry is free
+        void* ctx;
+        Timer timer;
+        uint32_t delay;
+        uint32_t period;
+    };
+
+    Entry m_entries[CAPACITY];
+    uint16_t m_free[CAPACITY];
+    uint16_t m_num_free;
+
+public:
+    TimerScan() : m_num_free(CAPACITY)
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            m_entries[i].callback = nullptr;
+            m_free[i] = CAPACITY - 1 - i;
+        }
+    }
+
+    uint16_t schedule(uint32_t in_now, uint32_t in_delay_ms, void (*in_callback)(void*), void* in_ctx, uint32_t in_period_ms)
+    {
+        if (!m_num_free) return 0xFFFF;
+
+        uint16_t id = m_free[--m_num_free];
+        Entry& entry = m_entries[id];
+        entry.callback = in_callback;
+        entry.ctx = in_ctx;
+        entry.timer.reset(in_now);
+        entry.delay = in_delay_ms;
+        entry.period = in_period_ms;
+        return id;
+    }
+
+    bool cancel(uint16_t in_id)
+    {
+        if (in_id >= CAPACITY || !m_entries[in_id].callback) return false;
+        m_entries[in_id].callback = nullptr;
+        m_free[m_num_free++] = in_id;
+        return true;
+    }
+
+    uint16_t tick(uint32_t in_now)
+    {
+        uint16_t fired = 0;
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            Entry& entry = m_entries[i];
+            if (!entry.callback || entry.timer.get_elapsed_time(false, in_now) < entry.delay) continue;
+
+            void (*callback)(void*) = entry.callback;
+            if (entry.period)
+            {
+                entry.timer.reset(in_now);
+                entry.delay = entry.period;
+            }
+            else
+            {
+                cancel(i);
+            }
+            callback(entry.ctx);
+            ++fired;
+        }
+        return fired;
+    }
+};
+
+// One per scripted timer, the callback context
+struct TimerHandle
+{
+    uint16_t id;
+    uint32_t period;   // 0 for one-shot timers
+    uint32_t due_tick; // First tick at or after the due time
+    bool active;
+};
+
+uint32_t g_timer_tick;     // Ticks since the start, for the callbacks
+uint32_t g_timer_off_tick; // Callbacks fired on another tick than their due one
+
+uint32_t ticks_until(uint32_t in_ms) { return (in_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS; }
+
+void on_bench_timer(void* in_ctx)
+{
+    TimerHandle* handle = static_cast<TimerHandle*>(in_ctx);
+    g_timer_off_tick += g_timer_tick != handle->due_tick;
+    if (handle->period) handle->due_tick = g_timer_tick + ticks_until(handle->period);
+    else handle->active = false;
+}
+
+// A one-shot timer (or one in four periodic) due in 10 ms to 8 s
+template<class TIMERS>
+void schedule_random(TIMERS& io_timers, XorShift32& io_rng, uint32_t in_now, TimerHandle& io_handle)
+{
+    uint32_t r = io_rng.next();
+    uint32_t delay = 10 + (r >> 4) % 8000;
+    io_handle.period = ((r & 3) == 0) ? 200 + (r >> 8) % 2800 : 0;
+    io_handle.due_tick = g_timer_tick + ticks_until(delay);
+    io_handle.id = io_timers.schedule(in_now, delay, on_bench_timer, &io_handle, io_handle.period);
+    io_handle.active = true;
+}
+
+/* CAPACITY timers with random delays of up to 8 s (a quarter of them periodic), then every 10 ms tick one random
+   timer is cancelled (when still active) and scheduled again. Both implementations are driven by the same random
+   sequence and every callback checks it fires on its due tick, across the wheel turns and the millis() overflow. */
+template<class TIMERS, uint16_t CAPACITY>
+void run_timers(Sample& out_sample)
+{
+    TIMERS* timers = new TIMERS(); // Too big for the stack with thousands of entries
+    std::vector<TimerHandle> handles(CAPACITY);
+    XorShift32 rng;
+    g_timer_tick = 0;
+    g_timer_off_tick = 0;
+
+    uint32_t scheduled = 0;
+    uint32_t cancelled = 0;
+    uint32_t fired = 0;
+    uint32_t now = TIMER_START_MS;
+
+    out_sample.begin();
+    for (uint16_t i = 0; i < CAPACITY; ++i)
+    {
+        schedule_random(*timers, rng, now, handles[i]);
+        ++scheduled;
+    }
+
+    for (g_timer_tick = 1; g_timer_tick <= TIMER_TICKS; ++g_timer_tick)
+    {
+        now += TIMER_TICK_MS;
+        fired += timers->tick(now);
+
+        TimerHandle& handle = handles[rng.next() % CAPACITY];
+        if (handle.active)
+        {
+            cancelled += timers->cancel(handle.id);
+        }
+        schedule_random(*timers, rng, now, handle);
+        ++scheduled;
+    }
+    out_sample.end();
+
+    delete timers;
+    out_sample.ops = TIMER_TICKS;
+    out_sample.add_count("scheduled", scheduled);
+    out_sample.add_count("cancelled", cancelled);
+    out_sample.add_count("fired", fired);
+    out_sample.add_count("fired_off_tick", g_timer_off_tick);
+    g_sink = fired;
+}
+
+void bench_timer_wheel_256(Sample& out_sample) { run_timers<TimerWheel<256, TIMER_WHEEL_SLOTS>, 256>(out_sample); }
+void bench_timer_scan_256(Sample& out_sample) { run_timers<TimerScan<256>, 256>(out_sample); }
+void bench_timer_wheel_4096(Sample& out_sample) { run_timers<TimerWheel<4096, TIMER_WHEEL_SLOTS>, 4096>(out_sample); }
+void bench_timer_scan_4096(Sample& out_sample) { run_timers<TimerScan<4096>, 4096>(out_sample); }
+// timer_wheel (end)
+
+
+// spsc_queue (start)
+const uint32_t QUEUE_EVENTS = 1000000;
+
+HoopEvent make_event(uint32_t in_seq)
+{
+    HoopEvent event;
+    event.hoop = in_seq % NUM_MVP_HOOPS;
+    event.micros = in_seq;
+    return event;
+}
+
+// One push and one pop per event, an ISR and loop() running at the same rate
+void bench_queue_push_pop(Sample& out_sample)
+{
+    HoopEventQueue queue;
+    HoopEvent event;
+    uint32_t checksum = 0;
+    out_sample.begin();
+    for (uint32_t i = 0; i < QUEUE_EVENTS; ++i)
+    {
+        queue.push(make_event(i));
+        if (queue.pop(event)) checksum += event.micros;
+    }
+    out_sample.end();
+
+    out_sample.ops = QUEUE_EVENTS;
+    out_sample.add_count("overflows", queue.get_overflows());
+    g_sink = checksum;
+}
+
+// Bursts filling the queue, each drained by one batch pop
+void bench_queue_burst_batch(Sample& out_sample)
+{
+    HoopEventQueue queue;
+    HoopEvent events[HOOP_EVENT_QUEUE_SIZE];
+    uint32_t checksum = 0;
+    uint32_t pops = 0;
+    out_sample.begin();
+    for (uint32_t i = 0; i < QUEUE_EVENTS; )
+    {
+        for (uint8_t j = 0; j < HOOP_EVENT_QUEUE_SIZE; ++j, ++i) queue.push(make_event(i));
+        uint8_t count = queue.pop(events, HOOP_EVENT_QUEUE_SIZE);
+        for (uint8_t j = 0; j < count; ++j) checksum += events[j].micros;
+        ++pops;
+    }
+    out_sample.end();
+
+    out_sample.ops = QUEUE_EVENTS;
+    out_sample.add_count("overflows", queue.get_overflows());
+    out_sample.add_count("events_per_pop", static_cast<double>(QUEUE_EVENTS) / pops);
+    g_sink = checksum;
+}
+
+// A std::thread as the ISR pushes every event (retrying a full queue) while this thread drains it in batches
+void bench_queue_threaded(Sample& out_sample)
+{
+    HoopEventQueue queue;
+    HoopEvent events[HOOP_EVENT_QUEUE_SIZE];
+    uint32_t received = 0;
+    uint32_t in_order = 0;
+    out_sample.begin();
+    std::thread producer([&queue]() {
+        for (uint32_t i = 0; i < QUEUE_EVENTS; ++i)
+        {
+            while (!queue.push(make_event(i))) std::this_thread::yield();
+        }
+    });
+    while (received < QUEUE_EVENTS)
+    {
+        uint8_t count = queue.pop(events, HOOP_EVENT_QUEUE_SIZE);
+        for (uint8_t j = 0; j < count; ++j) in_order += events[j].micros == received++;
+        if (!count) std::this_thread::yield();
+    }
+    producer.join();
+    out_sample.end();
+
+    out_sample.ops = QUEUE_EVENTS;
+    out_sample.add_count("events_in_order", in_order);
+    g_sink = in_order;
+}
+// spsc_queue (end)
+
+
+const Scenario SCENARIOS[] = {
+    {"loop_latency", "idle", "loop", bench_loop_idle},
+    {"loop_latency", "game_polled", "loop", bench_loop_game_polled},
+    {"loop_latency", "game_irq", "loop", bench_loop_game_irq},
+    {"check_sensors", "no_echo", "sweep", bench_sweep_no_echo},
+    {"check_sensors", "10cm", "sweep", bench_sweep_10cm},
+    {"check_sensors", "25cm", "sweep", bench_sweep_25cm},
+    {"check_sensors", "50cm", "sweep", bench_sweep_50cm},
+    {"check_sensors", "80cm", "sweep", bench_sweep_80cm},
+    {"check_sensors", "mixed", "sweep", bench_sweep_mixed},
+    {"echo_sampler", "runtime_pins", "sweep", bench_sampler_runtime},
+    {"echo_sampler", "fast_pins_1_port", "sweep", bench_sampler_fast_1_port},
+    {"echo_sampler", "fast_pins_3_ports", "sweep", bench_sampler_fast_3_ports},
+    {"filter_sensor_readings", "3_hoops", "call", bench_filter_3},
+    {"filter_sensor_readings", "8_hoops", "call", bench_filter_8},
+    {"osc_encode", "score_oscpark", "msg", bench_encode_score_park},
+    {"osc_encode", "score_template", "msg", bench_encode_score_template},
+    {"osc_encode", "mixed_oscpark", "msg", bench_encode_mixed},
+    {"osc_send", "per_field_writes", "msg", bench_send_per_field},
+    {"osc_send", "serialize_single_write", "msg", bench_send_single_write},
+    {"osc_decode", "transport_oscpark", "msg", bench_decode_park_transport},
+    {"osc_decode", "transport_oscview", "msg", bench_decode_view_transport},
+    {"osc_decode", "score_oscpark", "msg", bench_decode_park_score},
+    {"osc_decode", "score_oscview", "msg", bench_decode_view_score},
+    {"osc_decode", "mixed_oscpark", "msg", bench_decode_park_mixed},
+    {"osc_decode", "mixed_oscview", "msg", bench_decode_view_mixed},
+    {"mvp_update", "16_layouts", "update", bench_mvp_16},
+    {"mvp_update", "64_layouts", "update", bench_mvp_64},
+    {"mvp_update", "255_layouts", "update", bench_mvp_255},
+    {"mvp_update", "255_layouts_15_hoops", "update", bench_mvp_255_15_hoops},
+    {"timer_wheel", "wheel_256", "tick", bench_timer_wheel_256},
+    {"timer_wheel", "linear_scan_256", "tick", bench_timer_scan_256},
+    {"timer_wheel", "wheel_4096", "tick", bench_timer_wheel_4096},
+    {"timer_wheel", "linear_scan_4096", "tick", bench_timer_scan_4096},
+    {"spsc_queue", "push_pop", "event", bench_queue_push_pop},
+    {"spsc_queue", "burst_batch_pop", "event", bench_queue_burst_batch},
+    {"spsc_queue", "two_threads", "event", bench_queue_threaded},
+};
+
+// Runs in_scenario in_repeat times from a fresh host::reset(), keeps the fastest wall time
+void run_scenario(const Scenario& in_scenario, uint32_t in_repeat, std::vector<Metric>& out_metrics)
+{
+    Sample best;
+    for (uint32_t r = 0; r < in_repeat; ++r)
+    {
+        host::reset();
+        Sample sample;
+        in_scenario.run(sample);
+        if (r == 0 || sample.get_wall_ns() < best.get_wall_ns()) best = sample;
+    }
+    if (!best.ops) return;
+
+    Metric m;
+    m.scenario = in_scenario.name;
+    m.variant = in_scenario.variant;
+    const std::string op = in_scenario.op_unit;
+
+    m.kind = COUNT; m.better = EQUAL;
+    m.name = "ops"; m.unit = op; m.value = best.ops;
+    out_metrics.push_back(m);
+
+    if (best.has_virtual())
+    {
+        m.kind = VIRTUAL; m.better = LOWER;
+        m.name = "virtual_mean"; m.unit = "us/" + op; m.value = best.get_virtual_ns() / 1000.0 / best.ops;
+        out_metrics.push_back(m);
+        m.name = "virtual_max"; m.unit = "us"; m.value = best.get_virtual_max_ns() / 1000.0;
+        out_metrics.push_back(m);
+    }
+
+    for (size_t i = 0; i < best.counts.size(); ++i)
+    {
+        m.kind = COUNT; m.better = best.counts[i].better;
+        m.name = best.counts[i].name; m.unit = ""; m.value = best.counts[i].value;
+        out_metrics.push_back(m);
+    }
+
+    double wall_s = best.get_wall_ns() / 1e9;
+    m.kind = WALL; m.better = LOWER;
+    m.name = "wall_mean"; m.unit = "ns/" + op; m.value = static_cast<double>(best.get_wall_ns()) / best.ops;
+    out_metrics.push_back(m);
+    if (wall_s > 0.0)
+    {
+        m.better = HIGHER;
+        m.name = "wall_rate"; m.unit = op + "/s"; m.value = best.ops / wall_s;
+        out_metrics.push_back(m);
+    }
+
+    if (best.bytes)
+    {
+        m.kind = COUNT; m.better = LOWER;
+        m.name = "size"; m.unit = "bytes/" + op; m.value = static_cast<double>(best.bytes) / best.ops;
+        out_metrics.push_back(m);
+        if (wall_s > 0.0)
+        {
+            m.kind = WALL; m.better = HIGHER;
+            m.name = "wall_throughput"; m.unit = "bytes/s"; m.value = best.bytes / wall_s;
+            out_metrics.push_back(m);
+        }
+    }
+}
+
+void usage(const char* in_argv0)
+{
+    std::cerr << "Usage: " << in_argv0 << " [options]\n"
+              << "  --format json|csv     Report format (default json)\n"
+              << "  --out FILE            Write the report to FILE instead of stdout\n"
+              << "  --filter TEXT         Only the scenarios whose \"scenario/variant\" contains TEXT\n"
+              << "  --repeat N            Runs of each scenario, the fastest wall time is kept (default 5)\n"
+              << "  --baseline FILE       Compare with a CSV report, exit with 1 on regressions\n"
+              << "  --tolerance PCT       Allowed change from the baseline in percent (default 5)\n"
+              << "  --compare-wall        Also compare the wall-clock metrics (same machine only)\n"
+              << "  --list                List the scenarios\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string format = "json";
+    std::string out_path;
+    std::string filter;
+    std::string baseline_path;
+    uint32_t repeat = 5;
+    double tolerance = 5.0;
+    bool compare_wall = false;
+    const size_t count = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--format" && has_value) format = argv[++i];
+        else if (arg == "--out" && has_value) out_path = argv[++i];
+        else if (arg == "--filter" && has_value) filter = argv[++i];
+        else if (arg == "--repeat" && has_value) repeat = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--baseline" && has_value) baseline_path = argv[++i];
+        else if (arg == "--tolerance" && has_value) tolerance = atof(argv[++i]);
+        else if (arg == "--compare-wall") compare_wall = true;
+        else if (arg == "--list")
+        {
+            for (size_t s = 0; s < count; ++s) std::cout << SCENARIOS[s].name << "/" << SCENARIOS[s].variant << "\n";
+            return 0;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((format != "json" && format != "csv") || repeat == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Metric> metrics;
+    for (size_t s = 0; s < count; ++s)
+    {
+        std::string key = std::string(SCENARIOS[s].name) + "/" + SCENARIOS[s].variant;
+        if (!filter.empty() && key.find(filter) == std::string::npos) continue;
+        std::cerr << "running  " << key << "\n";
+        run_scenario(SCENARIOS[s], repeat, metrics);
+    }
+    host::reset();
+
+    std::ofstream file;
+    if (!out_path.empty())
+    {
+        file.open(out_path.c_str());
+        if (!file)
+        {
+            std::cerr << "Can't write " << out_path << "\n";
+            return 2;
+        }
+    }
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    out.precision(6);
+    if (format == "json") write_json(out, metrics, repeat);
+    else write_csv(out, metrics);
+
+    if (!baseline_path.empty())
+    {
+        std::map<std::string, double> baseline;
+        if (!read_baseline(baseline_path, baseline))
+        {
+            std::cerr << "Can't read " << baseline_path << "\n";
+            return 2;
+        }
+        std::cerr.precision(6);
+        uint32_t regressions = compare_baseline(metrics, baseline, tolerance / 100.0, compare_wall);
+        std::cerr << regressions << " regression(s) beyond " << tolerance << "%\n";
+        return regressions ? 1 : 0;
+    }
+    return 0;
+}
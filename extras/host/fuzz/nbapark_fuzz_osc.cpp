@@ -0,0 +1,352 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Fuzz target of the OSC receive path: every input goes through OSCView::parse() and, when valid, every
+                accessor of every argument, through OSCPark::init() (over a zero-padded copy, as a receive buffer, its
+                address and string reads look ahead of the packet end) followed by add_blob() of an input-chosen size,
+                through OSCBundleReader (nested bundles included) and through SLIPDecoder, with each decoded frame
+                parsed again.
+                Built with clang it is a libFuzzer target (-fsanitize=fuzzer). With other compilers
+                NBAPARK_FUZZ_STANDALONE adds a main() that runs files or stdin (AFL, crash reproduction) or mutates
+                built-in seed packets for a number of runs, still under ASan/UBSan.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+const uint8_t MAX_BUNDLE_DEPTH = 4;
+
+volatile uint32_t g_sink; // Keeps the accessor results alive
+
+// Reads every argument of a received message (OSCView or OSCPark), so ASan sees any access outside it
+template<class MSG>
+uint32_t touch_args(const MSG& in_msg)
+{
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i <= in_msg.get_arg_count(); ++i) // One past the last argument too
+    {
+        sum += in_msg.get_arg_type(i);
+        sum += static_cast<uint32_t>(in_msg.get_int(i));
+        sum += static_cast<uint32_t>(in_msg.get_int64(i));
+        sum += in_msg.get_bool(i);
+        float f = in_msg.get_float(i);
+        double d = in_msg.get_double(i);
+        sum += (f == f) + (d == d);
+
+        const char* str = in_msg.get_str(i);
+        if (str) sum += strlen(str);
+
+        uint16_t blob_len = 0;
+        const uint8_t* blob = in_msg.get_blob(i, blob_len);
+        for (uint16_t j = 0; blob && j < blob_len; ++j) sum += blob[j];
+
+        uint32_t seconds, fraction;
+        if (in_msg.get_timetag(i, seconds, fraction)) sum += seconds ^ fraction;
+    }
+    return sum;
+}
+
+void touch_view(const OSCView& in_view)
+{
+    uint32_t sum = strlen(in_view.get_addr()) + in_view.get_addr_len() + strlen(in_view.get_type());
+    sum += in_view.addr_equals(RESOLUME_MVPGAME_ADDRESS) + in_view.addr_equals("/");
+    g_sink = sum + touch_args(in_view);
+}
+
+// OSCPark::init() and add_blob() (start)
+const size_t INIT_READ_AHEAD = OSC_MAX_ADDRESS_LEN + 16; // Address, type tag and string reads past the packet end
+uint8_t s_blob_source[0xFFFF];
+
+/* init() over the packet, then add_blob() with the size in the first two bytes of the input: a blob is only added when
+   it fits the storage, and what was extracted under an OSC address serializes back to a packet OSCView accepts. */
+void fuzz_park(const uint8_t* in_data, size_t in_len)
+{
+    std::vector<uint8_t> padded(in_len + INIT_READ_AHEAD, 0);
+    if (in_len) memcpy(padded.data(), in_data, in_len);
+
+    OSCPark msg;
+    bool complete = msg.init(padded.data(), in_len);
+    g_sink = strlen(msg.get_addr()) + strlen(msg.get_type()) + complete + touch_args(msg);
+
+    uint16_t blob_len = in_len >= 2 ? (in_data[0] << 8) | in_data[1] : 0;
+    uint8_t arg_count = msg.get_arg_count();
+    if (msg.add_blob(s_blob_source, blob_len))
+    {
+        uint16_t stored_len = 0;
+        if (msg.get_arg_count() != arg_count + 1 || !msg.get_blob(arg_count, stored_len) || stored_len != blob_len) __builtin_trap();
+    }
+    else if (msg.get_arg_count() != arg_count)
+    {
+        __builtin_trap();
+    }
+
+    std::vector<uint8_t> packet(msg.serialized_size());
+    if (msg.serialize(packet.data(), packet.size()) != packet.size()) __builtin_trap();
+    if (msg.get_addr()[0] != '/') return; // A bundle or garbage, init() still takes its first string as the address
+
+    OSCView view;
+    if (!view.parse(packet.data(), packet.size()) || view.get_arg_count() != msg.get_arg_count()) __builtin_trap();
+}
+// OSCPark::init() and add_blob() (end)
+
+// A bundle element is a message or a bundle itself
+void fuzz_packet(const uint8_t* in_data, size_t in_len, uint8_t in_depth)
+{
+    OSCView view;
+    if (view.parse(in_data, in_len)) touch_view(view);
+
+    if (in_depth >= MAX_BUNDLE_DEPTH || !OSCBundleReader::is_bundle(in_data, in_len)) return;
+
+    OSCBundleReader reader(in_data, in_len);
+    g_sink = reader.get_timetag_seconds() ^ reader.get_timetag_fraction();
+    for (uint8_t pass = 0; pass < 2; ++pass)
+    {
+        const uint8_t* element;
+        size_t element_len;
+        while (reader.next(element, element_len))
+        {
+            if (element < in_data || element + element_len > in_data + in_len) __builtin_trap(); // Outside the packet
+            fuzz_packet(element, element_len, in_depth + 1);
+        }
+        reader.rewind();
+    }
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* in_data, size_t in_len)
+{
+    fuzz_packet(in_data, in_len, 0);
+    fuzz_park(in_data, in_len);
+
+    // The same bytes as a serial stream, fed in two chunks
+    uint8_t frame_buffer[OSC_MAX_PACKET_LEN];
+    SLIPDecoder decoder(frame_buffer, sizeof(frame_buffer));
+    const size_t chunk_ends[2] = {in_len / 2, in_len};
+    size_t pos = 0;
+    for (uint8_t c = 0; c < 2; ++c)
+    {
+        while (pos < chunk_ends[c])
+        {
+            bool frame;
+            pos += decoder.feed(in_data + pos, chunk_ends[c] - pos, frame);
+            if (!frame) continue;
+
+            // Parse a copy of the exact frame size, so reads past the frame are caught too
+            std::vector<uint8_t> copy(decoder.get_frame(), decoder.get_frame() + decoder.get_frame_len());
+            fuzz_packet(copy.data(), copy.size(), 0);
+        }
+    }
+    return 0;
+}
+
+
+#if defined(NBAPARK_FUZZ_STANDALONE)
+// Standalone driver (start)
+namespace
+{
+struct XorShift32
+{
+    uint32_t state;
+    XorShift32() : state(2463534242u) {}
+    uint32_t next() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; }
+};
+
+// Valid packets of every argument type, a bundle, a nested bundle and a SLIP stream
+std::vector<std::vector<uint8_t> > make_seeds()
+{
+    std::vector<std::vector<uint8_t> > seeds;
+    uint8_t buffer[OSC_MAX_PACKET_LEN];
+
+    OSCPark msg(RESOLUME_SCORE_ADDRESS);
+    msg.set_string("1234");
+    seeds.push_back(std::vector<uint8_t>(buffer, buffer + msg.serialize(buffer, sizeof(buffer))));
+
+    msg.init(RESOLUME_MVPGAME_ADDRESS);
+    msg.set_float(0.5f);
+    seeds.push_back(std::vector<uint8_t>(buffer, buffer + msg.serialize(buffer, sizeof(buffer))));
+
+    const uint8_t blob[6] = {0xC0, 0xDB, 0, 1, 2, 3};
+    msg.init("/mvp/all");
+    msg.add_int(-7);
+    msg.add_string("hoop");
+    msg.add_blob(blob, sizeof(blob));
+    msg.add_int64(1LL << 40);
+    msg.add_double(2.5);
+    msg.add_timetag(1, 2);
+    msg.add_bool(true);
+    msg.add_nil();
+    seeds.push_back(std::vector<uint8_t>(buffer, buffer + msg.serialize(buffer, sizeof(buffer))));
+
+    msg.init("/mvp/rst");
+    seeds.push_back(std::vector<uint8_t>(buffer, buffer + msg.serialize(buffer, sizeof(buffer))));
+
+    // A blob size whose padded length used to wrap the uint16_t argument size in OSCPark::add_blob()
+    const uint8_t wrapping_blob[12] = {'/', 'x', 0, 0, ',', 'b', 0, 0, 0x00, 0x00, 0xFF, 0xFA};
+    seeds.push_back(std::vector<uint8_t>(wrapping_blob, wrapping_blob + sizeof(wrapping_blob)));
+
+    uint8_t inner[64];
+    OSCBundleWriter inner_bundle(inner, sizeof(inner));
+    inner_bundle.add(msg);
+    uint8_t outer[256];
+    OSCBundleWriter bundle(outer, sizeof(outer), 3, 4);
+    msg.init(RESOLUME_MVPWAIT_ADDRESS);
+    msg.set_int(1);
+    bundle.add(msg);
+    seeds.push_back(std::vector<uint8_t>(outer, outer + bundle.get_size()));
+    bundle.add(inner_bundle.get_buffer(), inner_bundle.get_size());
+    seeds.push_back(std::vector<uint8_t>(outer, outer + bundle.get_size()));
+
+    host::CapturePrint serial;
+    SLIPEncoder slip(serial);
+    slip.send(seeds[2].data(), seeds[2].size());
+    slip.send(seeds[0].data(), seeds[0].size());
+    seeds.push_back(serial.get_data());
+    return seeds;
+}
+
+// Bit flips, OSC-significant bytes, inserted/removed bytes, big-endian sizes and truncation
+void mutate(XorShift32& io_rng, std::vector<uint8_t>& io_data)
+{
+    static const uint8_t INTERESTING[] = {0x00, 0xFF, 0x7F, 0x80, ',', '/', '#', 's', 'b', 'i', SLIP_END, SLIP_ESC};
+    uint32_t count = 1 + io_rng.next() % 8;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        size_t pos = io_data.empty() ? 0 : io_rng.next() % io_data.size();
+        switch (io_rng.next() % 6)
+        {
+            case 0:
+                if (!io_data.empty()) io_data[pos] ^= 1 << (io_rng.next() % 8);
+                break;
+            case 1:
+                if (!io_data.empty()) io_data[pos] = INTERESTING[io_rng.next() % sizeof(INTERESTING)];
+                break;
+            case 2:
+                io_data.insert(io_data.begin() + pos, static_cast<uint8_t>(io_rng.next()));
+                break;
+            case 3:
+                if (!io_data.empty()) io_data.erase(io_data.begin() + pos);
+                break;
+            case 4:
+                if (io_data.size() >= 4)
+                {
+                    pos &= ~static_cast<size_t>(3);
+                    if (pos + 4 > io_data.size()) pos = io_data.size() - 4;
+                    osc_write_be32(&io_data[pos], io_rng.next() % 0x120);
+                }
+                break;
+            default:
+                io_data.resize(pos);
+                break;
+        }
+    }
+}
+
+// Runs the target on a heap copy of the exact size, as libFuzzer does
+void run_input(const std::vector<uint8_t>& in_data)
+{
+    uint8_t* copy = new uint8_t[in_data.size() ? in_data.size() : 1];
+    if (!in_data.empty()) memcpy(copy, in_data.data(), in_data.size());
+    LLVMFuzzerTestOneInput(copy, in_data.size());
+    delete[] copy;
+}
+
+bool read_file(const std::string& in_path, std::vector<uint8_t>& out_data)
+{
+    std::ifstream file(in_path.c_str(), std::ios::binary);
+    if (!file) return false;
+    out_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int usage()
+{
+    std::cerr << "usage: nbapark_fuzz_osc [FILE|DIR]...        run each input (stdin if none, e.g. under AFL)\n"
+                 "       nbapark_fuzz_osc --mutate RUNS         mutate the built-in seeds RUNS times\n"
+                 "       nbapark_fuzz_osc --write-seeds DIR     write the built-in seeds as a corpus\n";
+    return 2;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (args.size() == 2 && args[0] == "--mutate")
+    {
+        std::vector<std::vector<uint8_t> > seeds = make_seeds();
+        uint32_t runs = strtoul(args[1].c_str(), nullptr, 10);
+        XorShift32 rng;
+        for (size_t i = 0; i < seeds.size(); ++i) run_input(seeds[i]);
+        for (uint32_t r = 0; r < runs; ++r)
+        {
+            std::vector<uint8_t> data = seeds[rng.next() % seeds.size()];
+            mutate(rng, data);
+            run_input(data);
+        }
+        std::cout << "nbapark_fuzz_osc: " << runs << " mutated inputs from " << seeds.size() << " seeds\n";
+        return 0;
+    }
+
+    if (args.size() == 2 && args[0] == "--write-seeds")
+    {
+        std::vector<std::vector<uint8_t> > seeds = make_seeds();
+        for (size_t i = 0; i < seeds.size(); ++i)
+        {
+            std::string path = args[1] + "/seed_" + std::to_string(i);
+            std::ofstream file(path.c_str(), std::ios::binary);
+            file.write(reinterpret_cast<const char*>(seeds[i].data()), seeds[i].size());
+            if (!file) return 1;
+        }
+        return 0;
+    }
+
+    if (args.empty())
+    {
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        run_input(data);
+        return 0;
+    }
+
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        if (args[i].compare(0, 2, "--") == 0) return usage();
+
+        std::vector<std::string> paths;
+        if (DIR* dir = opendir(args[i].c_str()))
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                if (entry->d_name[0] != '.') paths.push_back(args[i] + "/" + entry->d_name);
+            }
+            closedir(dir);
+        }
+        else
+        {
+            paths.push_back(args[i]);
+        }
+
+        for (size_t p = 0; p < paths.size(); ++p)
+        {
+            std::vector<uint8_t> data;
+            if (!read_file(paths[p], data))
+            {
+                std::cerr << "nbapark_fuzz_osc: can't read " << paths[p] << "\n";
+                return 1;
+            }
+            run_input(data);
+        }
+    }
+    return 0;
+}
+// Standalone driver (end)
+#endif
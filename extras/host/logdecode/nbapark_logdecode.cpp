@@ -0,0 +1,150 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Decoder of the DeferredLog records in a capture of DEBUG_OUTPUT (a serial terminal log file or a live
+                port, e.g. nbapark_logdecode /dev/ttyACM0). Record frames are printed as text with the formats of
+                NBAPARK_LOG_FORMATS, everything else (debugSkt()/debugLib() text) is passed through as it is.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <NBAPark.h>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t in_byte) { return fputc(in_byte, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* in_buffer, size_t in_len) { return fwrite(in_buffer, 1, in_len, stdout); }
+    using Print::write;
+};
+
+// Longest SLIP encoded record, a longer run starting with LOG_FRAME_MAGIC isn't a record
+const size_t MAX_FRAME_BYTES = 2 * (1 + LOG_MAX_RECORD_LEN);
+
+/* Text is written as soon as it is read. After a SLIP_END, a LOG_FRAME_MAGIC byte starts a record frame that is kept
+   until its closing SLIP_END, then decoded or, if it isn't a valid record, written as it is. */
+class LogDecoder
+{
+    enum State
+    {
+        TEXT,
+        FRAME_START, // Right after a SLIP_END
+        RECORD
+    };
+
+    StdoutPrint m_out;
+    State m_state;
+    std::vector<uint8_t> m_frame;
+    uint8_t m_slip_buffer[1 + LOG_MAX_RECORD_LEN];
+    SLIPDecoder m_slip;
+    unsigned long m_records;
+    unsigned long m_invalid;
+
+public:
+    LogDecoder() : m_state(TEXT), m_slip(m_slip_buffer, sizeof(m_slip_buffer)), m_records(0), m_invalid(0) {}
+
+    void feed(uint8_t in_byte)
+    {
+        switch (m_state)
+        {
+            case TEXT:
+                if (in_byte == SLIP_END) m_state = FRAME_START;
+                else m_out.write(in_byte);
+                break;
+            case FRAME_START:
+                if (in_byte == SLIP_END) break;
+                if (in_byte == LOG_FRAME_MAGIC)
+                {
+                    m_frame.assign(1, in_byte);
+                    m_state = RECORD;
+                }
+                else
+                {
+                    m_out.write(in_byte);
+                    m_state = TEXT;
+                }
+                break;
+            case RECORD:
+                if (in_byte == SLIP_END)
+                {
+                    decode_frame();
+                    m_state = FRAME_START;
+                }
+                else
+                {
+                    m_frame.push_back(in_byte);
+                    if (m_frame.size() > MAX_FRAME_BYTES)
+                    {
+                        write_raw();
+                        m_state = TEXT;
+                    }
+                }
+                break;
+        }
+    }
+
+    void finish()
+    {
+        if (m_state == RECORD) write_raw();
+        fflush(stdout);
+    }
+
+    unsigned long get_records() const { return m_records; }
+    unsigned long get_invalid() const { return m_invalid; }
+
+private:
+    void decode_frame()
+    {
+        m_slip.reset();
+        for (size_t i = 0; i < m_frame.size(); ++i) m_slip.feed(m_frame[i]);
+        bool complete = m_slip.feed(SLIP_END);
+
+        if (complete && log_print_record(m_out, m_slip.get_frame(), m_slip.get_frame_len()))
+        {
+            ++m_records;
+            return;
+        }
+        write_raw();
+    }
+
+    void write_raw()
+    {
+        ++m_invalid;
+        m_out.write(m_frame.data(), m_frame.size());
+        m_frame.clear();
+    }
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [capture file or serial port, stdin by default]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* in = (argc == 2) ? fopen(argv[1], "rb") : stdin;
+    if (!in)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+
+    LogDecoder decoder;
+    int c;
+    while ((c = fgetc(in)) != EOF)
+    {
+        decoder.feed(static_cast<uint8_t>(c));
+        if (c == '\n' || c == SLIP_END) fflush(stdout);
+    }
+    decoder.finish();
+    if (in != stdin) fclose(in);
+
+    fprintf(stderr, "%lu records decoded, %lu invalid frames\n", decoder.get_records(), decoder.get_invalid());
+    return 0;
+}
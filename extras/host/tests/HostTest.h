@@ -0,0 +1,45 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Minimal check macros for the host tests in this folder (run by ctest). A failed CHECK prints its location
+                and the test keeps going, HOST_TEST_END returns the exit code (1 if any check failed).
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#ifndef NBAPARK_HOST_TEST_H
+#define NBAPARK_HOST_TEST_H
+
+#include <stdio.h>
+
+namespace host_test
+{
+inline unsigned& failures()
+{
+    static unsigned s_failures = 0;
+    return s_failures;
+}
+
+inline bool check(bool in_ok, const char* in_expr, const char* in_file, int in_line)
+{
+    if (!in_ok)
+    {
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", in_file, in_line, in_expr);
+        ++failures();
+    }
+    return in_ok;
+}
+
+inline int end(const char* in_name)
+{
+    if (failures()) fprintf(stderr, "%s: %u check(s) failed\n", in_name, failures());
+    else printf("%s: passed\n", in_name);
+    return failures() ? 1 : 0;
+}
+} // namespace host_test
+
+#define CHECK(cond) host_test::check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) host_test::check(((a) > (b) ? (a) - (b) : (b) - (a)) <= (tolerance), #a " ~ " #b, __FILE__, __LINE__)
+#define HOST_TEST_END(name) return host_test::end(name)
+
+#endif // NBAPARK_HOST_TEST_H
@@ -0,0 +1,115 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host test of the async mode of BasketSensor through a MultipleHoops-like loop (delay(10) between
+                passes): with the echo interrupt attached it must detect as the blocking mode does and measure the
+                distance exactly, whatever the loop period, and keep its pings BALL_DETECTION_PING_INTERVAL apart
+                however fast ball_detected() is called.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+
+namespace
+{
+const uint8_t TRIG_PIN = 2;
+const uint8_t ECHO_PIN = 3;
+const uint32_t ECHO_LATENCY_US = 300;
+
+struct LoopResult
+{
+    uint32_t detections;
+    float last_distance;
+};
+
+// in_loops passes of ball_detected() with in_loop_us of other work (delay) between them
+LoopResult run_loop(BasketSensor& in_sensor, float in_distance_cm, uint32_t in_loops, uint32_t in_loop_us)
+{
+    host::set_echo_responder(TRIG_PIN, ECHO_PIN, in_distance_cm, ECHO_LATENCY_US);
+
+    LoopResult result = {0, -1};
+    for (uint32_t i = 0; i < in_loops; ++i)
+    {
+        if (in_sensor.ball_detected()) ++result.detections;
+        result.last_distance = in_sensor.get_last_distance(); // Only changes when a measurement completes
+        delayMicroseconds(in_loop_us);
+    }
+    return result;
+}
+} // namespace
+
+int main()
+{
+    // Blocking reference, 200 passes of the MultipleHoops loop
+    host::reset();
+    BasketSensor sync_sensor(TRIG_PIN, ECHO_PIN);
+    LoopResult sync = run_loop(sync_sensor, 10, 200, 10000);
+    CHECK(sync.detections >= 4);
+
+    // Async with the echo interrupt, same loop
+    host::reset();
+    BasketSensor irq_sensor(TRIG_PIN, ECHO_PIN);
+    CHECK(irq_sensor.attach_interrupt());
+    CHECK(irq_sensor.is_irq_mode());
+    irq_sensor.set_async(true);
+    LoopResult irq = run_loop(irq_sensor, 10, 200, 10000);
+    CHECK(irq.detections == sync.detections);
+    CHECK_NEAR(irq.last_distance, 10.0f, 0.05f);
+
+    // A fast loop doesn't change the measured distance
+    irq = run_loop(irq_sensor, 10, 2000, 300);
+    CHECK(irq.detections > 0);
+    CHECK_NEAR(irq.last_distance, 10.0f, 0.05f);
+
+    // Farther than the threshold: measured, not detected
+    irq = run_loop(irq_sensor, 45, 200, 1000);
+    CHECK(irq.detections == 0);
+    CHECK_NEAR(irq.last_distance, 45.0f, 0.05f);
+
+    // No echo: every measurement times out
+    irq = run_loop(irq_sensor, -1, 50, 1000);
+    CHECK(irq.detections == 0);
+    CHECK(irq.last_distance < 0);
+
+    irq_sensor.detach_interrupt();
+    CHECK(!irq_sensor.is_irq_mode());
+
+    // Without the interrupt the echo is sampled by update(), which needs a loop much faster than the echo width
+    host::reset();
+    BasketSensor sampled_sensor(TRIG_PIN, ECHO_PIN);
+    sampled_sensor.set_async(true);
+    LoopResult sampled = run_loop(sampled_sensor, 10, 20000, 20);
+    CHECK(sampled.detections > 0);
+    CHECK_NEAR(sampled.last_distance, 10.0f, 0.5f);
+
+    // Pins without an external interrupt can't be attached
+    host::set_interrupt_capable(ECHO_PIN, false);
+    CHECK(!sampled_sensor.attach_interrupt());
+
+    // Back-to-back calls, with the interrupt and sampled: the pings stay BALL_DETECTION_PING_INTERVAL apart
+    for (uint8_t irq = 0; irq < 2; ++irq)
+    {
+        host::reset();
+        BasketSensor spaced_sensor(TRIG_PIN, ECHO_PIN);
+        if (irq) CHECK(spaced_sensor.attach_interrupt());
+        spaced_sensor.set_async(true);
+        spaced_sensor.set_cooldown_time(0);
+        host::set_echo_responder(TRIG_PIN, ECHO_PIN, 10, ECHO_LATENCY_US);
+
+        const uint64_t run_ns = 1000000000ULL; // 1 s
+        uint32_t detections = 0;
+        while (host::now_ns() < run_ns) detections += spaced_sensor.ball_detected();
+
+        uint32_t expected = run_ns / (BALL_DETECTION_PING_INTERVAL * 1000ULL);
+        CHECK(host::get_min_trigger_gap_us(TRIG_PIN) >= BALL_DETECTION_PING_INTERVAL);
+        CHECK(host::get_echo_triggers(TRIG_PIN) >= expected && host::get_echo_triggers(TRIG_PIN) <= expected + 1);
+        CHECK(detections + 1 >= expected);
+        CHECK_NEAR(spaced_sensor.get_last_distance(), 10.0f, irq ? 0.05f : 0.5f);
+        spaced_sensor.detach_interrupt();
+    }
+
+    HOST_TEST_END("test_async_sensor");
+}
@@ -0,0 +1,116 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host test of the interrupt mode of BasketSensorArray: the echo ISRs, driven by the HostHAL echo
+                responders through attachInterrupt(), must measure the same echo widths and patterns as the polling
+                check_sensors(), without blocking in trigger()/poll().
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+
+namespace
+{
+const uint8_t TRIG_PINS[3] = {2, 4, 6};
+const uint8_t ECHO_PINS[3] = {3, 18, 19};
+const uint32_t ECHO_LATENCY_US = 300; // HC-SR04 delay between the trigger pulse and the echo
+
+// Echo widths of the last sweep, read back from the packet written by SensorTrace::send()
+bool read_sweep(SensorTrace& in_trace, uint32_t* out_widths)
+{
+    host::CapturePrint packet;
+    if (in_trace.send(packet) != 3) return false;
+
+    const std::vector<uint8_t>& data = packet.get_data();
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        const uint8_t* event = data.data() + TRACE_HEADER_LEN + i * TRACE_EVENT_LEN;
+        if (event[6] != TRACE_SWEEP || event[7] != i) return false;
+        out_widths[i] = event[4] | (event[5] << 8);
+    }
+    return true;
+}
+
+void set_distances(const float* in_distances_cm)
+{
+    for (uint8_t i = 0; i < 3; ++i) host::set_echo_responder(TRIG_PINS[i], ECHO_PINS[i], in_distances_cm[i], ECHO_LATENCY_US);
+}
+} // namespace
+
+int main()
+{
+    // Each sweep: the three objects distances in cm, <= 0 is no echo (timeout)
+    const float sweeps[][3] = {
+        {10, 20, 40}, {5, 29, 31}, {15, 15, 15}, {-1, 12, 70}, {25, -1, -1}, {-1, -1, -1}, {3, 45, 28}
+    };
+    const uint8_t num_sweeps = sizeof(sweeps) / sizeof(sweeps[0]);
+
+    host::reset();
+    ThreeBasketSensors sensors(TRIG_PINS, ECHO_PINS);
+    SensorTrace trace;
+    sensors.set_trace(&trace);
+
+    // Polling reference
+    uint32_t poll_widths[num_sweeps][3];
+    BitmapPattern poll_patterns[num_sweeps];
+    for (uint8_t s = 0; s < num_sweeps; ++s)
+    {
+        set_distances(sweeps[s]);
+        poll_patterns[s] = sensors.check_sensors();
+        CHECK(read_sweep(trace, poll_widths[s]));
+        host::advance_micros(10000);
+    }
+
+    // Interrupt mode
+    CHECK(sensors.attach_interrupts());
+    CHECK(sensors.is_irq_mode());
+    for (uint8_t s = 0; s < num_sweeps; ++s)
+    {
+        set_distances(sweeps[s]);
+        CHECK(sensors.trigger());
+        CHECK(!sensors.trigger()); // Sweep already in flight
+
+        // Each call returns right away, the loop keeps running while the echoes are in flight
+        BitmapPattern pattern = BitmapPattern::LAYOUT_STOP;
+        uint32_t polls = 0;
+        uint64_t start_ns = host::now_ns();
+        while (!sensors.poll(pattern))
+        {
+            ++polls;
+            host::advance_micros(100);
+            CHECK(host::now_ns() - start_ns < 2ULL * BALL_DETECTION_TIMEOUT * 1000);
+            if (host::now_ns() - start_ns >= 2ULL * BALL_DETECTION_TIMEOUT * 1000) break;
+        }
+        CHECK(polls > 0);
+        CHECK(pattern == poll_patterns[s]);
+
+        uint32_t irq_widths[3];
+        CHECK(read_sweep(trace, irq_widths));
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            uint32_t expected = (sweeps[s][i] > 0) ? host::echo_width_us(sweeps[s][i]) : 0;
+
+            // The ISR timestamps the edges themselves, polling is off by up to one sampling pass
+            CHECK_NEAR(irq_widths[i], expected, 10U);
+            CHECK_NEAR(poll_widths[s][i], irq_widths[i], 60U);
+            CHECK((poll_widths[s][i] == 0) == (irq_widths[i] == 0));
+        }
+        host::advance_micros(10000);
+    }
+
+    // Every echo edge went through the ISRs
+    for (uint8_t i = 0; i < 3; ++i) CHECK(host::get_interrupt_count(digitalPinToInterrupt(ECHO_PINS[i])) > 0);
+
+    // Pins without an external interrupt can't be attached (e.g. an Uno with the echoes on pins 18 and 19)
+    sensors.detach_interrupts();
+    CHECK(!sensors.is_irq_mode());
+    CHECK(!sensors.trigger());
+    host::set_interrupt_capable(ECHO_PINS[1], false);
+    CHECK(!sensors.attach_interrupts());
+    CHECK(!sensors.is_irq_mode());
+
+    HOST_TEST_END("test_echo_irq");
+}
@@ -0,0 +1,117 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host test of FastThreeBasketSensors against ThreeBasketSensors::check_sensors(): on the same pins and
+                the same random object distances, the port-register sampling must give the same patterns and echo
+                widths as the digitalRead() sampling, with one port or three.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+
+namespace
+{
+const uint8_t TRIG_PINS[3] = {8, 9, 10};
+const uint32_t ECHO_LATENCY_US = 300; // HC-SR04 delay between the trigger pulse and the echo
+const uint32_t SWEEPS = 500;
+
+// Echo widths of the last sweep, read back from the packet written by SensorTrace::send()
+bool read_sweep(SensorTrace& in_trace, uint32_t* out_widths)
+{
+    host::CapturePrint packet;
+    if (in_trace.send(packet) != 3) return false;
+
+    const std::vector<uint8_t>& data = packet.get_data();
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        const uint8_t* event = data.data() + TRACE_HEADER_LEN + i * TRACE_EVENT_LEN;
+        if (event[6] != TRACE_SWEEP || event[7] != i) return false;
+        out_widths[i] = event[4] | (event[5] << 8);
+    }
+    return true;
+}
+
+// Each sweep places the three objects at 2..79 cm, or takes one sensor out of range (no echo)
+void random_distances(uint32_t& io_seed, float* out_distances_cm)
+{
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        io_seed = io_seed * 1664525u + 1013904223u;
+        uint32_t r = io_seed >> 8;
+        out_distances_cm[i] = (r % 8 == 0) ? -1.0f : 2.0f + (r % 7800) / 100.0f;
+    }
+}
+
+bool near_edge(float in_distance_cm, float in_edge_cm)
+{
+    return in_distance_cm > in_edge_cm - 0.5f && in_distance_cm < in_edge_cm + 0.5f;
+}
+
+template<class FAST>
+void compare(const uint8_t* in_echo_pins, uint32_t in_seed)
+{
+    host::reset();
+    ThreeBasketSensors reference(TRIG_PINS[0], TRIG_PINS[1], TRIG_PINS[2], in_echo_pins[0], in_echo_pins[1], in_echo_pins[2]);
+    FAST fast;
+    SensorTrace reference_trace;
+    SensorTrace fast_trace;
+    reference.set_trace(&reference_trace);
+    fast.set_trace(&fast_trace);
+
+    uint32_t compared = 0;
+    for (uint32_t s = 0; s < SWEEPS; ++s)
+    {
+        float distances[3];
+        random_distances(in_seed, distances);
+        bool on_edge = false;
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            host::set_echo_responder(TRIG_PINS[i], in_echo_pins[i], distances[i], ECHO_LATENCY_US);
+            on_edge |= near_edge(distances[i], 2) || near_edge(distances[i], BALL_DETECTION_THRESHOLD);
+        }
+
+        BitmapPattern reference_pattern = reference.check_sensors();
+        uint32_t reference_widths[3];
+        CHECK(read_sweep(reference_trace, reference_widths));
+        host::advance_micros(BALL_DETECTION_READ_DELAY * 1000UL);
+
+        BitmapPattern fast_pattern = fast.check_sensors();
+        uint32_t fast_widths[3];
+        CHECK(read_sweep(fast_trace, fast_widths));
+        host::advance_micros(BALL_DETECTION_READ_DELAY * 1000UL);
+
+        // Within a sampling pass of a detection edge (2 cm or the threshold) the two can land on different sides of it
+        if (!on_edge)
+        {
+            CHECK(fast_pattern == reference_pattern);
+            ++compared;
+        }
+        CHECK(fast.get_last_sample_count() > reference.get_last_sample_count());
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            uint32_t expected = (distances[i] > 0) ? host::echo_width_us(distances[i]) : 0;
+
+            // Each is off by up to one sampling pass, a digitalRead() pass is the longer one
+            CHECK_NEAR(reference_widths[i], expected, 30U);
+            CHECK_NEAR(fast_widths[i], expected, 10U);
+        }
+    }
+    CHECK(compared > SWEEPS * 9 / 10);
+}
+} // namespace
+
+int main()
+{
+    // All echoes on PD, a single register read per sample
+    const uint8_t one_port[3] = {2, 4, 6};
+    compare<FastThreeBasketSensors<8, 9, 10, 2, 4, 6> >(one_port, 1);
+
+    // Echoes on PD, PB and PC
+    const uint8_t three_ports[3] = {2, 11, 14};
+    compare<FastThreeBasketSensors<8, 9, 10, 2, 11, 14> >(three_ports, 2);
+
+    HOST_TEST_END("test_fast_sensors");
+}
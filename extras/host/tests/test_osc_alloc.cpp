@@ -0,0 +1,213 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host stress test of the OSC send and receive paths with allocation counters: one million GameMVP-like
+                messages built with OSCPark, sent through OSCOutbox and OSCBundleWriter, and read back with
+                OSCPark::init(), OSCView, OSCBundleReader and OSCRouter must not touch the heap once warmed up.
+                Every operator new is counted, and with glibc every malloc()/calloc()/realloc() as well.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+#include <new>
+
+// Allocation counters (start)
+namespace
+{
+volatile unsigned long s_new_calls = 0;
+volatile unsigned long s_malloc_calls = 0;
+} // namespace
+
+void* operator new(size_t in_size)
+{
+    ++s_new_calls;
+    void* ptr = std::malloc(in_size ? in_size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](size_t in_size) { return operator new(in_size); }
+void* operator new(size_t in_size, const std::nothrow_t&) noexcept
+{
+    ++s_new_calls;
+    return std::malloc(in_size ? in_size : 1);
+}
+void* operator new[](size_t in_size, const std::nothrow_t& in_tag) noexcept { return operator new(in_size, in_tag); }
+void operator delete(void* in_ptr) noexcept { std::free(in_ptr); }
+void operator delete[](void* in_ptr) noexcept { std::free(in_ptr); }
+void operator delete(void* in_ptr, size_t) noexcept { std::free(in_ptr); }
+void operator delete[](void* in_ptr, size_t) noexcept { std::free(in_ptr); }
+
+#if defined(__GLIBC__)
+// glibc lets the program replace malloc(), also catching the C allocations operator new doesn't see
+extern "C" void* __libc_malloc(size_t in_size);
+extern "C" void* __libc_calloc(size_t in_count, size_t in_size);
+extern "C" void* __libc_realloc(void* in_ptr, size_t in_size);
+extern "C" void __libc_free(void* in_ptr);
+
+extern "C" void* malloc(size_t in_size)
+{
+    ++s_malloc_calls;
+    return __libc_malloc(in_size);
+}
+extern "C" void* calloc(size_t in_count, size_t in_size)
+{
+    ++s_malloc_calls;
+    return __libc_calloc(in_count, in_size);
+}
+extern "C" void* realloc(void* in_ptr, size_t in_size)
+{
+    ++s_malloc_calls;
+    return __libc_realloc(in_ptr, in_size);
+}
+extern "C" void free(void* in_ptr) { __libc_free(in_ptr); }
+#endif
+// Allocation counters (end)
+
+namespace
+{
+const uint32_t MESSAGES = 1000000;
+
+// Print over a fixed buffer, as EthernetUDP between beginPacket() and endPacket()
+class PacketPrint : public Print
+{
+    uint8_t m_buffer[512];
+    size_t m_len;
+
+public:
+    PacketPrint() : m_len(0) {}
+
+    size_t write(uint8_t in_byte) { return write(&in_byte, 1); }
+    size_t write(const uint8_t* in_buffer, size_t in_len)
+    {
+        if (in_len > sizeof(m_buffer) - m_len) return 0;
+        memcpy(m_buffer + m_len, in_buffer, in_len);
+        m_len += in_len;
+        return in_len;
+    }
+    using Print::write;
+
+    const uint8_t* get_data() const { return m_buffer; }
+    size_t get_len() const { return m_len; }
+    void clear() { m_len = 0; }
+};
+
+struct Received
+{
+    uint32_t game;
+    uint32_t wait;
+};
+
+void on_game(const OSCView& in_msg, void* in_ctx) { static_cast<Received*>(in_ctx)->game += in_msg.get_float() > 0; }
+void on_wait(const OSCView& in_msg, void* in_ctx) { static_cast<Received*>(in_ctx)->wait += in_msg.get_float() > 0; }
+
+struct Stats
+{
+    uint32_t sent;
+    uint32_t mismatches;
+};
+
+/* One pass of the GameMVP traffic, 4 messages: the score string and a multi-argument message built with OSCPark and
+   posted to an OSCOutbox (flushed as a bundle), a transport message bundled by hand, then everything parsed back. */
+void run_pass(uint32_t in_pass, OSCOutbox<3>& io_outbox, OSCRouter<2>& io_router, Stats& io_stats)
+{
+    char score[12];
+    snprintf(score, sizeof(score), "%lu", static_cast<unsigned long>(in_pass % 100000));
+
+    OSCPark score_msg(RESOLUME_SCORE_ADDRESS);
+    if (!score_msg.set_string(score)) ++io_stats.mismatches;
+    io_outbox.post(score_msg);
+
+    OSCPark stats_msg("/mvp/stats");
+    const uint8_t blob[5] = {1, 2, 3, 4, 5};
+    stats_msg.add_int(static_cast<int32_t>(in_pass));
+    stats_msg.add_float(0.25f);
+    stats_msg.add_string("hoop");
+    stats_msg.add_blob(blob, sizeof(blob));
+    io_outbox.post(stats_msg);
+
+    PacketPrint packet;
+    io_stats.sent += io_outbox.flush(packet, in_pass * OSC_OUTBOX_INTERVAL);
+
+    // Copies keep their own inline storage
+    OSCPark copy(score_msg);
+    OSCPark assigned;
+    assigned = stats_msg;
+    if (strcmp(copy.get_str(), score) || assigned.get_int(0) != static_cast<int32_t>(in_pass)) ++io_stats.mismatches;
+
+    // Read the outbox bundle back
+    OSCBundleReader reader(packet.get_data(), packet.get_len());
+    const uint8_t* element;
+    size_t element_len;
+    uint16_t blob_len;
+    uint8_t elements = 0;
+    while (reader.next(element, element_len))
+    {
+        ++elements;
+        OSCView view(element, element_len);
+        OSCPark parsed(element);
+        if (!view.is_valid() || strcmp(view.get_addr(), parsed.get_addr())) ++io_stats.mismatches;
+        else if (view.addr_equals(RESOLUME_SCORE_ADDRESS) && (strcmp(view.get_str(), score) || strcmp(parsed.get_str(), score))) ++io_stats.mismatches;
+        else if (view.addr_equals("/mvp/stats") && (view.get_int(0) != parsed.get_int(0) || !view.get_blob(3, blob_len) || blob_len != sizeof(blob))) ++io_stats.mismatches;
+    }
+    if (elements != 2) ++io_stats.mismatches;
+
+    // Resolume transport messages in a bundle, dispatched through the router
+    uint8_t bundle_buffer[128];
+    OSCBundleWriter bundle(bundle_buffer, sizeof(bundle_buffer));
+    OSCPark transport((in_pass & 1) ? RESOLUME_MVPGAME_ADDRESS : RESOLUME_MVPWAIT_ADDRESS);
+    transport.set_float(0.5f);
+    bundle.add(transport);
+    transport.init(MVP_HARD_RESET_OSC);
+    transport.set_int(1);
+    bundle.add(transport);
+    io_stats.sent += bundle.get_count();
+
+    OSCBundleReader transport_reader(bundle.get_buffer(), bundle.get_size());
+    while (transport_reader.next(element, element_len))
+    {
+        OSCView view(element, element_len);
+        io_router.dispatch(view);
+    }
+}
+} // namespace
+
+int main()
+{
+    OSCOutbox<3> outbox;
+    OSCRouter<2> router;
+    Received received = {0, 0};
+    router.add(RESOLUME_MVPGAME_ADDRESS, on_game, &received);
+    router.add(RESOLUME_MVPWAIT_ADDRESS, on_wait, &received);
+    Stats stats = {0, 0};
+
+    // Warm up, then count from a clean state
+    run_pass(0, outbox, router, stats);
+    unsigned long new_calls = s_new_calls;
+    unsigned long malloc_calls = s_malloc_calls;
+
+    uint32_t pass = 1;
+    for (; stats.sent < MESSAGES; ++pass) run_pass(pass, outbox, router, stats);
+
+    new_calls = s_new_calls - new_calls;
+    malloc_calls = s_malloc_calls - malloc_calls;
+    CHECK(new_calls == 0);
+    CHECK(malloc_calls == 0);
+    CHECK(stats.mismatches == 0);
+    CHECK(received.game + received.wait == pass);
+    printf("test_osc_alloc: %lu messages, %lu operator new, %lu malloc\n", static_cast<unsigned long>(stats.sent), new_calls, malloc_calls);
+
+    // The counters do work
+    new_calls = s_new_calls;
+    malloc_calls = s_malloc_calls;
+    int* probe = new int(1);
+    CHECK(s_new_calls == new_calls + 1);
+#if defined(__GLIBC__)
+    CHECK(s_malloc_calls == malloc_calls + 1);
+#endif
+    delete probe;
+
+    HOST_TEST_END("test_osc_alloc");
+}
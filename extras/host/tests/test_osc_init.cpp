@@ -0,0 +1,88 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host test of OSCPark::init() and add_blob() on hostile sizes: a blob size near 65535 used to wrap the
+                uint16_t argument size and overflow the inline storage, and arguments running past the packet end
+                were copied from beyond it. Both must now fail cleanly and leave no argument behind.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+
+namespace
+{
+// "/x" with a blob of 65530 bytes announced, nothing after the size
+const uint8_t WRAPPING_BLOB[12] = {'/', 'x', 0, 0, ',', 'b', 0, 0, 0x00, 0x00, 0xFF, 0xFA};
+
+uint8_t s_big_blob[65535];
+
+void test_add_blob_sizes()
+{
+    OSCPark msg("/x");
+    for (uint32_t len = 65529; len <= 65535; ++len)
+    {
+        CHECK(!msg.add_blob(s_big_blob, static_cast<uint16_t>(len)));
+        CHECK(msg.get_arg_count() == 0);
+    }
+
+    // Still takes what fits the storage
+    CHECK(msg.add_blob(s_big_blob, 8));
+    uint16_t blob_len = 0;
+    CHECK(msg.get_blob(0, blob_len) && blob_len == 8);
+}
+
+void test_init_wrapping_blob()
+{
+    // Zero-padded as a receive buffer would be, so only the size check stands between init() and the overflow
+    uint8_t packet[OSC_MAX_PACKET_LEN] = {};
+    memcpy(packet, WRAPPING_BLOB, sizeof(WRAPPING_BLOB));
+
+    OSCPark msg;
+    CHECK(!msg.init(packet, sizeof(WRAPPING_BLOB)));
+    CHECK(msg.get_arg_count() == 0);
+    CHECK(strcmp(msg.get_addr(), "/x") == 0);
+
+    CHECK(!msg.init(packet)); // Length unknown
+    CHECK(msg.get_arg_count() == 0);
+
+    OSCPark constructed(packet);
+    CHECK(constructed.get_arg_count() == 0);
+}
+
+void test_init_packet_end()
+{
+    uint8_t packet[OSC_MAX_PACKET_LEN];
+    OSCPark src("/mvp/stats");
+    const uint8_t blob[6] = {1, 2, 3, 4, 5, 6};
+    src.add_int(7);
+    src.add_blob(blob, sizeof(blob));
+    src.add_float(0.5f);
+    size_t len = src.serialize(packet, sizeof(packet));
+    CHECK(len > 0);
+
+    OSCPark msg;
+    CHECK(msg.init(packet, len));
+    CHECK(msg.get_arg_count() == 3);
+    CHECK(msg.get_int(0) == 7);
+    CHECK(msg.get_float(2) == 0.5f);
+
+    // Cut inside the float, then inside the blob: the arguments before the cut are kept
+    CHECK(!msg.init(packet, len - 2));
+    CHECK(msg.get_arg_count() == 2);
+    CHECK(!msg.init(packet, len - 8));
+    CHECK(msg.get_arg_count() == 1);
+    CHECK(msg.get_int(0) == 7);
+}
+} // namespace
+
+int main()
+{
+    test_add_blob_sizes();
+    test_init_wrapping_blob();
+    test_init_packet_end();
+
+    HOST_TEST_END("test_osc_init");
+}
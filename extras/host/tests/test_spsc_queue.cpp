@@ -0,0 +1,147 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Host test of SPSCQueue: the full/empty edges and the index wrap on one thread, then a std::thread as
+                the producer (the ISR on the board) against loop() as the consumer, checking that every item comes out
+                once, in order and untorn, and that the dropped pushes are exactly the counted overflows.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include "HostTest.h"
+#include <atomic>
+#include <thread>
+
+namespace
+{
+const uint32_t THREADED_ITEMS = 1000000;
+
+// The two halves are written separately, a torn copy doesn't pass check()
+struct Item
+{
+    uint32_t seq;
+    uint32_t inverse;
+
+    static Item make(uint32_t in_seq) { Item item = {in_seq, ~in_seq}; return item; }
+    bool check() const { return inverse == ~seq; }
+};
+
+typedef SPSCQueue<Item, 16> Queue;
+
+void test_edges()
+{
+    Queue queue;
+    Item item;
+    CHECK(queue.empty());
+    CHECK(!queue.pop(item));
+    CHECK(queue.pop(&item, 1) == 0);
+
+    // Full
+    for (uint32_t i = 0; i < Queue::capacity(); ++i) CHECK(queue.push(Item::make(i)));
+    CHECK(queue.size() == Queue::capacity());
+    CHECK(!queue.push(Item::make(99)));
+    CHECK(!queue.push(Item::make(99)));
+    CHECK(queue.get_overflows() == 2);
+
+    // One out, one in, the dropped items never show up
+    CHECK(queue.pop(item) && item.seq == 0);
+    CHECK(queue.push(Item::make(Queue::capacity())));
+    CHECK(!queue.push(Item::make(99)));
+    CHECK(queue.get_overflows() == 3);
+
+    // Batch pop stops at in_max, then at the tail
+    Item batch[32];
+    CHECK(queue.pop(batch, 5) == 5);
+    for (uint8_t i = 0; i < 5; ++i) CHECK(batch[i].seq == 1u + i);
+    CHECK(queue.pop(batch, 32) == Queue::capacity() - 5);
+    for (uint8_t i = 0; i < Queue::capacity() - 5; ++i) CHECK(batch[i].seq == 6u + i);
+    CHECK(queue.empty());
+    CHECK(!queue.pop(item));
+
+    // The free-running uint8_t indices wrap many times
+    uint32_t next_pop = 0;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        CHECK(queue.push(Item::make(i)));
+        if (i % 3 == 2)
+        {
+            while (queue.pop(item)) CHECK(item.seq == next_pop++);
+        }
+        CHECK(queue.size() <= 3);
+    }
+    while (queue.pop(item)) CHECK(item.seq == next_pop++);
+    CHECK(next_pop == 5000);
+
+    queue.push(Item::make(0));
+    queue.push(Item::make(1));
+    queue.clear();
+    CHECK(queue.empty());
+    CHECK(queue.get_overflows() == 3);
+}
+
+/* The producer retries a full queue (in_retry) or drops the item as an ISR does. Either way the consumer must see
+   increasing sequence numbers only, with every gap matching a counted overflow. */
+void test_threaded(bool in_retry)
+{
+    Queue queue;
+    uint32_t failed_pushes = 0; // Read once the producer is joined
+    std::atomic<bool> done(false);
+
+    std::thread producer([&queue, &failed_pushes, &done, in_retry]() {
+        for (uint32_t i = 0; i < THREADED_ITEMS; ++i)
+        {
+            while (!queue.push(Item::make(i)))
+            {
+                ++failed_pushes;
+                if (!in_retry) break;
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t received = 0;
+    uint32_t expected = 0; // Next sequence number
+    uint32_t out_of_order = 0;
+    uint32_t torn = 0;
+    uint32_t skipped = 0;
+    Item batch[8];
+    while (true)
+    {
+        // Alternate single and batch pops
+        uint8_t count = (received & 1) ? queue.pop(batch, 8) : queue.pop(batch[0]);
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            torn += !batch[i].check();
+            if (batch[i].seq < expected) ++out_of_order;
+            else skipped += batch[i].seq - expected;
+            expected = batch[i].seq + 1;
+            ++received;
+        }
+        if (!count)
+        {
+            if (done.load(std::memory_order_acquire) && queue.empty()) break;
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    skipped += THREADED_ITEMS - expected;
+
+    CHECK(torn == 0);
+    CHECK(out_of_order == 0);
+    CHECK(received + skipped == THREADED_ITEMS);
+    CHECK(skipped == (in_retry ? 0 : failed_pushes));
+    CHECK(queue.get_overflows() == static_cast<uint16_t>(failed_pushes));
+}
+} // namespace
+
+int main()
+{
+    test_edges();
+    test_threaded(true);
+    test_threaded(false);
+
+    HOST_TEST_END("test_spsc_queue");
+}
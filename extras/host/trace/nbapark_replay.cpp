@@ -0,0 +1,499 @@
+/*
+ * NBA Park Arduino Library
+ * Description: Replay of a SensorTrace capture (the packets sent by SensorTrace::send()) through the library detection
+                code on the host build: the recorded echo widths are answered by the HostHAL echo responders to
+                BasketSensorArray::check_sensors() and BasketSensor, and the IR edges are driven on IRBasketSensor pins,
+                with filter_sensor_readings() and the cooldowns run on the recorded timeline. The virtual clock only
+                moves as the trace does, so hours of play replay in seconds and can be re-scored with other parameters.
+ * Author: José Paulo Seibt Neto
+ * Created: Oct - 2026
+ * Last Modified: Oct - 2026
+*/
+
+#include <HostHAL.h>
+#include <NBAPark.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Trace (start)
+struct Event
+{
+    uint64_t micros; // Unwrapped micros() of the board
+    uint16_t value;
+    uint8_t type;
+    uint8_t sensor;
+};
+
+struct TraceStats
+{
+    uint32_t packets;
+    uint32_t invalid;         // Frames or bytes that aren't a trace packet
+    uint32_t missing_packets; // Sequence number gaps (packets lost by the link)
+    uint32_t dropped_events;  // Reported by the board (SensorTrace queue full)
+};
+
+uint32_t read_le(const uint8_t* in_buffer, uint8_t in_len)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < in_len; ++i) value |= static_cast<uint32_t>(in_buffer[i]) << (8 * i);
+    return value;
+}
+
+bool is_packet_start(const uint8_t* in_data, size_t in_len)
+{
+    return in_len >= TRACE_HEADER_LEN && memcmp(in_data, "NBTR", 4) == 0 && in_data[4] == TRACE_VERSION;
+}
+
+class TraceReader
+{
+    std::vector<Event> m_events;
+    TraceStats m_stats;
+    bool m_has_sequence;
+    uint16_t m_next_sequence;
+    bool m_has_micros;
+    uint64_t m_micros; // Last unwrapped timestamp
+
+public:
+    TraceReader() : m_stats(), m_has_sequence(false), m_next_sequence(0), m_has_micros(false), m_micros(0) {}
+
+    /* Back to back packets if the data starts with one (e.g. the UDP payloads appended to a file), SLIP framed packets
+       otherwise (Serial capture, other frames and the text in between are skipped). */
+    void parse(const std::vector<uint8_t>& in_data)
+    {
+        if (is_packet_start(in_data.data(), in_data.size())) parse_raw(in_data);
+        else parse_slip(in_data);
+    }
+
+    const std::vector<Event>& get_events() const { return m_events; }
+    const TraceStats& get_stats() const { return m_stats; }
+
+private:
+    void parse_slip(const std::vector<uint8_t>& in_data)
+    {
+        std::vector<uint8_t> buffer(TRACE_HEADER_LEN + 255 * TRACE_EVENT_LEN);
+        SLIPDecoder slip(buffer.data(), buffer.size());
+        for (size_t i = 0; i < in_data.size(); ++i)
+        {
+            if (!slip.feed(in_data[i])) continue;
+            if (!parse_packet(slip.get_frame(), slip.get_frame_len())) ++m_stats.invalid;
+        }
+    }
+
+    void parse_raw(const std::vector<uint8_t>& in_data)
+    {
+        size_t pos = 0;
+        while (pos < in_data.size())
+        {
+            size_t len = parse_packet(in_data.data() + pos, in_data.size() - pos);
+            if (len)
+            {
+                pos += len;
+                continue;
+            }
+
+            // Resynchronize on the next packet header
+            ++m_stats.invalid;
+            for (++pos; pos < in_data.size() && !is_packet_start(in_data.data() + pos, in_data.size() - pos); ++pos);
+        }
+    }
+
+    // Returns the packet length, 0 if in_data doesn't start with a complete packet
+    size_t parse_packet(const uint8_t* in_data, size_t in_len)
+    {
+        if (!is_packet_start(in_data, in_len)) return 0;
+
+        uint8_t count = in_data[5];
+        size_t len = TRACE_HEADER_LEN + static_cast<size_t>(count) * TRACE_EVENT_LEN;
+        if (!count || len > in_len) return 0;
+
+        uint16_t sequence = read_le(in_data + 6, 2);
+        if (m_has_sequence) m_stats.missing_packets += static_cast<uint16_t>(sequence - m_next_sequence);
+        m_has_sequence = true;
+        m_next_sequence = sequence + 1;
+        m_stats.dropped_events += read_le(in_data + 8, 2);
+        ++m_stats.packets;
+
+        for (const uint8_t* event_data = in_data + TRACE_HEADER_LEN; event_data < in_data + len; event_data += TRACE_EVENT_LEN)
+        {
+            Event event;
+            event.micros = unwrap(read_le(event_data, 4));
+            event.value = read_le(event_data + 4, 2);
+            event.type = event_data[6];
+            event.sensor = event_data[7];
+            if (event.type < TRACE_NUM_TYPES) m_events.push_back(event);
+        }
+        return len;
+    }
+
+    // micros() wraps every ~71 minutes, events are close enough in time for the signed difference to be right
+    uint64_t unwrap(uint32_t in_micros)
+    {
+        if (!m_has_micros)
+        {
+            m_has_micros = true;
+            m_micros = in_micros;
+        }
+        else
+        {
+            m_micros += static_cast<int32_t>(in_micros - static_cast<uint32_t>(m_micros));
+        }
+        return m_micros;
+    }
+};
+// Trace (end)
+
+
+// Replay (start)
+struct Options
+{
+    uint16_t cooldown_ms;
+    uint16_t min_break_us;
+    uint16_t poll_interval_ms; // IR polling mode, interval of the polls while an output is LOW
+    bool ir_irq;
+    uint8_t hoops;             // BasketSensorArray size, 0 = from the trace
+};
+
+struct Detection
+{
+    uint64_t micros;
+    uint32_t game;
+    uint8_t type;
+    uint8_t hoops; // Sweep: bitmask of the pattern hoops that saw the ball, sensor index otherwise
+    uint8_t shots;
+};
+
+// Pins of the replayed sensors, sensor i of each kind
+const uint8_t MAX_SENSORS = 8;
+const uint8_t MAX_IR_SENSORS = IRBasketSensor::MAX_IRQ_SENSORS;
+uint8_t array_trig_pin(uint8_t in_i) { return 2 + 2 * in_i; }
+uint8_t array_echo_pin(uint8_t in_i) { return 3 + 2 * in_i; }
+uint8_t echo_trig_pin(uint8_t in_i) { return 20 + 2 * in_i; }
+uint8_t echo_echo_pin(uint8_t in_i) { return 21 + 2 * in_i; }
+uint8_t ir_pin(uint8_t in_i) { return 40 + in_i; }
+
+template<uint8_t N>
+class Replayer
+{
+    typedef typename BasketSensorArray<N>::pattern_t pattern_t;
+
+    const Options& m_options;
+    uint8_t m_trig_pins[N];
+    uint8_t m_echo_pins[N];
+    BasketSensorArray<N> m_array;
+    std::vector<BasketSensor*> m_echo_sensors;
+    std::vector<IRBasketSensor*> m_ir_sensors;
+
+    uint64_t m_start_ns;
+    uint64_t m_first_micros;
+    uint32_t m_pattern;
+    uint32_t m_game;
+    uint64_t m_last_ir_poll;
+    std::vector<Detection> m_detections;
+
+public:
+    Replayer(const Options& in_options, uint64_t in_first_micros, bool in_has_pattern)
+        : m_options(in_options), m_array(init_pins(m_trig_pins, m_echo_pins), m_echo_pins),
+          m_start_ns(0), m_first_micros(in_first_micros), m_pattern(in_has_pattern ? 0 : HoopTraits<N>::ALL_HOOPS),
+          m_game(in_has_pattern ? 0 : 1), m_last_ir_poll(0)
+    {
+        m_array.set_cooldown_time(HoopTraits<N>::ALL_HOOPS, m_options.cooldown_ms);
+        for (uint8_t i = 0; i < MAX_SENSORS; ++i)
+        {
+            m_echo_sensors.push_back(new BasketSensor(echo_trig_pin(i), echo_echo_pin(i)));
+            m_echo_sensors.back()->set_cooldown_time(m_options.cooldown_ms);
+        }
+        for (uint8_t i = 0; i < MAX_IR_SENSORS; ++i)
+        {   // Idle IR receivers are HIGH (beam intact)
+            host::set_pin(ir_pin(i), HIGH);
+            m_ir_sensors.push_back(new IRBasketSensor(ir_pin(i)));
+            m_ir_sensors.back()->set_cooldown_time(m_options.cooldown_ms);
+            m_ir_sensors.back()->set_min_break_duration(m_options.min_break_us);
+            if (m_options.ir_irq) m_ir_sensors.back()->attach_interrupt();
+        }
+
+        // micros() of the board at the first event from here on
+        host::set_micros(static_cast<uint32_t>(m_first_micros));
+        m_start_ns = host::now_ns();
+    }
+
+    ~Replayer()
+    {
+        for (size_t i = 0; i < m_echo_sensors.size(); ++i) delete m_echo_sensors[i];
+        for (size_t i = 0; i < m_ir_sensors.size(); ++i)
+        {
+            m_ir_sensors[i]->detach_interrupt();
+            delete m_ir_sensors[i];
+        }
+    }
+
+    void run(const std::vector<Event>& in_events)
+    {
+        for (size_t i = 0; i < in_events.size();)
+        {
+            const Event& event = in_events[i];
+            poll_ir_until(event.micros);
+            advance_to(event.micros);
+
+            switch (event.type)
+            {
+                case TRACE_SWEEP:
+                {   // Events of the same sweep share the timestamp
+                    size_t end = i;
+                    while (end < in_events.size() && in_events[end].type == TRACE_SWEEP && in_events[end].micros == event.micros) ++end;
+                    replay_sweep(in_events, i, end);
+                    i = end;
+                    continue;
+                }
+                case TRACE_ECHO:
+                    replay_echo(event);
+                    break;
+                case TRACE_IR_EDGE:
+                    replay_ir_edge(event);
+                    break;
+                case TRACE_PATTERN:
+                    if (!m_pattern && event.value) ++m_game; // A game starts
+                    m_pattern = event.value;
+                    break;
+            }
+            ++i;
+        }
+    }
+
+    const std::vector<Detection>& get_detections() const { return m_detections; }
+    uint32_t get_games() const { return m_game; }
+
+private:
+    static const uint8_t* init_pins(uint8_t* out_trig_pins, uint8_t* out_echo_pins)
+    {
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            out_trig_pins[i] = array_trig_pin(i);
+            out_echo_pins[i] = array_echo_pin(i);
+        }
+        return out_trig_pins;
+    }
+
+    uint32_t now_ms(uint64_t in_micros) const { return static_cast<uint32_t>(in_micros / 1000); }
+
+    // Move the virtual clock to the board time of in_micros, unless the previous replay step already passed it
+    void advance_to(uint64_t in_micros)
+    {
+        uint64_t target_ns = m_start_ns + (in_micros - m_first_micros) * 1000;
+        if (target_ns > host::now_ns()) host::advance_ns(target_ns - host::now_ns());
+    }
+
+    void add_detection(uint64_t in_micros, uint8_t in_type, uint8_t in_hoops, uint8_t in_shots)
+    {
+        Detection detection = {in_micros, m_game, in_type, in_hoops, in_shots};
+        m_detections.push_back(detection);
+    }
+
+    void replay_sweep(const std::vector<Event>& in_events, size_t in_begin, size_t in_end)
+    {
+        for (uint8_t i = 0; i < N; ++i) host::set_echo_responder_width(m_trig_pins[i], m_echo_pins[i], 0);
+        for (size_t e = in_begin; e < in_end; ++e)
+        {
+            if (in_events[e].sensor < N)
+            {
+                uint8_t sensor = in_events[e].sensor;
+                host::set_echo_responder_width(m_trig_pins[sensor], m_echo_pins[sensor], in_events[e].value);
+            }
+        }
+
+        uint64_t micros = in_events[in_begin].micros;
+        pattern_t checks = m_array.check_sensors();
+        uint8_t shots = m_array.filter_sensor_readings(static_cast<pattern_t>(m_pattern & HoopTraits<N>::ALL_HOOPS), checks, now_ms(micros));
+        if (shots) add_detection(micros, TRACE_SWEEP, static_cast<uint8_t>(m_pattern & checks), shots);
+    }
+
+    void replay_echo(const Event& in_event)
+    {
+        if (in_event.sensor >= MAX_SENSORS || !((m_pattern >> in_event.sensor) & 1)) return;
+
+        uint8_t i = in_event.sensor;
+        host::set_echo_responder_width(echo_trig_pin(i), echo_echo_pin(i), in_event.value);
+        if (m_echo_sensors[i]->ball_detected(now_ms(in_event.micros))) add_detection(in_event.micros, TRACE_ECHO, i, 1);
+    }
+
+    void replay_ir_edge(const Event& in_event)
+    {
+        if (in_event.sensor >= MAX_IR_SENSORS) return;
+
+        // The ISR reads the level and micros() of the edge in interrupt mode
+        host::set_pin(ir_pin(in_event.sensor), in_event.value ? HIGH : LOW);
+        poll_ir(in_event.micros);
+    }
+
+    // Same check as the sketch loop, only the hoops of the current pattern are polled
+    void poll_ir(uint64_t in_micros)
+    {
+        for (uint8_t i = 0; i < MAX_IR_SENSORS; ++i)
+        {
+            if (((m_pattern >> i) & 1) && m_ir_sensors[i]->ball_detected(now_ms(in_micros))) add_detection(in_micros, TRACE_IR_EDGE, i, 1);
+        }
+        m_last_ir_poll = in_micros;
+    }
+
+    /* In polling mode a beam still broken when the cooldown ends is detected again by the next poll, the trace only
+       has the edges, so the outputs are polled every poll interval while any of them is LOW. */
+    void poll_ir_until(uint64_t in_micros)
+    {
+        if (m_options.ir_irq || !m_options.poll_interval_ms) return;
+
+        const uint64_t interval = static_cast<uint64_t>(m_options.poll_interval_ms) * 1000;
+        while (m_last_ir_poll + interval < in_micros && any_ir_low())
+        {
+            advance_to(m_last_ir_poll + interval);
+            poll_ir(m_last_ir_poll + interval);
+        }
+    }
+
+    bool any_ir_low() const
+    {
+        for (uint8_t i = 0; i < MAX_IR_SENSORS; ++i)
+        {
+            if (host::get_pin(ir_pin(i)) == LOW) return true;
+        }
+        return false;
+    }
+};
+
+// BasketSensorArray size picked at run time
+template<uint8_t N>
+struct ReplayDispatch
+{
+    static bool run(uint8_t in_hoops, const Options& in_options, const std::vector<Event>& in_events, bool in_has_pattern,
+                    std::vector<Detection>& out_detections, uint32_t& out_games)
+    {
+        if (in_hoops != N) return ReplayDispatch<N - 1>::run(in_hoops, in_options, in_events, in_has_pattern, out_detections, out_games);
+
+        Replayer<N> replayer(in_options, in_events.front().micros, in_has_pattern);
+        replayer.run(in_events);
+        out_detections = replayer.get_detections();
+        out_games = replayer.get_games();
+        return true;
+    }
+};
+
+template<>
+struct ReplayDispatch<0>
+{
+    static bool run(uint8_t, const Options&, const std::vector<Event>&, bool, std::vector<Detection>&, uint32_t&) { return false; }
+};
+// Replay (end)
+
+
+const char* const TYPE_NAMES[] = {"sweep", "echo", "ir", "pattern"};
+
+void usage(const char* in_name)
+{
+    std::cerr << "Usage: " << in_name << " [options] TRACE_FILE\n"
+              << "  --cooldown MS         Hoop cooldown (default " << BALL_DETECTION_COOLDOWN << ")\n"
+              << "  --min-break US        IR minimum beam break in interrupt mode (default " << IR_MIN_BREAK_DURATION << ")\n"
+              << "  --ir-irq              Replay the IR sensors in interrupt mode (polling by default)\n"
+              << "  --poll-interval MS    IR polling mode, poll interval while a beam is broken (default 1, 0 = edges only)\n"
+              << "  --hoops N             BasketSensorArray size (default: highest swept sensor + 1)\n"
+              << "  --csv FILE            Write every detection to FILE\n"
+              << "Detection threshold and echo timeout are compile-time, set them with -DNBAPARK_DEFINES (see README.md)\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options = {BALL_DETECTION_COOLDOWN, IR_MIN_BREAK_DURATION, 1, false, 0};
+    std::string trace_path;
+    std::string csv_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--cooldown" && has_value) options.cooldown_ms = static_cast<uint16_t>(atoi(argv[++i]));
+        else if (arg == "--min-break" && has_value) options.min_break_us = static_cast<uint16_t>(atoi(argv[++i]));
+        else if (arg == "--poll-interval" && has_value) options.poll_interval_ms = static_cast<uint16_t>(atoi(argv[++i]));
+        else if (arg == "--hoops" && has_value) options.hoops = static_cast<uint8_t>(atoi(argv[++i]));
+        else if (arg == "--ir-irq") options.ir_irq = true;
+        else if (arg == "--csv" && has_value) csv_path = argv[++i];
+        else if (trace_path.empty() && arg[0] != '-') trace_path = arg;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (trace_path.empty() || options.hoops > MAX_SENSORS)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::ifstream file(trace_path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Can't read " << trace_path << "\n";
+        return 2;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    TraceReader reader;
+    reader.parse(data);
+    const std::vector<Event>& events = reader.get_events();
+    const TraceStats& stats = reader.get_stats();
+    std::cout << "packets " << stats.packets << ", events " << events.size() << ", invalid frames " << stats.invalid
+              << ", missing packets " << stats.missing_packets << ", events dropped by the board " << stats.dropped_events << "\n";
+    if (events.empty()) return 1;
+
+    bool has_pattern = false;
+    uint8_t hoops = options.hoops;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (events[i].type == TRACE_PATTERN) has_pattern = true;
+        if (!options.hoops && events[i].type == TRACE_SWEEP && events[i].sensor >= hoops) hoops = events[i].sensor + 1;
+    }
+    if (!hoops) hoops = 3; // No sweeps, any size does
+    if (hoops > MAX_SENSORS)
+    {
+        std::cerr << "Sweeps of more than " << +MAX_SENSORS << " sensors aren't supported\n";
+        return 1;
+    }
+
+    host::reset();
+    std::vector<Detection> detections;
+    uint32_t games = 0;
+    ReplayDispatch<MAX_SENSORS>::run(hoops, options, events, has_pattern, detections, games);
+    host::reset();
+
+    // Shots per game, game 0 is before the first pattern event
+    std::vector<uint32_t> shots(games + 1, 0);
+    uint32_t total = 0;
+    for (size_t i = 0; i < detections.size(); ++i)
+    {
+        shots[detections[i].game] += detections[i].shots;
+        total += detections[i].shots;
+    }
+    double span_s = (events.back().micros - events.front().micros) / 1e6;
+    std::cout << "replayed " << span_s << " s, " << games << " game(s), " << total << " shot(s) converted\n";
+    for (uint32_t g = 1; g <= games; ++g) std::cout << "  game " << g << ": " << shots[g] << " shot(s)\n";
+
+    if (!csv_path.empty())
+    {
+        std::ofstream csv(csv_path.c_str());
+        if (!csv)
+        {
+            std::cerr << "Can't write " << csv_path << "\n";
+            return 2;
+        }
+        csv << "micros,game,source,hoops,shots\n";
+        for (size_t i = 0; i < detections.size(); ++i)
+        {
+            const Detection& d = detections[i];
+            csv << d.micros << "," << d.game << "," << TYPE_NAMES[d.type] << "," << +d.hoops << "," << +d.shots << "\n";
+        }
+    }
+    return 0;
+}
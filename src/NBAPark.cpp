@@ -3,11 +3,17 @@
  * Description: Definitions of the classes and structs from NBAPark.h
  * Author: José Paulo Seibt Neto
  * Created: Fev - 2025
- * Last Modified: Jul - 2025
+ * Last Modified: Oct - 2026
 */
 
 #include "NBAPark.h"
 
+// FrameClock (start)
+uint32_t FrameClock::s_now_ms = 0;
+uint32_t FrameClock::s_now_us = 0;
+// FrameClock (end)
+
+
 // Timer Class (start)
 // Constructors
 Timer::Timer() : m_start_time(millis()), m_offset_time(UINT32_MAX - m_start_time + 1) {}
@@ -15,17 +21,25 @@ Timer::Timer() : m_start_time(millis()), m_offset_time(UINT32_MAX - m_start_time
 // Methods
 uint32_t Timer::reset()
 {
-    m_start_time = millis();
+    return reset(millis());
+}
+
+uint32_t Timer::reset(uint32_t in_now)
+{
+    m_start_time = in_now;
     m_offset_time = UINT32_MAX - m_start_time + 1;
     return 0;
 }
 
 uint32_t Timer::get_elapsed_time(bool seconds) const
 {
-    uint32_t now = millis();
+    return get_elapsed_time(seconds, millis());
+}
 
+uint32_t Timer::get_elapsed_time(bool seconds, uint32_t in_now) const
+{
     // Calculate elapsed time, handling overflow by adding offset time
-    uint32_t elapsed = (now >= m_start_time) ? (now - m_start_time) : (m_offset_time + now);
+    uint32_t elapsed = (in_now >= m_start_time) ? (in_now - m_start_time) : (m_offset_time + in_now);
 
     if (seconds)
         elapsed /= 1000; // Converts to seconds
@@ -87,7 +101,13 @@ uint32_t Clock::stop()
 // Update the clock time value based on the elapsed seconds since the last update() or setup() call
 uint32_t Clock::update()
 {
-    uint32_t now = get_elapsed_time();
+    return update(millis());
+}
+
+// Same as update(), with the time (millis()) read once by the caller, e.g. FrameClock::now_ms()
+uint32_t Clock::update(uint32_t in_now)
+{
+    uint32_t now = get_elapsed_time(true, in_now);
     if (!m_running || now < 1)
     {   // Exit early if not running or not a second has passed since the last update() call
         return m_clock_time;
@@ -104,8 +124,8 @@ uint32_t Clock::update()
     {
         m_clock_time += now;
     }
-    reset();
-    debugLib("[Clock::update] clock_time: "); debugLib(m_clock_time); debugLibln();
+    reset(in_now);
+    debugLibLog(LOG_CLOCK_TIME, m_clock_time);
 
     if (m_mode == 0 && m_clock_time >= SECS_24H) 
     {   // Clock mode: Wrap around 24h
@@ -113,7 +133,7 @@ uint32_t Clock::update()
     }
     else if (m_mode == 1 && m_clock_time <= 0)
     {   // Countdown mode: End of countdown reached
-        debugLib("[Clock::update] Countdown end\n");
+        debugLibLog(LOG_COUNTDOWN_END);
         m_clock_time = 0;
         m_running = false;
     }
@@ -123,35 +143,239 @@ uint32_t Clock::update()
 
 void Clock::print() const
 {
-    char buffer[9];
-    snprintf(buffer, 9, "%02u:%02u:%02u", get_hh(), get_mm(), get_ss());
+    char buffer[12]; // Three uint8_t fields of up to 3 digits, should a field ever go past 99
+    snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u", get_hh(), get_mm(), get_ss());
     DEBUG_OUTPUT.println(buffer);
 }
 // Clock (end)
 
 
+// SensorTrace (start)
+static void trace_write_le(uint8_t* out_buffer, uint32_t in_value, uint8_t in_len)
+{
+    for (uint8_t i = 0; i < in_len; ++i) out_buffer[i] = static_cast<uint8_t>(in_value >> (8 * i));
+}
+
+bool SensorTrace::record(TraceType in_type, uint8_t in_sensor, uint32_t in_value, uint32_t in_micros)
+{
+    // The queue has a single producer, the sensor ISRs and the loop take turns
+#if defined(__AVR__)
+    uint8_t sreg = SREG;
+    noInterrupts();
+    bool pushed = record_isr(in_type, in_sensor, in_value, in_micros);
+    SREG = sreg;
+#else
+    noInterrupts();
+    bool pushed = record_isr(in_type, in_sensor, in_value, in_micros);
+    interrupts();
+#endif
+    return pushed;
+}
+
+bool SensorTrace::record_isr(TraceType in_type, uint8_t in_sensor, uint32_t in_value, uint32_t in_micros)
+{
+    TraceEvent event;
+    event.micros = in_micros;
+    event.value = clamp_value(in_value);
+    event.type = in_type;
+    event.sensor = in_sensor;
+    return m_queue.push(event);
+}
+
+uint8_t SensorTrace::send(Print& in_p, uint8_t in_max_events)
+{
+    // Events are popped one at a time below, the ISRs can only add to the count taken here
+    uint8_t count = m_queue.size();
+    if (count > in_max_events) count = in_max_events;
+    if (!count) return 0;
+
+    uint16_t overflows = m_queue.get_overflows();
+    uint8_t header[TRACE_HEADER_LEN] = {'N', 'B', 'T', 'R', TRACE_VERSION, count};
+    trace_write_le(header + 6, m_sequence, 2);
+    trace_write_le(header + 8, static_cast<uint16_t>(overflows - m_reported_overflows), 2);
+    in_p.write(header, TRACE_HEADER_LEN);
+
+    TraceEvent event;
+    for (uint8_t i = 0; i < count && m_queue.pop(event); ++i)
+    {
+        uint8_t buffer[TRACE_EVENT_LEN];
+        trace_write_le(buffer, event.micros, 4);
+        trace_write_le(buffer + 4, event.value, 2);
+        buffer[6] = event.type;
+        buffer[7] = event.sensor;
+        in_p.write(buffer, TRACE_EVENT_LEN);
+    }
+
+    ++m_sequence;
+    m_reported_overflows = overflows;
+    return count;
+}
+// SensorTrace (end)
+
+
 // IRBasketSensor Class (start)
-IRBasketSensor::IRBasketSensor(uint8_t in_out_pin) : m_out_pin(in_out_pin)
+IRBasketSensor* IRBasketSensor::s_irq_instances[IRBasketSensor::MAX_IRQ_SENSORS] = {};
+
+// One ISR per interrupt mode slot, as attachInterrupt() takes no user data
+template<uint8_t I>
+void ir_basket_sensor_isr()
+{
+    IRBasketSensor* sensor = IRBasketSensor::s_irq_instances[I];
+    if (sensor) sensor->handle_edge(digitalRead(sensor->m_out_pin), micros());
+}
+
+static void (* const s_ir_isrs[IRBasketSensor::MAX_IRQ_SENSORS])() = {
+    ir_basket_sensor_isr<0>, ir_basket_sensor_isr<1>, ir_basket_sensor_isr<2>,
+    ir_basket_sensor_isr<3>, ir_basket_sensor_isr<4>, ir_basket_sensor_isr<5>
+};
+
+IRBasketSensor::IRBasketSensor(uint8_t in_out_pin)
+    : m_out_pin(in_out_pin), m_fall_micros(0), m_detection_micros(0), m_detections(0), m_beam_broken(false),
+      m_detections_seen(0), m_min_break_us(IR_MIN_BREAK_DURATION), m_irq_slot(MAX_IRQ_SENSORS),
+      m_hoop_index(0), m_event_queue(nullptr), m_trace(nullptr), m_trace_sensor(0), m_trace_level(HIGH)
 {
     pinMode(m_out_pin, INPUT);
 }
 
 bool IRBasketSensor::ball_detected()
 {
-    m_hoop_cooldown.update();
-    if (!m_hoop_cooldown.on_cooldown && !digitalRead(m_out_pin))
+    return ball_detected(millis());
+}
+
+bool IRBasketSensor::ball_detected(uint32_t in_now)
+{
+    if (m_irq_slot < MAX_IRQ_SENSORS)
+    {   // Interrupt mode, a detection is pending when the ISR count moved since the last report
+        uint8_t detections = m_detections;
+        if (detections == m_detections_seen) return false;
+        m_detections_seen = detections;
+
+        m_hoop_cooldown.update(in_now);
+        if (m_hoop_cooldown.get_active()) return false;
+        m_hoop_cooldown.set_cooldown(1, in_now);
+        return true;
+    }
+
+    if (m_trace)
+    {   // Extra pin read only while tracing, the detection below only reads it when off cooldown
+        uint8_t level = digitalRead(m_out_pin);
+        if (level != m_trace_level)
+        {
+            m_trace_level = level;
+            m_trace->record(TRACE_IR_EDGE, m_trace_sensor, level, micros());
+        }
+    }
+
+    m_hoop_cooldown.update(in_now);
+    if (!m_hoop_cooldown.get_active() && !digitalRead(m_out_pin))
     {   // Ball detected
-        m_hoop_cooldown.set_cooldown(BALL_DETECTION_COOLDOWN);
+        m_hoop_cooldown.set_cooldown(1, in_now);
         return true;
     }
     return false;
 }
+
+// Drop the pending detections (e.g. the ones latched while the game was paused) and the cooldown
+void IRBasketSensor::reset()
+{
+    m_detections_seen = m_detections;
+    m_hoop_cooldown.reset();
+}
+
+uint32_t IRBasketSensor::get_detection_micros() const
+{
+    noInterrupts();
+    uint32_t detection_micros = m_detection_micros;
+    interrupts();
+    return detection_micros;
+}
+
+bool IRBasketSensor::attach_interrupt()
+{
+    if (m_irq_slot < MAX_IRQ_SENSORS) return true;
+
+    if (digitalPinToInterrupt(m_out_pin) == NOT_AN_INTERRUPT)
+    {
+        debugLib("[IRBasketSensor::attach_interrupt] Pin without interrupt support\n");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < MAX_IRQ_SENSORS; ++i)
+    {
+        if (!s_irq_instances[i])
+        {
+            m_beam_broken = false;
+            m_detections_seen = m_detections;
+            s_irq_instances[i] = this;
+            m_irq_slot = i;
+            attachInterrupt(digitalPinToInterrupt(m_out_pin), s_ir_isrs[i], CHANGE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void IRBasketSensor::detach_interrupt()
+{
+    if (m_irq_slot >= MAX_IRQ_SENSORS) return;
+
+    detachInterrupt(digitalPinToInterrupt(m_out_pin));
+    s_irq_instances[m_irq_slot] = nullptr;
+    m_irq_slot = MAX_IRQ_SENSORS;
+}
+
+// Timestamp the beam break and count a detection when the beam is restored after at least m_min_break_us
+void IRBasketSensor::handle_edge(uint8_t in_level, uint32_t in_micros)
+{
+    if (m_trace) m_trace->record_isr(TRACE_IR_EDGE, m_trace_sensor, in_level, in_micros);
+
+    if (in_level == LOW)
+    {   // Beam broken
+        m_fall_micros = in_micros;
+        m_beam_broken = true;
+    }
+    else if (m_beam_broken)
+    {   // Beam restored, shorter breaks are noise
+        m_beam_broken = false;
+        if (in_micros - m_fall_micros < m_min_break_us) return;
+
+        m_detection_micros = m_fall_micros;
+        ++m_detections;
+
+        if (m_event_queue)
+        {
+            HoopEvent event;
+            event.hoop = m_hoop_index;
+            event.micros = m_fall_micros;
+            m_event_queue->push(event);
+        }
+    }
+}
 // IRBasketSensor Class (end)
 
 
 // BasketSensor Class (start)
+BasketSensor* BasketSensor::s_irq_instances[BasketSensor::MAX_IRQ_SENSORS] = {};
+
+// One ISR per interrupt mode slot, as attachInterrupt() takes no user data
+template<uint8_t I>
+void basket_sensor_echo_isr()
+{
+    BasketSensor* sensor = BasketSensor::s_irq_instances[I];
+    if (sensor) sensor->handle_echo_edge(digitalRead(sensor->m_echo_pin), micros());
+}
+
+static void (* const s_echo_isrs[BasketSensor::MAX_IRQ_SENSORS])() = {
+    basket_sensor_echo_isr<0>, basket_sensor_echo_isr<1>, basket_sensor_echo_isr<2>,
+    basket_sensor_echo_isr<3>, basket_sensor_echo_isr<4>, basket_sensor_echo_isr<5>
+};
+
 // Constructors
-BasketSensor::BasketSensor(uint8_t in_trig_pin, uint8_t in_echo_pin) : m_trig_pin(in_trig_pin), m_echo_pin(in_echo_pin)
+BasketSensor::BasketSensor(uint8_t in_trig_pin, uint8_t in_echo_pin)
+    : m_trig_pin(in_trig_pin), m_echo_pin(in_echo_pin),
+      m_async(false), m_echo_state(ECHO_IDLE), m_trigger_micros(static_cast<uint32_t>(0UL - BALL_DETECTION_PING_INTERVAL)), m_rise_micros(0), m_last_distance(-1),
+      m_echo_rise(0), m_echo_width(0), m_echo_armed(false), m_echo_high(false), m_echo_done(false),
+      m_irq_slot(MAX_IRQ_SENSORS), m_trace(nullptr), m_trace_sensor(0)
 {
     // Set trigger and echo pins
     pinMode(m_trig_pin, OUTPUT);
@@ -162,539 +386,722 @@ BasketSensor::BasketSensor(uint8_t in_trig_pin, uint8_t in_echo_pin) : m_trig_pi
 // Update the sensor cooldown state and check for ball detection
 bool BasketSensor::ball_detected()
 {
-    m_hoop_cooldown.update();
-    if (!m_hoop_cooldown.on_cooldown)
+    return ball_detected(millis());
+}
+
+bool BasketSensor::ball_detected(uint32_t in_now)
+{
+    m_hoop_cooldown.update(in_now);
+
+    float distance;
+    if (m_async)
+    {   // Only report when a measurement completed, the next one starts once the ping interval passed
+        if (m_echo_state == ECHO_IDLE && ping_due()) trigger();
+        if (update() != ECHO_RESULT) return false;
+
+        distance = m_last_distance;
+        m_echo_state = ECHO_IDLE;
+        if (ping_due()) trigger();
+        if (m_hoop_cooldown.get_active()) return false;
+    }
+    else
     {
-        float distance = get_ultrasonic_distance();
-        if (distance > 2 && distance < BALL_DETECTION_THRESHOLD)
-        {
-            m_hoop_cooldown.set_cooldown(BALL_DETECTION_COOLDOWN);
-            return true;
-        }
+        if (m_hoop_cooldown.get_active()) return false;
+        distance = get_ultrasonic_distance();
+    }
+
+    if (distance > 2 && distance < BALL_DETECTION_THRESHOLD)
+    {
+        m_hoop_cooldown.set_cooldown(1, in_now);
+        return true;
     }
     return false;
 }
 
 float BasketSensor::get_ultrasonic_distance()
+{
+    send_trigger_pulse();
+
+    // Read the echo signal
+    uint32_t duration = pulseIn(m_echo_pin, HIGH, BALL_DETECTION_TIMEOUT);
+    if (m_trace) m_trace->record(TRACE_ECHO, m_trace_sensor, duration, micros());
+    if (duration == 0)
+    {   // timeout reached
+        PROFILE_COUNT(Profiler::sensor_timeouts, 1);
+        return -1;
+    }
+
+    return (duration * SOUND_SPEED) / 2; // Caculate distance in centimeters
+}
+
+// Send a pulse to the ultrasonic sensor
+void BasketSensor::send_trigger_pulse()
 {
     uint32_t start_micros = micros();
 
-    // Send a pulse to the ultrasonic sensor
     digitalWrite(m_trig_pin, LOW);
     while (micros() - start_micros < 2);
     digitalWrite(m_trig_pin, HIGH);
     while (micros() - start_micros < 12);
     digitalWrite(m_trig_pin, LOW);
-
-    // Read the echo signal
-    uint32_t duration = pulseIn(m_echo_pin, HIGH, BALL_DETECTION_TIMEOUT);
-    if (duration == 0) return -1; // timeout reached
-
-    return (duration * SOUND_SPEED) / 2; // Caculate distance in centimeters
 }
-// BasketSensor Class (end)
 
-
-// ThreeBasketSensors Class (start)
-// Constructor
-ThreeBasketSensors::ThreeBasketSensors(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr)
+void BasketSensor::set_async(bool in_async)
 {
-    m_ready = init(in_trig_pin_arr, in_echo_pin_arr);
+    m_async = in_async;
+    m_echo_state = ECHO_IDLE;
 }
 
-// For the method just assign each argument to the corresponding index element in the pin arrays
-// Pin number validation can be added
-bool ThreeBasketSensors::init(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2,
-                              const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2)
+// Send the trigger pulse and return right away, fails if a measurement is still in flight
+// or if the echo of a timed out measurement is still HIGH (the sensor ignores triggers until it ends)
+bool BasketSensor::trigger()
 {
-    m_trig_pins[0] = in_trig0;
-    m_trig_pins[1] = in_trig1;
-    m_trig_pins[2] = in_trig2;
-
-    m_echo_pins[0] = in_echo0;
-    m_echo_pins[1] = in_echo1;
-    m_echo_pins[2] = in_echo2;
+    if (m_echo_state == ECHO_ARMED || m_echo_state == ECHO_MEASURING || digitalRead(m_echo_pin) == HIGH) return false;
 
-    for (uint8_t i = 0; i < 3; ++i)
-    {
-        pinMode(m_trig_pins[i], OUTPUT);
-        pinMode(m_echo_pins[i], INPUT);
-    }
+    noInterrupts();
+    m_echo_high = false;
+    m_echo_done = false;
+    m_echo_armed = true;
+    interrupts();
 
+    send_trigger_pulse();
+    m_trigger_micros = micros();
+    m_echo_state = ECHO_ARMED;
     return true;
 }
 
-// Initializes m_trig_pins and m_echo_pins arrays through an input array as argument
-// Can be dangerous if arguments are pointers to an array with less than three elements
-bool ThreeBasketSensors::init(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr)
+// Advance the measurement state machine (idle -> armed -> measuring -> result) by sampling the echo pin once
+BasketSensor::EchoState BasketSensor::update()
 {
-    // Check for null
-    if (!in_trig_pin_arr || !in_echo_pin_arr)
+    if (m_echo_state == ECHO_IDLE || m_echo_state == ECHO_RESULT) return m_echo_state;
+
+    uint32_t now = micros();
+    if (m_irq_slot < MAX_IRQ_SENSORS)
+    {   // The ISR timestamped the edges, only collect the result
+        noInterrupts();
+        bool done = m_echo_done;
+        bool high = m_echo_high;
+        uint32_t width = m_echo_width;
+        interrupts();
+
+        if (done)
+        {
+            m_last_distance = (width * SOUND_SPEED) / 2;
+            m_echo_state = ECHO_RESULT;
+            if (m_trace) m_trace->record(TRACE_ECHO, m_trace_sensor, width, now);
+            return m_echo_state;
+        }
+        if (high) m_echo_state = ECHO_MEASURING;
+    }
+    else if (m_echo_state == ECHO_ARMED)
     {
-        return false;
+        if (digitalRead(m_echo_pin) == HIGH)
+        {   // Start timing the pulse
+            m_rise_micros = now;
+            m_echo_state = ECHO_MEASURING;
+        }
+    }
+    else if (digitalRead(m_echo_pin) == LOW)
+    {   // Pulse ended, caculate distance in centimeters
+        m_last_distance = ((now - m_rise_micros) * SOUND_SPEED) / 2;
+        m_echo_state = ECHO_RESULT;
+        if (m_trace) m_trace->record(TRACE_ECHO, m_trace_sensor, now - m_rise_micros, now);
+        return m_echo_state;
     }
 
-    for (uint8_t i = 0; i < 3; ++i)
+    // Same timeout as pulseIn(), counted from the trigger pulse
+    if (now - m_trigger_micros >= BALL_DETECTION_TIMEOUT)
     {
-        m_trig_pins[i] = in_trig_pin_arr[i];
-        m_echo_pins[i] = in_echo_pin_arr[i];
-        pinMode(m_trig_pins[i], OUTPUT);
-        pinMode(m_echo_pins[i], INPUT);
+        m_echo_armed = false; // Late edges are ignored
+        PROFILE_COUNT(Profiler::sensor_timeouts, 1);
+        m_last_distance = -1;
+        m_echo_state = ECHO_RESULT;
+        if (m_trace) m_trace->record(TRACE_ECHO, m_trace_sensor, 0, now);
     }
-    return true;
+    return m_echo_state;
 }
 
-// Check all sensors (sA, sB, sC) at the same time and returns a bitmap of the reading
-// Returns a uint8_t binary value as 0000_0[sC][sB][sA]
-BitmapPattern ThreeBasketSensors::check_sensors()
-{
-    if (!m_ready) return BitmapPattern::LAYOUT_STOP;
-
-    uint32_t pulse_starts[3] = {0, 0, 0};
-    uint32_t pulse_durations[3] = {0, 0, 0};
-    uint8_t sensor_states[3] = {0, 0, 0}; // 0 = waiting for HIGH, 1 = measuring HIGH, 2 = done
-
-    // Send a pulse to the ultrasonic sensor on each trigger pin
-    digitalWrite(m_trig_pins[0], LOW);
-    digitalWrite(m_trig_pins[1], LOW);
-    digitalWrite(m_trig_pins[2], LOW);
-    //while (micros() - start_micros < 2);
-    delayMicroseconds(2);
-    digitalWrite(m_trig_pins[0], HIGH);
-    digitalWrite(m_trig_pins[1], HIGH);
-    digitalWrite(m_trig_pins[2], HIGH);
-    //while (micros() - start_micros < 12);
-    delayMicroseconds(10);
-    digitalWrite(m_trig_pins[0], LOW);
-    digitalWrite(m_trig_pins[1], LOW);
-    digitalWrite(m_trig_pins[2], LOW);
-
-    // Monitor echo pins
-    uint32_t start_micros = micros();
-    while (micros() - start_micros < BALL_DETECTION_TIMEOUT)
-    {
-        for (uint8_t i = 0; i < 3; ++i)
-        {
-            if (sensor_states[i] == 0 && digitalRead(m_echo_pins[i]) == HIGH)
-            {   // Start timing the pulse
-                pulse_starts[i] = micros();
-                sensor_states[i] = 1;
-            }
-            else if (sensor_states[i] == 1 && digitalRead(m_echo_pins[i]) == LOW)
-            {   // Pulse ended, calculate duration
-                pulse_durations[i] = micros() - pulse_starts[i];
-                sensor_states[i] = 2;
-            }
-        }
+bool BasketSensor::attach_interrupt()
+{
+    if (m_irq_slot < MAX_IRQ_SENSORS) return true;
 
-        // Exit early if all sensors are done
-        if (sensor_states[0] == 2 && sensor_states[1] == 2 && sensor_states[2] == 2)
-        {
-            break;
-        }
+    if (digitalPinToInterrupt(m_echo_pin) == NOT_AN_INTERRUPT)
+    {
+        debugLib("[BasketSensor::attach_interrupt] Echo pin without interrupt support\n");
+        return false;
     }
 
-    // Convert durations to distances and then binary representation
-    BitmapPattern result = BitmapPattern::LAYOUT_0;
-    for (uint8_t i = 0; i < 3; ++i)
+    for (uint8_t i = 0; i < MAX_IRQ_SENSORS; ++i)
     {
-        if (pulse_durations[i])
+        if (!s_irq_instances[i])
         {
-            uint32_t distance = (pulse_durations[i] * SOUND_SPEED) / 2;
-            result |= ((distance > 1 && distance < BALL_DETECTION_THRESHOLD) ? 1 : 0) << i;
+            m_echo_armed = false;
+            m_echo_state = ECHO_IDLE; // A measurement in flight was sampled, start over
+            s_irq_instances[i] = this;
+            m_irq_slot = i;
+            attachInterrupt(digitalPinToInterrupt(m_echo_pin), s_echo_isrs[i], CHANGE);
+            return true;
         }
     }
-
-    return result;
+    return false;
 }
 
-// Return amount of shots converted by validating which sensors where triggered and which ones where valid
-// at any given time, by using a bitwise AND on the current valid Layout of rims and the (inputed) sensor readings
-uint8_t ThreeBasketSensors::filter_sensor_readings(const BitmapPattern in_curr_pattern, const BitmapPattern in_sensor_checks)
+void BasketSensor::detach_interrupt()
 {
-    if (!m_ready || in_sensor_checks >= BitmapPattern::LAYOUT_STOP) return 0;
+    if (m_irq_slot >= MAX_IRQ_SENSORS) return;
 
-    BitmapPattern valid_rims = in_curr_pattern & in_sensor_checks;
-    m_hoops_cooldown.update();
-    valid_rims &= ~m_hoops_cooldown.on_cooldown_pattern; // Flip bits corresponding to cooldown of each sensor
+    detachInterrupt(digitalPinToInterrupt(m_echo_pin));
+    s_irq_instances[m_irq_slot] = nullptr;
+    m_irq_slot = MAX_IRQ_SENSORS;
+    m_echo_state = ECHO_IDLE;
+}
 
-    debugLib("[ThreeBasketSensors::filter_sensor_readings] in_curr_pattern AND in_sensor_checks = ");
-    debugLibVal(valid_rims, BIN); debugLibln();
+// Timestamp the rising edge of the armed measurement and store the pulse width on its falling edge
+void BasketSensor::handle_echo_edge(uint8_t in_level, uint32_t in_micros)
+{
+    if (!m_echo_armed) return;
 
-    switch (valid_rims)
+    if (in_level == HIGH)
+    {
+        m_echo_rise = in_micros;
+        m_echo_high = true;
+    }
+    else if (m_echo_high)
     {
-        case LAYOUT_1:
-            m_hoops_cooldown.set_cooldown(0);
-        case LAYOUT_2:
-            m_hoops_cooldown.set_cooldown(1);
-        case LAYOUT_4:
-            m_hoops_cooldown.set_cooldown(2);
-            return 1; // One shot converted
-        case LAYOUT_3:
-            m_hoops_cooldown.set_cooldown(0);
-            m_hoops_cooldown.set_cooldown(1);
-        case LAYOUT_5:
-            m_hoops_cooldown.set_cooldown(0);
-            m_hoops_cooldown.set_cooldown(2);
-        case LAYOUT_6:
-            m_hoops_cooldown.set_cooldown(1);
-            m_hoops_cooldown.set_cooldown(2);
-            return 2; // Two shots converted
-        case LAYOUT_7:
-            m_hoops_cooldown.set_cooldown(0);
-            m_hoops_cooldown.set_cooldown(1);
-            m_hoops_cooldown.set_cooldown(2);
-            return 3; // Three shots converted
+        m_echo_width = in_micros - m_echo_rise;
+        m_echo_done = true;
+        m_echo_armed = false;
     }
-    return 0;         // None conveted
 }
+// BasketSensor Class (end)
 
 
-// MVPHoops (start)
-// Constructors
-MVPHoops::MVPHoops() : m_curr(0), m_next(1)
+// OSCPark (start)
+// Size of an OSC string field: the characters plus the null terminator, padded to a multiple of 4 bytes
+static size_t osc_padded_len(size_t in_len)
 {
-    m_layouts_arr = nullptr;
-    m_curr_pattern = BitmapPattern::LAYOUT_0; // Default Layout
+    return (in_len + 4) & ~static_cast<size_t>(3);
 }
 
-MVPHoops::MVPHoops(const Layout* in_layouts_arr, const uint8_t in_size) : m_curr(0), m_next(1)
+static void osc_write_be64(uint8_t* out_buffer, uint64_t in_value)
 {
-    init(in_layouts_arr, in_size);
+    osc_write_be32(out_buffer, in_value >> 32);
+    osc_write_be32(out_buffer + 4, in_value);
 }
 
-bool MVPHoops::init(const Layout* in_layouts_arr, const uint8_t in_size)
+static uint64_t osc_read_be64(const uint8_t* in_buffer)
 {
-    if (!validate_layouts_arr(in_layouts_arr, in_size))
-    {   // Invalid - raise error
-        return false;
-    }
-    m_layouts_arr = in_layouts_arr;
+    return (uint64_t(osc_read_be32(in_buffer)) << 32) | osc_read_be32(in_buffer + 4);
+}
 
-    // Copy the bool array from the Layout obj id
-    copy_pattern(&m_layouts_arr[m_curr]);
-    return true;
+// Bits of a double in the IEEE 754 binary64 wire format, and back
+#if __SIZEOF_DOUBLE__ == 8
+static uint64_t osc_double_to_bits(double in_value)
+{
+    uint64_t bits;
+    memcpy(&bits, &in_value, sizeof(bits));
+    return bits;
 }
 
-// Iterate over the array to validate its layouts and check its size argument
-bool MVPHoops::validate_layouts_arr(const Layout* in_layouts_arr, const uint8_t in_size)
+static double osc_bits_to_double(uint64_t in_bits)
 {
-    if (!in_layouts_arr)
-    {   // Handle nullptr error
-        return false;
-    }
-    else if (in_layouts_arr[0].active == BitmapPattern::LAYOUT_STOP || in_size < 2)
-    {   // Empty array or without valid layouts
-        return false;
-    }
+    double value;
+    memcpy(&value, &in_bits, sizeof(value));
+    return value;
+}
+#else
+// double is a 32 bits float (AVR), so the exponent is rebiased and the mantissa widened or truncated (subnormals flush to zero)
+static uint64_t osc_double_to_bits(double in_value)
+{
+    uint32_t bits;
+    memcpy(&bits, &in_value, sizeof(bits));
+
+    uint64_t sign = uint64_t(bits >> 31) << 63;
+    uint16_t exponent = (bits >> 23) & 0xFF;
+    uint64_t mantissa = uint64_t(bits & 0x7FFFFFUL) << 29;
 
-    uint8_t i = 0;
-    Layout curr_layout = in_layouts_arr[0];
+    if (exponent == 0) return sign;
+    if (exponent == 0xFF) return sign | (uint64_t(0x7FF) << 52) | mantissa;
+    return sign | (uint64_t(exponent - 127 + 1023) << 52) | mantissa;
+}
 
-    // Iterate until the second to last element
-    for(; i < in_size - 1 && curr_layout.active != BitmapPattern::LAYOUT_STOP; curr_layout = in_layouts_arr[++i])
+static double osc_bits_to_double(uint64_t in_bits)
+{
+    uint32_t sign = uint32_t(in_bits >> 63) << 31;
+    int16_t exponent = (in_bits >> 52) & 0x7FF;
+    uint32_t mantissa = (in_bits >> 29) & 0x7FFFFFUL;
+    uint32_t bits;
+
+    if (exponent == 0x7FF)
+    {   // Infinity or NaN (keep a NaN a NaN)
+        bits = sign | 0x7F800000UL | (mantissa ? mantissa : ((in_bits & 0xFFFFFFFFFFFFFULL) ? 1 : 0));
+    }
+    else if (exponent - 1023 + 127 >= 0xFF)
+    {   // Too large, infinity
+        bits = sign | 0x7F800000UL;
+    }
+    else if (exponent - 1023 + 127 <= 0)
+    {   // Too small, zero
+        bits = sign;
+    }
+    else
     {
-        if (curr_layout.active >= BitmapPattern::NUM_PATTERNS) return false;
+        bits = sign | (uint32_t(exponent - 1023 + 127) << 23) | mantissa;
     }
 
-    // Checks the in_size and if the last element in in_layouts_arr is the sentinel value
-    return (i == in_size - 1 && curr_layout.active == BitmapPattern::LAYOUT_STOP);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
 }
+#endif
 
-// Copy the BitmapPattern member variable Layout.active to m_curr_pattern
-void MVPHoops::copy_pattern(const Layout* in_layout)
+/* Typed reads of an argument in the wire format (in_data points to its first byte), shared by OSCPark and OSCView.
+   Numbers convert between i, f, h and d (and T/F for the integers), other mismatches return 0, false or nullptr. */
+static int64_t osc_arg_as_int64(char in_type, const uint8_t* in_data);
+static double osc_arg_as_double(char in_type, const uint8_t* in_data);
+
+static int32_t osc_arg_as_int(char in_type, const uint8_t* in_data)
 {
-    m_curr_pattern = in_layout->active;
+    if (in_type == 'i') return static_cast<int32_t>(osc_read_be32(in_data));
+    return static_cast<int32_t>(osc_arg_as_int64(in_type, in_data));
 }
 
-// Update the current valid layout by dereferencing the next available Layout obj by checking the in_time argument and returning the "game state"
-MVPHoops::MVPState MVPHoops::update(const uint32_t in_time)
+static float osc_arg_as_float(char in_type, const uint8_t* in_data)
 {
-    if (!m_layouts_arr)
+    if (in_type == 'f')
     {
-        return MVP_GAME_OVER;
+        uint32_t bits = osc_read_be32(in_data);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
     }
-    else if (in_time >= m_layouts_arr[m_next].time)
+    return static_cast<float>(osc_arg_as_double(in_type, in_data));
+}
+
+static int64_t osc_arg_as_int64(char in_type, const uint8_t* in_data)
+{
+    switch (in_type)
     {
-        if (m_layouts_arr[++m_curr].active == BitmapPattern::LAYOUT_STOP)
-        {
-            // End of the transitions
-            reset();
-            return MVP_GAME_OVER;
-        }
-        copy_pattern(&m_layouts_arr[m_next++]);
+        case 'h': return static_cast<int64_t>(osc_read_be64(in_data));
+        case 'i': return static_cast<int32_t>(osc_read_be32(in_data));
+        case 'f': return static_cast<int64_t>(osc_arg_as_float(in_type, in_data));
+        case 'd': return static_cast<int64_t>(osc_arg_as_double(in_type, in_data));
+        case 'T': return 1;
+        default: return 0;
     }
-    else if (in_time < m_layouts_arr[m_curr].time)
+}
+
+static double osc_arg_as_double(char in_type, const uint8_t* in_data)
+{
+    switch (in_type)
     {
-        return MVP_HOLD;
+        case 'd': return osc_bits_to_double(osc_read_be64(in_data));
+        case 'f': return osc_arg_as_float(in_type, in_data);
+        case 'i':
+        case 'h': return static_cast<double>(osc_arg_as_int64(in_type, in_data));
+        default: return 0;
     }
+}
 
-    return MVP_RUNNING;
+static bool osc_arg_as_bool(char in_type, const uint8_t* in_data)
+{
+    return in_type == 'T' || osc_arg_as_int64(in_type, in_data) != 0;
 }
 
-MVPHoops::MVPState MVPHoops::reset()
+static const uint8_t* osc_arg_as_blob(char in_type, const uint8_t* in_data, uint16_t& out_len)
 {
-    m_curr = 0;
-    m_next = 1;
-    if (m_layouts_arr)
-        copy_pattern(&m_layouts_arr[m_curr]);
+    out_len = 0;
+    if (in_type != 'b') return nullptr;
 
-    return MVP_GAME_OVER;
+    out_len = osc_read_be32(in_data);
+    return in_data + 4;
 }
-// MVPHoops (end)
 
+static bool osc_arg_as_timetag(char in_type, const uint8_t* in_data, uint32_t& out_seconds, uint32_t& out_fraction)
+{
+    if (in_type != 't') return false;
+
+    out_seconds = osc_read_be32(in_data);
+    out_fraction = osc_read_be32(in_data + 4);
+    return true;
+}
 
-// OSCPark (start)
 // Constructors
 // Default
-OSCPark::OSCPark() : m_addr{'\0'}, m_type_tags{'\0'}, m_addr_len(0), m_type_len(0), m_values_len(0) {}
+OSCPark::OSCPark()
+    : m_addr{'\0'}, m_type_tags{'\0'}, m_arg_offsets{}, m_data_inline{}, m_data(m_data_inline), m_data_size(sizeof(m_data_inline)),
+      m_data_len(0), m_addr_len(0), m_type_len(0) {}
 
-OSCPark::OSCPark(const uint8_t* in_buffer)
+OSCPark::OSCPark(const uint8_t* in_buffer, size_t in_len) : OSCPark()
 {
-    init(in_buffer);
+    init(in_buffer, in_len);
 }
 
-OSCPark::OSCPark(const char* in_address)
+OSCPark::OSCPark(const char* in_address) : OSCPark()
 {
     init(in_address);
 }
 
-void OSCPark::init(const uint8_t* in_buffer)
+// Copies keep using their own inline storage, a caller bound buffer stays shared
+OSCPark::OSCPark(const OSCPark& in_other) : OSCPark()
+{
+    *this = in_other;
+}
+
+OSCPark& OSCPark::operator=(const OSCPark& in_other)
 {
-    debugLib("[OSCPark::init] Raw bytes: ");
-    for (int i = 0; i < 65; ++i) // Condition can be adjusted to print enough bytes
+    if (this == &in_other) return *this;
+
+    memcpy(m_addr, in_other.m_addr, sizeof(m_addr));
+    memcpy(m_type_tags, in_other.m_type_tags, sizeof(m_type_tags));
+    memcpy(m_arg_offsets, in_other.m_arg_offsets, sizeof(m_arg_offsets));
+    m_addr_len = in_other.m_addr_len;
+    m_type_len = in_other.m_type_len;
+    m_data_len = in_other.m_data_len;
+
+    if (in_other.m_data == in_other.m_data_inline)
     {
-        debugLibVal(in_buffer[i], HEX);
-        debugLib(" ");
+        memcpy(m_data_inline, in_other.m_data_inline, sizeof(m_data_inline));
+        m_data = m_data_inline;
+        m_data_size = sizeof(m_data_inline);
     }
-    debugLibln();
+    else
+    {
+        m_data = in_other.m_data;
+        m_data_size = in_other.m_data_size;
+    }
+    return *this;
+}
+
+bool OSCPark::init(const uint8_t* in_buffer, size_t in_len)
+{
+    debugLibLog(LOG_OSC_INIT, osc_read_be32(in_buffer), osc_read_be32(in_buffer + 4), osc_read_be32(in_buffer + 8), osc_read_be32(in_buffer + 12));
 
     const uint8_t* ptr = in_buffer;
+    const uint8_t* end = in_buffer + in_len;
 
     // Extract address pattern (null-terminated, 4-byte aligned)
-    m_addr_len = strnlen((const char*)ptr, sizeof(m_addr));
+    m_addr_len = strnlen((const char*)ptr, sizeof(m_addr) - 1);
     memcpy(m_addr, ptr, m_addr_len);
     m_addr[m_addr_len] = '\0';
-    ptr += (m_addr_len + 1 + 3) & ~3;  // Move to 4-byte boundary (m_addr_len + 1 null char)
+    ptr += osc_padded_len(strnlen((const char*)ptr, OSC_MAX_ADDRESS_LEN));
+
+    clear_args();
 
     // Extract type tag string (starts with ',')
-    m_type_len = strnlen((const char*)ptr, sizeof(m_type_tags));
-    if (m_type_len > 1)
-    {   // Skip the byte containing ',' by copying from the ptr + 1
-        memcpy(m_type_tags, ptr + 1, m_type_len--); // Decrement m_type_len to store the amount of type tags without the comma
-    }
-    m_type_tags[m_type_len] = '\0';
-    ptr += (m_type_len + 1 + 3) & ~3;
+    if (ptr >= end || *ptr != ',') return true;
+    const char* type_tags = (const char*)ptr + 1;
+    uint8_t type_len = strnlen(type_tags, OSC_MAX_ADDRESS_LEN - 1);
+    ptr += osc_padded_len(type_len + 1);
+
+    // Extract the arguments, stops at the first unsupported type (its size is unknown) or at the first that doesn't fit
+    for (uint8_t i = 0; i < type_len && i < OSC_MAX_ARGS; ++i)
+    {
+        bool added;
+        uint32_t size;
+        size_t left = (ptr < end) ? static_cast<size_t>(end - ptr) : 0; // Bytes of the packet not read yet
+        switch (type_tags[i])
+        {
+            case 'i':
+            case 'f':
+                size = 4;
+                added = size <= left && reserve_arg(type_tags[i], size) != nullptr;
+                if (added) memcpy(m_data + m_arg_offsets[i], ptr, size);
+                break;
+            case 'h':
+            case 'd':
+            case 't':
+                size = 8;
+                added = size <= left && reserve_arg(type_tags[i], size) != nullptr;
+                if (added) memcpy(m_data + m_arg_offsets[i], ptr, size);
+                break;
+            case 's':
+                size = osc_padded_len(strnlen((const char*)ptr, OSC_MAX_ADDRESS_LEN));
+                added = size <= left && (add_string((const char*)ptr) || m_type_len > i); // Truncated strings are kept
+                break;
+            case 'b':
+            {
+                uint32_t blob_len = (left >= 4) ? osc_read_be32(ptr) : 0;
+                size = 4 + ((blob_len + 3) & ~3UL);
+                added = left >= 4 && blob_len <= left - 4 && blob_len <= 0xFFFFU && add_blob(ptr + 4, blob_len);
+                break;
+            }
+            case 'T':
+            case 'F':
+            case 'N':
+                size = 0;
+                added = reserve_arg(type_tags[i], 0) != nullptr;
+                break;
+            default:
+                debugLib("[OSCPark::init] Unsupported type tag\n");
+                added = false;
+                break;
+        }
 
-    // Extract value (currently only support messages with one type_tag)
-    m_value.setup(m_type_tags[0], ptr);
+        if (!added) return false;
+        ptr += size;
+    }
+    return type_len <= OSC_MAX_ARGS;
 }
 
-// Initialize an instance with an address but without a value.
-// If the object was initialized previously with a value of type String, ensure to call clear() to free any dynamically allocated memory.
+// Initialize an instance with an address but without arguments
 void OSCPark::init(const char* in_address)
 {
-    memcpy(&m_addr, in_address, sizeof(m_addr));
-    m_type_tags[0] = '\0';
-    m_addr_len = strnlen(m_addr, sizeof(m_addr));
-    m_type_len = 0;
-    m_values_len = 0;
-    m_value.type_tag = '\0';
+    m_addr_len = strnlen(in_address, sizeof(m_addr) - 1);
+    memcpy(m_addr, in_address, m_addr_len);
+    m_addr[m_addr_len] = '\0';
+    clear_args();
 }
 
-void OSCPark::Value::setup(const char in_type_tag, const uint8_t* in_ptr)
+// Append the type tag of a new argument and reserve in_size bytes for it, nullptr if it doesn't fit
+uint8_t* OSCPark::reserve_arg(char in_type, uint16_t in_size)
 {
-    debugLib("[OSCPark::Value::setup] ");
-    uint8_t str_size = 0;
-    char* str_buffer = nullptr;
-
-    switch (in_type_tag)
+    if (m_type_len >= OSC_MAX_ARGS || in_size > m_data_size - m_data_len)
     {
-        case 'i':
-        {
-            debugLib("Type: INT\n");
-            type_tag = 'i';
-            memcpy(&data.i_value, in_ptr, sizeof(data.i_value));
-            data.i_value = __builtin_bswap32(data.i_value);
-            break;
-        }
-        case 'f':
-        {
-            debugLib("Type: FLOAT\n");
-            type_tag = 'f';
-            memcpy(&data.f_value, in_ptr, sizeof(data.f_value));
-            uint32_t temp = __builtin_bswap32(*reinterpret_cast<uint32_t*>(&data.f_value));
-            data.f_value = *reinterpret_cast<float*>(&temp);
-            break;
-        }
-        case 's':
-        {
-            debugLib("Type: STRING\n");
-            type_tag = 's';
-            str_size = strnlen((const char*)in_ptr, 255);
-            str_buffer = new char[str_size + 1];
-            memcpy(str_buffer, in_ptr, str_size);
-            str_buffer[str_size] = '\0';
-            data.s_value = str_buffer;
-            break;
-        }
-        default:
-        {
-            debugLib("No valid type flag parsed...\n");
-            break;
-        }
+        debugLib("[OSCPark::reserve_arg] Argument doesn't fit\n");
+        return nullptr;
     }
+
+    m_arg_offsets[m_type_len] = m_data_len;
+    m_type_tags[m_type_len++] = in_type;
+    m_type_tags[m_type_len] = '\0';
+    m_data_len += in_size;
+    return m_data + m_arg_offsets[m_type_len - 1];
 }
 
-// Sets a string value for the instance
-void OSCPark::set_int(const int in_int)
+void OSCPark::clear_args()
 {
-    // Make sure to free the dinamic memory of s_value
-    if (m_value.type_tag == 's' && m_value.data.s_value != nullptr)
-    {
-        debugLib("[OSCPark::set_int] s_value memory freed");
-        delete[] m_value.data.s_value;
-    }
-
-    m_value.data.i_value = in_int;
+    m_type_tags[0] = '\0';
+    m_type_len = 0;
+    m_data_len = 0;
+}
 
-    m_values_len = 1;
-    m_type_len = 1;
-    m_type_tags[0] = 'i';
-    m_value.type_tag = 'i';
+// Sets an int value for the instance
+void OSCPark::set_int(const int32_t in_int)
+{
+    clear_args();
+    add_int(in_int);
 }
 
-// Sets a string value for the instance
+// Sets a float value for the instance
 void OSCPark::set_float(const float in_float)
 {
-    // Make sure to free the dinamic memory of s_value
-    if (m_value.type_tag == 's' && m_value.data.s_value != nullptr)
-    {
-        debugLib("[OSCPark::set_float] s_value memory freed");
-        delete[] m_value.data.s_value;
-    }
+    clear_args();
+    add_float(in_float);
+}
+
+// Sets a string value for the instance, returns false if it had to be truncated to fit the storage
+bool OSCPark::set_string(const char* in_str)
+{
+    clear_args();
+    return add_string(in_str);
+}
 
-    m_value.data.f_value = in_float;
+bool OSCPark::add_int(int32_t in_int)
+{
+    uint8_t* data = reserve_arg('i', 4);
+    if (!data) return false;
+
+    osc_write_be32(data, static_cast<uint32_t>(in_int));
+    return true;
+}
 
-    m_values_len = 1;
-    m_type_len = 1;
-    m_type_tags[0] = 'f';
-    m_value.type_tag = 'f';
+bool OSCPark::add_float(float in_float)
+{
+    uint8_t* data = reserve_arg('f', 4);
+    if (!data) return false;
+
+    uint32_t bits;
+    memcpy(&bits, &in_float, sizeof(bits));
+    osc_write_be32(data, bits);
+    return true;
 }
 
-// Sets a string value for the instance
-void OSCPark::set_string(const char* in_str)
+// A string longer than the free storage is truncated (still added, but returns false)
+bool OSCPark::add_string(const char* in_str)
 {
-    // Make sure to free the dinamic memory of s_value
-    if (m_value.type_tag == 's' && m_value.data.s_value != nullptr)
+    if (m_type_len >= OSC_MAX_ARGS || m_data_size - m_data_len < 4) return false;
+
+    uint16_t str_len = strnlen(in_str, m_data_size - m_data_len);
+    bool fits = osc_padded_len(str_len) <= static_cast<size_t>(m_data_size - m_data_len);
+    if (!fits)
     {
-        debugLib("[OSCPark::set_string] Previous s_value memory freed");
-        delete[] m_value.data.s_value;
+        debugLib("[OSCPark::add_string] String truncated\n");
+        str_len = ((m_data_size - m_data_len) & ~3) - 1;
     }
 
-    uint8_t str_len = strnlen(in_str, 255);
+    uint16_t size = osc_padded_len(str_len);
+    uint8_t* data = reserve_arg('s', size);
+    memcpy(data, in_str, str_len);
+    memset(data + str_len, 0, size - str_len);
+    return fits;
+}
+
+bool OSCPark::add_blob(const uint8_t* in_blob, uint16_t in_len)
+{
+    // In 32 bits, 4 + padded length of a 16-bit in_len would wrap the uint16_t size of reserve_arg()
+    uint32_t padded_len = (static_cast<uint32_t>(in_len) + 3) & ~3UL;
+    if (4 + padded_len > static_cast<uint32_t>(m_data_size - m_data_len)) return false;
+    uint8_t* data = reserve_arg('b', static_cast<uint16_t>(4 + padded_len));
+    if (!data) return false;
+
+    osc_write_be32(data, in_len);
+    memcpy(data + 4, in_blob, in_len);
+    memset(data + 4 + in_len, 0, padded_len - in_len);
+    return true;
+}
 
-    m_value.data.s_value = new char[str_len + 1];
-    memcpy(m_value.data.s_value, in_str, str_len);
-    m_value.data.s_value[str_len] = '\0';
+bool OSCPark::add_int64(int64_t in_int)
+{
+    uint8_t* data = reserve_arg('h', 8);
+    if (!data) return false;
 
-    m_values_len = 1;
-    m_type_len = 1;
-    m_type_tags[0] = 's';
-    m_value.type_tag = 's';
+    osc_write_be64(data, static_cast<uint64_t>(in_int));
+    return true;
 }
 
-void OSCPark::send(Print &in_p)
+bool OSCPark::add_double(double in_double)
 {
-    debugLib("[OSCPark::send] SENDING\n");
-    uint8_t padding_len;
-    uint8_t total_len;
+    uint8_t* data = reserve_arg('d', 8);
+    if (!data) return false;
 
-    // Write address to the packet
-    in_p.write(reinterpret_cast<uint8_t*>(m_addr), m_addr_len);
-    in_p.write('\0'); // Adding null terminator
-    // Add padding if neccessary
-    total_len = m_addr_len + 1; // Including the null terminator
-    padding_len = (4 - (total_len % 4)) % 4;
-    while (padding_len--)
-    {
-       in_p.write('\0');
-    }
+    osc_write_be64(data, osc_double_to_bits(in_double));
+    return true;
+}
 
-    // Stop here if no type tag in message
-    if (m_values_len < 1) return;
+bool OSCPark::add_timetag(uint32_t in_seconds, uint32_t in_fraction)
+{
+    uint8_t* data = reserve_arg('t', 8);
+    if (!data) return false;
 
-    // Write type tag
-    in_p.write(static_cast<uint8_t>(','));
-    in_p.write(static_cast<uint8_t>(m_type_tags[0]));
-    in_p.write('\0'); // Adding null terminator
-    // Add padding if neccessary
-    total_len = m_type_len + 2; // +1 for the comma and +1 for the null terminator
-    padding_len = (4 - (total_len % 4)) % 4;
-    while (padding_len--)
-    {
-        in_p.write('\0');
-    }
+    osc_write_be32(data, in_seconds);
+    osc_write_be32(data + 4, in_fraction);
+    return true;
+}
 
-    switch (m_type_tags[0])
+bool OSCPark::add_bool(bool in_bool)
+{
+    return reserve_arg(in_bool ? 'T' : 'F', 0) != nullptr;
+}
+
+bool OSCPark::add_nil()
+{
+    return reserve_arg('N', 0) != nullptr;
+}
+
+/* Use in_buffer (in_size bytes, kept alive by the caller) as the argument storage instead of the inline buffer,
+   a nullptr (or a size under 4) goes back to the inline buffer. The current arguments are dropped. */
+void OSCPark::bind_data_buffer(uint8_t* in_buffer, uint16_t in_size)
+{
+    if (!in_buffer || in_size < 4)
     {
-        case 'i':
-        {
-            uint32_t temp = __builtin_bswap32(m_value.data.i_value);
-            in_p.write(reinterpret_cast<uint8_t*>(&temp), sizeof(uint32_t));
-            break;
-        }
-        case 'f':
-        {
-            uint32_t temp = *reinterpret_cast<uint32_t*>(&m_value.data.f_value);
-            temp = __builtin_bswap32(temp);
-            in_p.write(reinterpret_cast<uint8_t*>(&temp), sizeof(uint32_t));
-            break;
-        }
-        case 's':
-        {
-            int s_value_len = strnlen(m_value.data.s_value, 255);
-            in_p.write(reinterpret_cast<uint8_t*>(m_value.data.s_value), s_value_len); // Max length of 255
-            in_p.write('\0');
-            total_len = s_value_len + 1;
-            padding_len = (4 - (total_len % 4)) % 4;
-            while (padding_len--)
-            {
-                in_p.write('\0');
-            }
-            break;
-        }
-        default:
-        {
-            debugLib("Not a supported type...\n");
-            break;
-        }
+        m_data = m_data_inline;
+        m_data_size = sizeof(m_data_inline);
+    }
+    else
+    {
+        m_data = in_buffer;
+        m_data_size = in_size;
     }
+    clear_args();
 }
 
-// Reset the member variables to zero and free any dynamically allocated memory
-void OSCPark::clear()
+int32_t OSCPark::get_int(uint8_t in_index) const
 {
-    m_addr[0] = '\0';
-    m_type_tags[0] = '\0';
-    m_addr_len = 0;
-    m_type_len = 0;
-    m_values_len = 0;
+    return osc_arg_as_int(get_arg_type(in_index), arg_data(in_index));
+}
+
+float OSCPark::get_float(uint8_t in_index) const
+{
+    return osc_arg_as_float(get_arg_type(in_index), arg_data(in_index));
+}
+
+int64_t OSCPark::get_int64(uint8_t in_index) const
+{
+    return osc_arg_as_int64(get_arg_type(in_index), arg_data(in_index));
+}
+
+double OSCPark::get_double(uint8_t in_index) const
+{
+    return osc_arg_as_double(get_arg_type(in_index), arg_data(in_index));
+}
+
+// Null terminated string in the argument storage, nullptr if the argument isn't a string
+char* OSCPark::get_str(uint8_t in_index) const
+{
+    if (get_arg_type(in_index) != 's') return nullptr;
+    return reinterpret_cast<char*>(m_data + m_arg_offsets[in_index]);
+}
+
+const uint8_t* OSCPark::get_blob(uint8_t in_index, uint16_t& out_len) const
+{
+    return osc_arg_as_blob(get_arg_type(in_index), arg_data(in_index), out_len);
+}
+
+bool OSCPark::get_timetag(uint8_t in_index, uint32_t& out_seconds, uint32_t& out_fraction) const
+{
+    return osc_arg_as_timetag(get_arg_type(in_index), arg_data(in_index), out_seconds, out_fraction);
+}
+
+bool OSCPark::get_bool(uint8_t in_index) const
+{
+    return osc_arg_as_bool(get_arg_type(in_index), arg_data(in_index));
+}
 
-    switch (m_value.type_tag)
+// Number of bytes the message takes in the OSC wire format
+size_t OSCPark::serialized_size() const
+{
+    size_t size = osc_padded_len(m_addr_len);
+
+    // Only the address if no type tag in message
+    if (m_type_len < 1) return size;
+
+    return size + osc_padded_len(m_type_len + 1) + m_data_len; // ',' + type tags + null terminator + padding, then the arguments
+}
+
+/* Encode the whole message (address, type tags and arguments, padded to 4 bytes) into out_buffer in one pass.
+   Returns the number of bytes written, or 0 if it doesn't fit in_capacity. */
+size_t OSCPark::serialize(uint8_t* out_buffer, size_t in_capacity) const
+{
+    size_t size = serialized_size();
+    if (!out_buffer || size > in_capacity) return 0;
+
+    size_t addr_size = osc_padded_len(m_addr_len);
+    memcpy(out_buffer, m_addr, m_addr_len);
+    memset(out_buffer + m_addr_len, 0, addr_size - m_addr_len); // Null terminator and padding
+    if (m_type_len < 1) return size;
+
+    uint8_t* ptr = out_buffer + addr_size;
+    size_t tags_size = osc_padded_len(m_type_len + 1);
+    ptr[0] = ',';
+    memcpy(ptr + 1, m_type_tags, m_type_len);
+    memset(ptr + 1 + m_type_len, 0, tags_size - 1 - m_type_len);
+
+    memcpy(ptr + tags_size, m_data, m_data_len); // Arguments are stored in the wire format
+    return size;
+}
+
+// Serialize the message and hand it to in_p with a single write() call
+// Returns false if the message is longer than OSC_MAX_PACKET_LEN (use serialize() with a larger buffer) or the write fails
+bool OSCPark::send(Print& in_p) const
+{
+    uint8_t buffer[OSC_MAX_PACKET_LEN];
+    size_t len = serialize(buffer, sizeof(buffer));
+    if (!len)
     {
-        case 'i':
-            m_value.data.i_value = 0;
-            break;
-        case 'f':
-            m_value.data.f_value = 0;
-            break;
-        case 's':
-            delete[] m_value.data.s_value;
-            m_value.data.s_value = nullptr;
-            break;
+        debugLib("[OSCPark::send] Message longer than OSC_MAX_PACKET_LEN\n");
+        return false;
     }
-    m_value.type_tag = '\0';
+    debugLibLog(LOG_OSC_SEND, len);
+    return in_p.write(buffer, len) == len;
+}
+
+// Reset the member variables to zero (the argument storage binding is kept)
+void OSCPark::clear()
+{
+    m_addr[0] = '\0';
+    m_addr_len = 0;
+    clear_args();
 }
 
 // Prints to the DEBUG_OUTPUT the characters representation of the OSC message in the obj
@@ -703,96 +1110,899 @@ void OSCPark::print() const
     if (m_addr_len <= 0)
     {
         DEBUG_OUTPUT.print("OSCPark obj is empty...\n");
+        return;
+    }
+
+    DEBUG_OUTPUT.print(m_addr);
+    if (m_type_len > 0)
+    {
+        DEBUG_OUTPUT.print(",");
+        DEBUG_OUTPUT.print(m_type_tags);
+    }
+
+    // Parentheses added after the type tags for clarity, one pair per argument
+    for (uint8_t i = 0; i < m_type_len; ++i)
+    {
+        DEBUG_OUTPUT.print("(");
+        switch (m_type_tags[i])
+        {
+            case 'i':
+            case 'h':
+                DEBUG_OUTPUT.print(static_cast<long>(get_int64(i)));
+                break;
+            case 'f':
+            case 'd':
+                DEBUG_OUTPUT.print(get_double(i), 4);
+                break;
+            case 's':
+                DEBUG_OUTPUT.print(get_str(i));
+                break;
+            case 'b':
+            {
+                uint16_t len;
+                get_blob(i, len);
+                DEBUG_OUTPUT.print(len);
+                DEBUG_OUTPUT.print(" bytes");
+                break;
+            }
+            case 't':
+            {
+                uint32_t seconds = 0, fraction = 0;
+                get_timetag(i, seconds, fraction);
+                DEBUG_OUTPUT.print(seconds);
+                DEBUG_OUTPUT.print(".");
+                DEBUG_OUTPUT.print(fraction);
+                break;
+            }
+            case 'T':
+                DEBUG_OUTPUT.print("true");
+                break;
+            case 'F':
+                DEBUG_OUTPUT.print("false");
+                break;
+            default:
+                DEBUG_OUTPUT.print("nil");
+                break;
+        }
+        DEBUG_OUTPUT.print(")");
+    }
+    DEBUG_OUTPUT.print("\n");
+}
+
+// Prints to the DEBUG_OUTPUT the info of each member var of the obj
+void OSCPark::info() const
+{
+    char buffer[128];
+
+    snprintf((char*)buffer, sizeof(buffer), "Address: %s", m_addr);
+    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+
+    if (m_type_len)
+    {
+        snprintf((char*)buffer, sizeof(buffer), "Type tags: %s", m_type_tags);
+        DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
     }
     else
     {
-        char osc_message_buffer[255];
-        osc_message_buffer[0] = '\0';
+        DEBUG_OUTPUT.print("NO VALUE\n");
+    }
+
+    snprintf((char*)buffer, sizeof(buffer), "m_addr_len: %d", m_addr_len);
+    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+
+    snprintf((char*)buffer, sizeof(buffer), "m_type_len: %d", m_type_len);
+    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+
+    snprintf((char*)buffer, sizeof(buffer), "m_data_len: %u / %u", m_data_len, m_data_size);
+    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+}
+// OSCPark (end)
+
+
+// OSCView (start)
+OSCView::OSCView() : m_buffer(nullptr), m_len(0), m_addr_len(0), m_type_tags(""), m_arg_count(0), m_arg_offsets{}, m_valid(false) {}
+
+OSCView::OSCView(const uint8_t* in_buffer, size_t in_len) : OSCView()
+{
+    parse(in_buffer, in_len);
+}
+
+/* Validate the whole message in one pass: 4-byte aligned length, null terminated address starting with '/', a type tag
+   string starting with ',' (or none at all) and every argument inside in_len. Only offsets are stored, nothing is copied.
+   Messages with more than OSC_MAX_ARGS arguments are validated entirely but only the first OSC_MAX_ARGS are accessible. */
+bool OSCView::parse(const uint8_t* in_buffer, size_t in_len)
+{
+    m_buffer = in_buffer;
+    m_len = in_len;
+    m_addr_len = 0;
+    m_type_tags = "";
+    m_arg_count = 0;
+    m_valid = false;
+
+    if (!in_buffer || in_len < 4 || (in_len & 3) || in_buffer[0] != '/') return false;
+
+    // Address
+    const uint8_t* end = static_cast<const uint8_t*>(memchr(in_buffer, '\0', in_len));
+    if (!end) return false;
+    m_addr_len = end - in_buffer;
+    size_t pos = osc_padded_len(m_addr_len);
+    if (pos > in_len) return false;
+
+    // No type tag string (OSC 1.0 allows it), only the address
+    if (pos == in_len) return m_valid = true;
+
+    // Type tags
+    if (in_buffer[pos] != ',') return false;
+    const char* type_tags = reinterpret_cast<const char*>(in_buffer + pos + 1);
+    end = static_cast<const uint8_t*>(memchr(type_tags, '\0', in_len - pos - 1));
+    if (!end) return false;
+    size_t type_len = end - reinterpret_cast<const uint8_t*>(type_tags);
+    pos += osc_padded_len(type_len + 1);
+    if (pos > in_len) return false;
+
+    // Arguments
+    for (size_t i = 0; i < type_len; ++i)
+    {
+        size_t remaining = in_len - pos;
+        size_t size;
+        switch (type_tags[i])
+        {
+            case 'i':
+            case 'f':
+                size = 4;
+                break;
+            case 'h':
+            case 'd':
+            case 't':
+                size = 8;
+                break;
+            case 's':
+                end = static_cast<const uint8_t*>(memchr(in_buffer + pos, '\0', remaining));
+                if (!end) return false;
+                size = osc_padded_len(end - (in_buffer + pos));
+                break;
+            case 'b':
+                if (remaining < 4) return false;
+                size = osc_read_be32(in_buffer + pos);
+                if (size > remaining - 4) return false;
+                size = 4 + ((size + 3) & ~static_cast<size_t>(3));
+                break;
+            case 'T':
+            case 'F':
+            case 'N':
+                size = 0;
+                break;
+            default:
+                return false; // Size unknown
+        }
+        if (size > remaining) return false;
+
+        if (i < OSC_MAX_ARGS) m_arg_offsets[i] = pos;
+        pos += size;
+    }
+
+    m_type_tags = type_tags;
+    m_arg_count = (type_len < OSC_MAX_ARGS) ? type_len : OSC_MAX_ARGS;
+    return m_valid = true;
+}
+
+// Compare the address with a null terminated string, without copying it
+bool OSCView::addr_equals(const char* in_address) const
+{
+    return m_valid && strncmp(get_addr(), in_address, m_addr_len + 1) == 0;
+}
+
+int32_t OSCView::get_int(uint8_t in_index) const
+{
+    return osc_arg_as_int(get_arg_type(in_index), arg_data(in_index));
+}
 
-        // Currently only support messages with one type_tag
-        if (m_values_len > 0)
-        { // Parentheses added after the type tags for clarity
-            switch (m_type_tags[0])
+float OSCView::get_float(uint8_t in_index) const
+{
+    return osc_arg_as_float(get_arg_type(in_index), arg_data(in_index));
+}
+
+int64_t OSCView::get_int64(uint8_t in_index) const
+{
+    return osc_arg_as_int64(get_arg_type(in_index), arg_data(in_index));
+}
+
+double OSCView::get_double(uint8_t in_index) const
+{
+    return osc_arg_as_double(get_arg_type(in_index), arg_data(in_index));
+}
+
+// Null terminated string inside the viewed buffer, nullptr if the argument isn't a string
+const char* OSCView::get_str(uint8_t in_index) const
+{
+    if (get_arg_type(in_index) != 's') return nullptr;
+    return reinterpret_cast<const char*>(arg_data(in_index));
+}
+
+const uint8_t* OSCView::get_blob(uint8_t in_index, uint16_t& out_len) const
+{
+    return osc_arg_as_blob(get_arg_type(in_index), arg_data(in_index), out_len);
+}
+
+bool OSCView::get_timetag(uint8_t in_index, uint32_t& out_seconds, uint32_t& out_fraction) const
+{
+    return osc_arg_as_timetag(get_arg_type(in_index), arg_data(in_index), out_seconds, out_fraction);
+}
+
+bool OSCView::get_bool(uint8_t in_index) const
+{
+    return osc_arg_as_bool(get_arg_type(in_index), arg_data(in_index));
+}
+// OSCView (end)
+
+
+// OSCRouter (start)
+uint32_t osc_address_hash(const char* in_address, uint16_t in_len)
+{
+    uint32_t hash = 2166136261UL;
+    for (uint16_t i = 0; i < in_len; ++i)
+    {
+        hash ^= static_cast<uint8_t>(in_address[i]);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+bool osc_is_pattern(const char* in_address)
+{
+    return strpbrk(in_address, "*?[{") != nullptr;
+}
+
+bool osc_pattern_match(const char* in_pattern, const char* in_address)
+{
+    const char* p = in_pattern;
+    const char* a = in_address;
+
+    while (true)
+    {
+        switch (*p)
+        {
+            case '\0':
+                return *a == '\0';
+
+            case '?':
+                if (*a == '\0' || *a == '/') return false;
+                ++p;
+                ++a;
+                break;
+
+            case '*':
+            {
+                while (*p == '*') ++p;
+                // Try every split of the rest of this address part (backtracking)
+                for (const char* rest = a; ; ++rest)
+                {
+                    if (osc_pattern_match(p, rest)) return true;
+                    if (*rest == '\0' || *rest == '/') return false;
+                }
+            }
+
+            case '[':
             {
-                case 'i':
-                    snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s,%c(%ld)", m_addr, m_type_tags[0], m_value.data.i_value);
-                    break;
-                case 'f':
-                    // Convert float to string with fixed precision
-                    char float_str[7];  // Allocate a buffer for the string representation of the float (4 decimals + '.' + the integer part + '\0')
-                    dtostrf(m_value.data.f_value, 1, 4, float_str);  // dtostrf converts float to string with 4 decimals
-                    snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s,%c(%s)", m_addr, m_type_tags[0], float_str);
-                    break;
-                case 's':
-                    if (m_value.data.s_value != nullptr)
+                if (*a == '\0' || *a == '/') return false;
+                ++p;
+                bool negate = (*p == '!');
+                if (negate) ++p;
+
+                bool matched = false;
+                while (*p != ']')
+                {
+                    if (*p == '\0') return false; // Unterminated set
+                    if (p[1] == '-' && p[2] != ']' && p[2] != '\0')
                     {
-                        snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s,%c(%s)", m_addr, m_type_tags[0], m_value.data.s_value);
+                        char first = p[0] < p[2] ? p[0] : p[2];
+                        char last = p[0] < p[2] ? p[2] : p[0];
+                        if (*a >= first && *a <= last) matched = true;
+                        p += 3;
                     }
                     else
                     {
-                        snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s,%c(NULL)", m_addr, m_type_tags[0]);
+                        if (*a == *p) matched = true;
+                        ++p;
                     }
-                    break;
-                default:
-                    snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s,%c(error parsing the value)", m_addr, m_type_tags[0]);
-                    break;
+                }
+                if (matched == negate) return false;
+                ++p;
+                ++a;
+                break;
             }
+
+            case '{':
+            {
+                const char* end = strchr(p, '}');
+                if (!end) return false; // Unterminated list
+
+                const char* option = p + 1;
+                while (option <= end)
+                {
+                    const char* option_end = option;
+                    while (option_end < end && *option_end != ',') ++option_end;
+
+                    size_t option_len = option_end - option;
+                    if (strncmp(a, option, option_len) == 0 && osc_pattern_match(end + 1, a + option_len)) return true;
+                    option = option_end + 1;
+                }
+                return false;
+            }
+
+            default:
+                if (*p != *a) return false;
+                ++p;
+                ++a;
+                break;
         }
+    }
+}
+// OSCRouter (end)
+
+
+// OSC bundles (start)
+static const char OSC_BUNDLE_TAG[8] = {'#', 'b', 'u', 'n', 'd', 'l', 'e', '\0'};
+
+OSCBundleWriter::OSCBundleWriter(uint8_t* in_buffer, size_t in_capacity, uint32_t in_seconds, uint32_t in_fraction)
+    : m_buffer(in_buffer), m_capacity(in_capacity), m_size(0), m_count(0)
+{
+    reset(in_seconds, in_fraction);
+}
+
+// Write "#bundle" and the timetag in the HEADER_SIZE bytes of out_header (used to stream a bundle without a buffer)
+void OSCBundleWriter::write_header(uint8_t* out_header, uint32_t in_seconds, uint32_t in_fraction)
+{
+    memcpy(out_header, OSC_BUNDLE_TAG, sizeof(OSC_BUNDLE_TAG));
+    osc_write_be32(out_header + 8, in_seconds);
+    osc_write_be32(out_header + 12, in_fraction);
+}
+
+// Drop the elements and write the bundle header with a new timetag, false if the buffer can't hold the header
+bool OSCBundleWriter::reset(uint32_t in_seconds, uint32_t in_fraction)
+{
+    m_size = 0;
+    m_count = 0;
+    if (!m_buffer || m_capacity < HEADER_SIZE) return false;
+
+    write_header(m_buffer, in_seconds, in_fraction);
+    m_size = HEADER_SIZE;
+    return true;
+}
+
+bool OSCBundleWriter::add(const OSCPark& in_msg)
+{
+    size_t capacity;
+    uint8_t* element = begin_element(capacity);
+    return element && end_element(in_msg.serialize(element, capacity));
+}
+
+bool OSCBundleWriter::add(const uint8_t* in_msg, size_t in_len)
+{
+    size_t capacity;
+    uint8_t* element = begin_element(capacity);
+    if (!element || !in_msg || in_len > capacity) return false;
+
+    memcpy(element, in_msg, in_len);
+    return end_element(in_len);
+}
+
+// Where the next element is encoded (after its size field), nullptr if the bundle is full. Confirm it with end_element()
+uint8_t* OSCBundleWriter::begin_element(size_t& out_capacity)
+{
+    out_capacity = 0;
+    if (!m_size || m_size + 4 > m_capacity) return nullptr;
+
+    out_capacity = m_capacity - m_size - 4;
+    return m_buffer + m_size + 4;
+}
+
+// Commit the element encoded after begin_element(), its length must be a multiple of 4 (a zero length discards it)
+bool OSCBundleWriter::end_element(size_t in_len)
+{
+    if (!in_len || (in_len & 3) || !m_size || m_size + 4 + in_len > m_capacity) return false;
+
+    osc_write_be32(m_buffer + m_size, in_len);
+    m_size += 4 + in_len;
+    ++m_count;
+    return true;
+}
+
+bool OSCBundleWriter::send(Print& in_p) const
+{
+    if (!m_size) return false;
+    return in_p.write(m_buffer, m_size) == m_size;
+}
+
+OSCBundleReader::OSCBundleReader(const uint8_t* in_buffer, size_t in_len)
+    : m_buffer(in_buffer), m_len(in_len), m_pos(0)
+{
+    rewind();
+}
+
+bool OSCBundleReader::is_bundle(const uint8_t* in_buffer, size_t in_len)
+{
+    return in_buffer && in_len >= OSCBundleWriter::HEADER_SIZE && memcmp(in_buffer, OSC_BUNDLE_TAG, sizeof(OSC_BUNDLE_TAG)) == 0;
+}
+
+// Point out_element and out_len to the next element, false when there are no more (or the next one is malformed)
+bool OSCBundleReader::next(const uint8_t*& out_element, size_t& out_len)
+{
+    if (m_pos + 4 > m_len) return false;
+
+    uint32_t len = osc_read_be32(m_buffer + m_pos);
+    if (!len || (len & 3) || len > m_len - m_pos - 4)
+    {
+        debugLib("[OSCBundleReader::next] Malformed element size\n");
+        m_pos = m_len;
+        return false;
+    }
+
+    out_element = m_buffer + m_pos + 4;
+    out_len = len;
+    m_pos += 4 + len;
+    return true;
+}
+// OSC bundles (end)
+
+
+// SLIP (start)
+SLIPDecoder::SLIPDecoder(uint8_t* in_buffer, size_t in_capacity)
+    : m_buffer(in_buffer), m_capacity(in_buffer ? in_capacity : 0), m_len(0), m_frame_len(0), m_escape(false), m_error(false), m_dropped(0) {}
+
+// Returns true when in_byte completes a frame
+bool SLIPDecoder::feed(uint8_t in_byte)
+{
+    if (m_frame_len)
+    {   // The previous frame was handled, start a new one
+        m_frame_len = 0;
+        m_len = 0;
+    }
+
+    if (in_byte == SLIP_END)
+    {
+        bool complete = !m_error && !m_escape && m_len > 0;
+        if (m_error || m_escape)
+        {
+            ++m_dropped;
+        }
+        m_escape = false;
+        m_error = false;
+
+        if (!complete)
+        {
+            m_len = 0;
+            return false;
+        }
+        m_frame_len = m_len;
+        return true;
+    }
+
+    if (m_error) return false;
+
+    if (m_escape)
+    {
+        m_escape = false;
+        if (in_byte == SLIP_ESC_END) in_byte = SLIP_END;
+        else if (in_byte == SLIP_ESC_ESC) in_byte = SLIP_ESC;
         else
         {
-            // Only address
-            snprintf((char*)osc_message_buffer, sizeof(osc_message_buffer), "%s", m_addr);
+            m_error = true;
+            return false;
         }
-        DEBUG_OUTPUT.print(osc_message_buffer); DEBUG_OUTPUT.print("\n");
     }
+    else if (in_byte == SLIP_ESC)
+    {
+        m_escape = true;
+        return false;
+    }
+
+    if (m_len >= m_capacity)
+    {
+        m_error = true;
+        return false;
+    }
+    m_buffer[m_len++] = in_byte;
+    return false;
 }
 
-// Prints to the DEBUG_OUTPUT the info of each member var of the obj
-void OSCPark::info() const
+// Feed a chunk, stopping right after the first complete frame. Returns the number of bytes consumed, call it again
+// with the rest of the chunk once the frame is handled
+size_t SLIPDecoder::feed(const uint8_t* in_data, size_t in_len, bool& out_frame)
 {
-    char buffer[255];
+    out_frame = false;
+    for (size_t i = 0; i < in_len; ++i)
+    {
+        if (feed(in_data[i]))
+        {
+            out_frame = true;
+            return i + 1;
+        }
+    }
+    return in_len;
+}
 
-    snprintf((char*)buffer, sizeof(buffer), "Address: %s", m_addr);
-    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+// Consume the bytes already received by in_stream (never waits), returns true as soon as a frame is complete
+bool SLIPDecoder::read(Stream& in_stream)
+{
+    while (in_stream.available() > 0)
+    {
+        int c = in_stream.read();
+        if (c < 0) break;
+        if (feed(static_cast<uint8_t>(c))) return true;
+    }
+    return false;
+}
 
-    if (m_type_len)
+void SLIPDecoder::reset()
+{
+    m_len = 0;
+    m_frame_len = 0;
+    m_escape = false;
+    m_error = false;
+}
+
+size_t SLIPEncoder::write(uint8_t in_byte)
+{
+    return write(&in_byte, 1);
+}
+
+// Returns in_len when every byte was written (escaped)
+size_t SLIPEncoder::write(const uint8_t* in_buffer, size_t in_len)
+{
+    static const uint8_t ESCAPED_END[2] = {SLIP_ESC, SLIP_ESC_END};
+    static const uint8_t ESCAPED_ESC[2] = {SLIP_ESC, SLIP_ESC_ESC};
+
+    size_t run_start = 0;
+    for (size_t i = 0; i < in_len; ++i)
     {
-        snprintf((char*)buffer, sizeof(buffer), "Type tags: %c", m_type_tags[0]);
-        DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+        if (in_buffer[i] != SLIP_END && in_buffer[i] != SLIP_ESC) continue;
+
+        size_t run = i - run_start;
+        if (run && m_out.write(in_buffer + run_start, run) != run) return run_start;
+        if (m_out.write(in_buffer[i] == SLIP_END ? ESCAPED_END : ESCAPED_ESC, 2) != 2) return i;
+        run_start = i + 1;
     }
 
-    // Currently only support messages with one type_tag
-    switch (m_type_tags[0])
+    size_t run = in_len - run_start;
+    if (run && m_out.write(in_buffer + run_start, run) != run) return run_start;
+    return in_len;
+}
+
+// Write in_packet as one complete frame
+bool SLIPEncoder::send(const uint8_t* in_packet, size_t in_len)
+{
+    return begin() && write(in_packet, in_len) == in_len && end();
+}
+
+bool SLIPEncoder::send(const OSCPark& in_msg)
+{
+    return begin() && in_msg.send(*this) && end();
+}
+// SLIP (end)
+
+
+// OSCPump (start)
+OSCPump::OSCPump(uint8_t* in_buffer, size_t in_size)
+    : m_capacity(in_buffer ? (in_size / 2) & ~static_cast<size_t>(3) : 0), m_held_buffer(0), m_holding(false), m_drained(0), m_coalesced(0), m_dropped(0)
+{
+    m_buffers[0] = in_buffer;
+    m_buffers[1] = in_buffer + m_capacity;
+}
+
+void OSCPump::reset_stats()
+{
+    m_drained = 0;
+    m_coalesced = 0;
+    m_dropped = 0;
+}
+
+bool OSCPump::same_address(const OSCView& in_a, const OSCView& in_b)
+{
+    return in_a.get_addr_len() == in_b.get_addr_len() && memcmp(in_a.get_addr(), in_b.get_addr(), in_a.get_addr_len()) == 0;
+}
+// OSCPump (end)
+
+
+// Profiler (start)
+#if NBAPARK_PROFILE
+ProfileStat* ProfileStat::s_first = nullptr;
+ProfileCounter* ProfileCounter::s_first = nullptr;
+
+ProfileStat Profiler::ball_latency("ball_latency");
+ProfileCounter Profiler::sensor_timeouts("sensor_timeouts");
+
+// Longest name published, the rest is cut so a stat message fits PROFILE_ELEMENT_SIZE
+static const uint8_t PROFILE_MAX_NAME_LEN = 23;
+static const uint8_t PROFILE_ELEMENT_SIZE = 12 + 8 + 24 + 16 + 4 + PROFILE_BUCKETS * 2; // Address, tags, name, ints, blob
+
+ProfileStat::ProfileStat(const char* in_name) : m_name(in_name), m_next(s_first)
+{
+    reset();
+    s_first = this;
+}
+
+void ProfileStat::record(const uint32_t in_us)
+{
+    ++m_count;
+    if (in_us < m_min) m_min = in_us;
+    if (in_us > m_max) m_max = in_us;
+    m_total = (m_total > UINT32_MAX - in_us) ? UINT32_MAX : m_total + in_us;
+
+    uint16_t& bucket_count = m_histogram[bucket(in_us)];
+    if (bucket_count < UINT16_MAX) ++bucket_count;
+}
+
+void ProfileStat::reset()
+{
+    m_count = 0;
+    m_min = UINT32_MAX;
+    m_max = 0;
+    m_total = 0;
+    memset(m_histogram, 0, sizeof(m_histogram));
+}
+
+// Number of significant bits of in_us, the last bucket also counts everything above it
+uint8_t ProfileStat::bucket(uint32_t in_us)
+{
+    uint8_t bucket = 0;
+    while (in_us && bucket < PROFILE_BUCKETS - 1)
     {
-        case 'i':
-            snprintf((char*)buffer, sizeof(buffer), "m_value.data.i_value: %ld", m_value.data.i_value);
-            break;
-        case 'f':
-            // Convert float to string with fixed precision
-            char float_str[7];  // Allocate a buffer for the string representation of the float (4 decimals + '.' + the integer part + '\0')
-            dtostrf(m_value.data.f_value, 1, 4, float_str);  // dtostrf converts float to string with 6 decimals
-            snprintf((char*)buffer, sizeof(buffer), "m_value.data.f_value: %s", float_str);
-            break;
-        case 's':
-            if (m_value.data.s_value != nullptr)
-            {
-                snprintf((char*)buffer, sizeof(buffer), "m_value.data.s_value: %s", m_value.data.s_value);
-            }
-            else
+        in_us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+ProfileCounter::ProfileCounter(const char* in_name) : m_name(in_name), m_next(s_first), m_value(0)
+{
+    s_first = this;
+}
+
+// Address and type tags of a stats message followed by the (truncated) name, returns the bytes written
+static size_t profile_write_header(uint8_t* out_element, const char* in_tags, const char* in_name)
+{
+    size_t len = 0;
+    const char* fields[] = {MVP_STATS_ADDRESS, in_tags, in_name};
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        size_t field_len = strlen(fields[i]);
+        if (i == 2 && field_len > PROFILE_MAX_NAME_LEN) field_len = PROFILE_MAX_NAME_LEN;
+        size_t padded_len = osc_padded_len(field_len);
+
+        memcpy(out_element + len, fields[i], field_len);
+        memset(out_element + len + field_len, 0, padded_len - field_len);
+        len += padded_len;
+    }
+    return len;
+}
+
+// Bundle element: big-endian size followed by the message
+static size_t profile_write_element(Print& in_p, const uint8_t* in_element, size_t in_len)
+{
+    uint8_t size[4];
+    osc_write_be32(size, in_len);
+    return in_p.write(size, sizeof(size)) + in_p.write(in_element, in_len);
+}
+
+size_t Profiler::publish(Print& in_p, const bool in_reset)
+{
+    uint8_t element[PROFILE_ELEMENT_SIZE];
+    OSCBundleWriter::write_header(element);
+    size_t written = in_p.write(element, OSCBundleWriter::HEADER_SIZE);
+
+    for (ProfileStat* stat = ProfileStat::get_first(); stat; stat = stat->get_next())
+    {
+        size_t len = profile_write_header(element, ",siiiib", stat->get_name());
+        const uint32_t values[] = {stat->get_count(), stat->get_min(), stat->get_mean(), stat->get_max(), PROFILE_BUCKETS * 2U};
+        for (uint8_t i = 0; i < 5; ++i, len += 4)
+        {
+            osc_write_be32(element + len, values[i]);
+        }
+        for (uint8_t i = 0; i < PROFILE_BUCKETS; ++i, len += 2)
+        {
+            element[len] = stat->get_bucket_count(i) >> 8;
+            element[len + 1] = stat->get_bucket_count(i) & 0xFF;
+        }
+        written += profile_write_element(in_p, element, len);
+    }
+
+    for (ProfileCounter* counter = ProfileCounter::get_first(); counter; counter = counter->get_next())
+    {
+        size_t len = profile_write_header(element, ",si", counter->get_name());
+        osc_write_be32(element + len, counter->get_value());
+        written += profile_write_element(in_p, element, len + 4);
+    }
+
+    if (in_reset) reset();
+    return written;
+}
+
+void Profiler::reset()
+{
+    for (ProfileStat* stat = ProfileStat::get_first(); stat; stat = stat->get_next()) stat->reset();
+    for (ProfileCounter* counter = ProfileCounter::get_first(); counter; counter = counter->get_next()) counter->reset();
+}
+#endif // NBAPARK_PROFILE
+// Profiler (end)
+
+
+// DeferredLog (start)
+// Format strings in flash, indexed by LogId
+#define NBAPARK_LOG_FORMAT_STR(id, format) static const char id##_FORMAT[] PROGMEM = format;
+NBAPARK_LOG_FORMATS(NBAPARK_LOG_FORMAT_STR)
+#define NBAPARK_LOG_FORMAT_PTR(id, format) id##_FORMAT,
+static const char* const LOG_FORMATS[] PROGMEM = { NBAPARK_LOG_FORMATS(NBAPARK_LOG_FORMAT_PTR) };
+
+static uint32_t log_read_le32(const uint8_t* in_buffer)
+{
+    return uint32_t(in_buffer[0]) | (uint32_t(in_buffer[1]) << 8) | (uint32_t(in_buffer[2]) << 16) | (uint32_t(in_buffer[3]) << 24);
+}
+
+bool log_print_record(Print& in_p, const uint8_t* in_frame, const size_t in_len)
+{
+    if (!in_frame || in_len < 1 + LOG_RECORD_HEADER_LEN || in_frame[0] != LOG_FRAME_MAGIC) return false;
+
+    const uint8_t id = in_frame[1];
+    const uint8_t count = in_frame[2];
+    if (id >= LOG_NUM_IDS || count > LOG_MAX_ARGS || in_len != 1 + LOG_RECORD_HEADER_LEN + count * 4U) return false;
+
+    const uint8_t* args = in_frame + 1 + LOG_RECORD_HEADER_LEN;
+    in_p.print('[');
+    in_p.print(static_cast<unsigned long>(log_read_le32(in_frame + 3)));
+    in_p.print("] ");
+
+    const char* format = reinterpret_cast<const char*>(pgm_read_ptr(&LOG_FORMATS[id]));
+    uint8_t arg = 0;
+    for (char c = pgm_read_byte(format); c; c = pgm_read_byte(++format))
+    {
+        if (c != '%')
+        {
+            in_p.print(c);
+            continue;
+        }
+
+        const char spec = pgm_read_byte(++format);
+        if (!spec) break;
+        if (spec == '%')
+        {
+            in_p.print('%');
+            continue;
+        }
+
+        // Missing arguments print as 0
+        const uint32_t value = (arg < count) ? log_read_le32(args + 4 * arg) : 0;
+        ++arg;
+        switch (spec)
+        {
+            case 'd':
+                in_p.print(static_cast<long>(static_cast<int32_t>(value)));
+                break;
+            case 'x':
+                for (int8_t shift = 28; shift >= 0; shift -= 4) in_p.print(static_cast<unsigned int>((value >> shift) & 0xF), HEX);
+                break;
+            case 'b':
+                in_p.print(static_cast<unsigned long>(value), BIN);
+                break;
+            default:
+                in_p.print(static_cast<unsigned long>(value));
+                break;
+        }
+    }
+    in_p.print('\n');
+    return true;
+}
+
+#if DEBUG_LEVEL == 2 || DEBUG_LEVEL == 3
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0 && LOG_BUFFER_SIZE >= LOG_MAX_RECORD_LEN && LOG_BUFFER_SIZE <= 0x8000U,
+              "DeferredLog: LOG_BUFFER_SIZE must be a power of two between LOG_MAX_RECORD_LEN and 32768");
+
+uint8_t DeferredLog::s_buffer[LOG_BUFFER_SIZE];
+uint16_t DeferredLog::s_head = 0;
+uint16_t DeferredLog::s_tail = 0;
+uint16_t DeferredLog::s_dropped = 0;
+
+static void log_write_le32(uint8_t* out_buffer, uint32_t in_value)
+{
+    for (uint8_t i = 0; i < 4; ++i, in_value >>= 8) out_buffer[i] = in_value & 0xFF;
+}
+
+// Size of in_frame once SLIP encoded, with the END bytes before and after it
+static size_t log_slip_len(const uint8_t* in_frame, size_t in_len)
+{
+    size_t slip_len = in_len + 2;
+    for (size_t i = 0; i < in_len; ++i)
+    {
+        if (in_frame[i] == SLIP_END || in_frame[i] == SLIP_ESC) ++slip_len;
+    }
+    return slip_len;
+}
+
+void DeferredLog::write_args(const uint8_t in_id, const uint32_t* in_args, uint8_t in_count)
+{
+    if (in_count > LOG_MAX_ARGS) in_count = LOG_MAX_ARGS;
+
+    const uint8_t len = LOG_RECORD_HEADER_LEN + in_count * 4;
+    if (LOG_BUFFER_SIZE - static_cast<uint16_t>(s_head - s_tail) < len)
+    {   // Ring buffer full, reported by drain() once it has room again
+        if (s_dropped < UINT16_MAX) ++s_dropped;
+        return;
+    }
+
+    uint8_t record[LOG_MAX_RECORD_LEN];
+    record[0] = in_id;
+    record[1] = in_count;
+    log_write_le32(record + 2, micros());
+    for (uint8_t i = 0; i < in_count; ++i)
+    {
+        log_write_le32(record + LOG_RECORD_HEADER_LEN + 4 * i, in_args[i]);
+    }
+
+    for (uint8_t i = 0; i < len; ++i)
+    {
+        s_buffer[(s_head + i) & (LOG_BUFFER_SIZE - 1)] = record[i];
+    }
+    s_head += len;
+}
+
+uint8_t DeferredLog::drain(Print& in_p)
+{
+    const int room = in_p.availableForWrite();
+    return drain(in_p, room > 0 ? room : 0);
+}
+
+// Oldest records first, then the LOG_DROPPED record if any was dropped
+uint8_t DeferredLog::drain(Print& in_p, size_t in_room)
+{
+    SLIPEncoder slip(in_p);
+    uint8_t frame[1 + LOG_MAX_RECORD_LEN];
+    frame[0] = LOG_FRAME_MAGIC;
+
+    uint8_t sent = 0;
+    while (sent < UINT8_MAX)
+    {
+        size_t len;
+        const bool pending = s_head != s_tail;
+        if (pending)
+        {
+            const uint8_t count = s_buffer[(s_tail + 1) & (LOG_BUFFER_SIZE - 1)];
+            len = LOG_RECORD_HEADER_LEN + count * 4U;
+            for (uint8_t i = 0; i < len; ++i)
             {
-                snprintf((char*)buffer, sizeof(buffer), "m_value.data.s_value: NULL");
+                frame[1 + i] = s_buffer[(s_tail + i) & (LOG_BUFFER_SIZE - 1)];
             }
+        }
+        else if (s_dropped)
+        {
+            frame[1] = LOG_DROPPED;
+            frame[2] = 1;
+            log_write_le32(frame + 3, micros());
+            log_write_le32(frame + 1 + LOG_RECORD_HEADER_LEN, s_dropped);
+            len = LOG_RECORD_HEADER_LEN + 4;
+        }
+        else
+        {
             break;
-        default:
-            snprintf((char*)buffer, sizeof(buffer), "NO VALUE");
-            break;
-    }
-    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+        }
 
-    snprintf((char*)buffer, sizeof(buffer), "m_addr_len: %d", m_addr_len);
-    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+        // Whole frames only, so the UART write never blocks
+        const size_t slip_len = log_slip_len(frame, len + 1);
+        if (slip_len > in_room) break;
+        slip.send(frame, len + 1);
+        in_room -= slip_len;
+        ++sent;
 
-    snprintf((char*)buffer, sizeof(buffer), "m_type_len: %d", m_type_len);
-    DEBUG_OUTPUT.print(buffer); DEBUG_OUTPUT.print("\n");
+        if (pending) s_tail += len;
+        else s_dropped = 0;
+    }
+    return sent;
 }
-// OSCPark (end)
+
+void DeferredLog::clear()
+{
+    s_head = 0;
+    s_tail = 0;
+    s_dropped = 0;
+}
+#endif
+// DeferredLog (end)
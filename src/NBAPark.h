@@ -3,7 +3,7 @@
  * Description: Declarations of classes and structs
  * Author: José Paulo Seibt Neto
  * Created: Fev - 2025
- * Last Modified: Jul - 2025
+ * Last Modified: Oct - 2026
 */
 
 #ifndef NBAPARK_H
@@ -35,10 +35,14 @@
     #define debugLib(msg) DEBUG_OUTPUT.print(msg)
     #define debugLibVal(val, format) DEBUG_OUTPUT.print(val, format)
     #define debugLibln() DEBUG_OUTPUT.print("\n")
+    #define debugLibLog(id, ...) DeferredLog::write(id, ##__VA_ARGS__) // Hot paths, see DeferredLog
+    #define debugLibDrain() DeferredLog::drain(DEBUG_OUTPUT)           // Call when the loop is idle
 #else
     #define debugLib(msg)
     #define debugLibVal(val, format)
     #define debugLibln()
+    #define debugLibLog(id, ...)
+    #define debugLibDrain()
 #endif
 
 // Display related macros
@@ -72,11 +76,28 @@
 
 // Constants
 #define SOUND_SPEED 0.0343f            // Speed of sound in centimeters per microsecond
-#define BALL_DETECTION_THRESHOLD 30U   // Value in centimeters
-#define BALL_DETECTION_COOLDOWN 500U   // Value in milliseconds
-#define BALL_DETECTION_TIMEOUT 5000U   // Value in microseconds (3-5ms timeout should be enough for reads up to ~50cm)
-#define BALL_DETECTION_READ_DELAY 7U   // Value in milliseconds (almost always should be greater than the timeout, and can vary depending on the environment)
-#define NUM_MVP_HOOPS 3U
+// Detection tuning, can be set in the build flags (e.g. to replay a SensorTrace with other values)
+#ifndef BALL_DETECTION_THRESHOLD
+    #define BALL_DETECTION_THRESHOLD 30U   // Value in centimeters
+#endif
+#ifndef BALL_DETECTION_COOLDOWN
+    #define BALL_DETECTION_COOLDOWN 500U   // Value in milliseconds
+#endif
+#ifndef BALL_DETECTION_TIMEOUT
+    #define BALL_DETECTION_TIMEOUT 5000U   // Value in microseconds (3-5ms timeout should be enough for reads up to ~50cm)
+#endif
+#ifndef BALL_DETECTION_READ_DELAY
+    #define BALL_DETECTION_READ_DELAY 7U   // Value in milliseconds (almost always should be greater than the timeout, and can vary depending on the environment)
+#endif
+#ifndef BALL_DETECTION_PING_INTERVAL
+    #define BALL_DETECTION_PING_INTERVAL 60000UL // Value in microseconds (minimum time between async mode triggers, HC-SR04 late echoes of the previous ping)
+#endif
+#ifndef IR_MIN_BREAK_DURATION
+    #define IR_MIN_BREAK_DURATION 2000U    // Value in microseconds (shorter IR beam breaks are treated as noise in interrupt mode)
+#endif
+#ifndef NUM_MVP_HOOPS
+    #define NUM_MVP_HOOPS 3U
+#endif
 #define DEFAULT_HIGH_SCORE 10U         // Default high score value (used in the GameMVP example program)
 #define HIGH_SCORE_RESET_TIME 86400U   // Value in seconds
 #define RESOLUME_MVPGAME_ADDRESS "/mvp/game" // OSC address of message send by Resolume Arena when the MVP GAME clip is running (transport position)
@@ -86,6 +107,32 @@
 #define RESOLUME_HIGH_SCORE_ADDRESS "/composition/layers/4/clips/1/video/effects/textblock2/effect/text/params/lines" // OSC address in the Resolume Arena composition
 #define RESOLUME_NEW_HIGH_SCORE_ADDRESS "/composition/layers/3/clips/2/connect"
 #define OSC_MAX_ADDRESS_LEN 255U
+#ifndef OSC_MAX_ARGS
+    #define OSC_MAX_ARGS 8U // Arguments per OSCPark message
+#endif
+#ifndef OSC_MAX_DATA_LEN
+    #define OSC_MAX_DATA_LEN 48U // Size of the inline argument storage of OSCPark (wire format)
+#endif
+#ifndef OSC_MAX_PACKET_LEN
+    #define OSC_MAX_PACKET_LEN 160U // Size of the stack buffer OSCPark::send() serializes into
+#endif
+#ifndef OSC_RECEIVE_BUDGET
+    #define OSC_RECEIVE_BUDGET 1000U // Value in microseconds (time OSCPump::poll() keeps draining received packets)
+#endif
+#ifndef OSC_OUTBOX_INTERVAL
+    #define OSC_OUTBOX_INTERVAL 40U // Value in milliseconds (minimum time between OSCOutbox flushes, one 25 fps display frame)
+#endif
+#ifndef LOG_BUFFER_SIZE
+    #define LOG_BUFFER_SIZE 128U // Bytes of the DeferredLog ring buffer (power of two), a record takes 6 bytes + 4 per argument
+#endif
+#ifndef NBAPARK_PROFILE
+    #define NBAPARK_PROFILE 0 // 1 = Collect loop and detection latency stats (Profiler), 0 = PROFILE_* macros compiled out
+#endif
+#define PROFILE_BUCKETS 16U            // Log2 histogram buckets of a ProfileStat (the last one counts 16384 us and up)
+#define MVP_STATS_ADDRESS "/mvp/stats" // OSC address of the messages written by Profiler::publish()
+#ifndef PROFILE_PUBLISH_INTERVAL
+    #define PROFILE_PUBLISH_INTERVAL 1000U // Value in milliseconds (time between stats published by the GameMVP example program)
+#endif
 #define R_BATTLE_DEFAULT_MATCH_DUR 120U // Value in seconds
 #define R_BATTLE_OVERTIME 45U           // Value in seconds
 #define R_BATTLE_RESET_TRIGGER 2000U       // Value in milliseconds (button release time)
@@ -113,22 +160,25 @@ struct Button
     }
 
     // Return the release time of the press, zero otherwise
-    uint32_t update()
+    uint32_t update() { return update(millis()); }
+
+    // Same as update(), with the time (millis()) read once by the caller, e.g. FrameClock::now_ms()
+    uint32_t update(uint32_t in_now)
     {
         if (!state)
         {   // Check for first press
             state = digitalRead(pin);
-            if (state) { press_millis_start = millis(); }
+            if (state) { press_millis_start = in_now; }
         }
         else
         {   // Button was pressed in the last update() call
             // Update held state 
             state = digitalRead(pin);
             // If button released, calculate release time, else release time gets zero
-            release_time = (!state) ? millis() - press_millis_start : 0;
+            release_time = (!state) ? in_now - press_millis_start : 0;
         }
 
-        curr_press_dur = (state) ? millis() - press_millis_start : 0;
+        curr_press_dur = (state) ? in_now - press_millis_start : 0;
         return release_time;
     }
 
@@ -141,6 +191,208 @@ struct Button
 };
 
 
+// One millis()/micros() snapshot per loop() pass: call FrameClock::tick() at the top of loop() and pass
+// FrameClock::now_ms() to the in_now overloads, so every component sees the same time for a fraction of the reads
+class FrameClock
+{
+    static uint32_t s_now_ms;
+    static uint32_t s_now_us;
+
+public:
+    // Methods
+    static void tick()
+    {
+        s_now_us = micros();
+        s_now_ms = millis();
+    }
+
+    // Accessors
+    static uint32_t now_ms() { return s_now_ms; }
+    static uint32_t now_us() { return s_now_us; }
+};
+
+
+// Profiler (begin)
+/* Compile-time switchable instrumentation of the loop: with NBAPARK_PROFILE set to 0 (default) the PROFILE_* macros
+   expand to nothing, their arguments aren't evaluated and the classes below aren't compiled, so instrumented code costs
+   nothing. NBAPARK_PROFILE must be the same for the library and the sketch (set it here or in the build flags). */
+#if NBAPARK_PROFILE
+/* Elapsed micros() of a named scope: count, min, max, mean and a log2 histogram (bucket 0 counts 0 us, bucket b counts
+   2^(b-1) to 2^b - 1 us). Every stat registers itself to be published by Profiler::publish(), which also resets it.
+   Record from the loop only, not from ISRs. */
+class ProfileStat
+{
+    const char* m_name;
+    ProfileStat* m_next;
+    uint32_t m_count;
+    uint32_t m_min;
+    uint32_t m_max;
+    uint32_t m_total; // Saturates at UINT32_MAX (over an hour of elapsed time between resets)
+    uint16_t m_histogram[PROFILE_BUCKETS];
+
+    static ProfileStat* s_first;
+
+public:
+    // Constructor
+    ProfileStat(const char* in_name);
+
+    // Methods
+    void record(uint32_t in_us);
+    void reset();
+    static uint8_t bucket(uint32_t in_us);
+
+    // Accessors
+    const char* get_name() const { return m_name; }
+    uint32_t get_count() const { return m_count; }
+    uint32_t get_min() const { return m_count ? m_min : 0; }
+    uint32_t get_max() const { return m_max; }
+    uint32_t get_mean() const { return m_count ? m_total / m_count : 0; }
+    uint16_t get_bucket_count(uint8_t in_bucket) const { return (in_bucket < PROFILE_BUCKETS) ? m_histogram[in_bucket] : 0; }
+    ProfileStat* get_next() const { return m_next; }
+    static ProfileStat* get_first() { return s_first; }
+};
+
+// Named event counter (e.g. sensor timeouts), registered and published like ProfileStat
+class ProfileCounter
+{
+    const char* m_name;
+    ProfileCounter* m_next;
+    uint32_t m_value;
+
+    static ProfileCounter* s_first;
+
+public:
+    // Constructor
+    ProfileCounter(const char* in_name);
+
+    // Methods
+    void add(uint32_t in_count) { m_value += in_count; }
+    void reset() { m_value = 0; }
+
+    // Accessors
+    const char* get_name() const { return m_name; }
+    uint32_t get_value() const { return m_value; }
+    ProfileCounter* get_next() const { return m_next; }
+    static ProfileCounter* get_first() { return s_first; }
+};
+
+// Records the micros() elapsed between its construction and the end of the enclosing block
+class ProfileScope
+{
+    ProfileStat& m_stat;
+    uint32_t m_start;
+
+public:
+    ProfileScope(ProfileStat& in_stat) : m_stat(in_stat), m_start(micros()) {}
+    ~ProfileScope() { m_stat.record(micros() - m_start); }
+};
+
+class Profiler
+{
+public:
+    static ProfileStat ball_latency;       // Ball detection to score report, recorded by the sketch
+    static ProfileCounter sensor_timeouts; // Echoes that didn't end within BALL_DETECTION_TIMEOUT
+
+    /* Write every stat and counter as one OSC bundle of MVP_STATS_ADDRESS messages to in_p (e.g. an UDP packet), then
+       reset them if in_reset. A stat is sent as ",siiiib" (name, count, min, mean, max in microseconds and the histogram
+       as a blob of PROFILE_BUCKETS big-endian uint16_t), a counter as ",si" (name, value). Returns the bytes written. */
+    static size_t publish(Print& in_p, bool in_reset = true);
+    static void reset();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_STAT(var, name) ProfileStat var(name)          // Define a stat, e.g. PROFILE_STAT(loop_stat, "loop");
+#define PROFILE_COUNTER(var, name) ProfileCounter var(name)    // Define a counter
+#define PROFILE_SCOPE(stat) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stat) // Time the rest of the block
+#define PROFILE_RECORD(stat, us) (stat).record(us)
+#define PROFILE_COUNT(counter, count) (counter).add(count)
+#else
+#define PROFILE_STAT(var, name)
+#define PROFILE_COUNTER(var, name)
+#define PROFILE_SCOPE(stat)
+#define PROFILE_RECORD(stat, us)
+#define PROFILE_COUNT(counter, count)
+#endif // NBAPARK_PROFILE
+// Profiler (end)
+
+
+// DeferredLog (begin)
+/* Formats of the debugLibLog() records, X(id, format) with up to LOG_MAX_ARGS arguments: %u (unsigned), %d (signed),
+   %x (8 hex digits), %b (binary) and %%. The id is the tag of the record, add new formats at the end so older
+   captures still decode. */
+#define NBAPARK_LOG_FORMATS(X) \
+    X(LOG_DROPPED, "[DeferredLog] %u records dropped") \
+    X(LOG_COOLDOWN_ENDED, "[BasketSensorArray::filter_sensor_readings] Cooldown ended: %b") \
+    X(LOG_VALID_RIMS, "[BasketSensorArray::filter_sensor_readings] in_curr_pattern AND in_sensor_checks = %b") \
+    X(LOG_CLOCK_TIME, "[Clock::update] clock_time: %u") \
+    X(LOG_COUNTDOWN_END, "[Clock::update] Countdown end") \
+    X(LOG_OSC_INIT, "[OSCPark::init] Raw bytes: %x %x %x %x") \
+    X(LOG_OSC_SEND, "[OSCPark::send] SENDING %u bytes")
+
+#define NBAPARK_LOG_ID(id, format) id,
+enum LogId : uint8_t
+{
+    NBAPARK_LOG_FORMATS(NBAPARK_LOG_ID)
+    LOG_NUM_IDS
+};
+
+#define LOG_FRAME_MAGIC 0xA7U    // First byte of a record frame, not printable text
+#define LOG_MAX_ARGS 4U
+#define LOG_RECORD_HEADER_LEN 6U // Id, argument count and micros() (little-endian), followed by the arguments
+#define LOG_MAX_RECORD_LEN (LOG_RECORD_HEADER_LEN + LOG_MAX_ARGS * 4U)
+
+/* Print a record frame (LOG_FRAME_MAGIC followed by a record) as "[micros] message\n", the format being read from
+   flash. Returns false without printing if in_frame isn't a valid record, e.g. for the host decoder in extras/host. */
+bool log_print_record(Print& in_p, const uint8_t* in_frame, size_t in_len);
+
+#if DEBUG_LEVEL == 2 || DEBUG_LEVEL == 3
+/* Deferred binary log of the library hot paths: debugLibLog() copies the format id, micros() and the raw arguments
+   to a RAM ring buffer in a few microseconds, instead of printing to DEBUG_OUTPUT synchronously. debugLibDrain()
+   sends the records as SLIP frames (see SLIPEncoder) only while they fit the free space of the Serial TX buffer,
+   so it never blocks on the UART, and extras/host decodes the capture back to text. Records that don't fit the ring
+   buffer are dropped and reported by a LOG_DROPPED record. Log from the loop only, not from ISRs. */
+class DeferredLog
+{
+    static uint8_t s_buffer[LOG_BUFFER_SIZE];
+    static uint16_t s_head; // Free-running write index
+    static uint16_t s_tail; // Free-running drain index
+    static uint16_t s_dropped;
+
+public:
+    // Methods
+    static void write(uint8_t in_id) { write_args(in_id, nullptr, 0); }
+    static void write(uint8_t in_id, uint32_t in_arg0) { write_args(in_id, &in_arg0, 1); }
+    static void write(uint8_t in_id, uint32_t in_arg0, uint32_t in_arg1)
+    {
+        const uint32_t args[] = {in_arg0, in_arg1};
+        write_args(in_id, args, 2);
+    }
+    static void write(uint8_t in_id, uint32_t in_arg0, uint32_t in_arg1, uint32_t in_arg2)
+    {
+        const uint32_t args[] = {in_arg0, in_arg1, in_arg2};
+        write_args(in_id, args, 3);
+    }
+    static void write(uint8_t in_id, uint32_t in_arg0, uint32_t in_arg1, uint32_t in_arg2, uint32_t in_arg3)
+    {
+        const uint32_t args[] = {in_arg0, in_arg1, in_arg2, in_arg3};
+        write_args(in_id, args, 4);
+    }
+    static void write_args(uint8_t in_id, const uint32_t* in_args, uint8_t in_count);
+
+    // Send the records whose frames fit in in_p.availableForWrite() (or in_room bytes), returns the records sent
+    static uint8_t drain(Print& in_p);
+    static uint8_t drain(Print& in_p, size_t in_room);
+    static void clear();
+
+    // Accessors
+    static uint16_t get_pending() { return s_head - s_tail; } // Bytes waiting to be drained
+    static uint16_t get_dropped() { return s_dropped; }       // Records dropped since the last LOG_DROPPED was sent
+};
+#endif
+// DeferredLog (end)
+
+
 class Timer
 {
     uint32_t m_start_time;
@@ -154,9 +406,11 @@ public:
     const uint32_t& get_start_time() const { return m_start_time; }
     const uint32_t& get_offset_time() const { return m_offset_time; }
 
-    // Methods
+    // Methods (in_now overloads take a millis() value read by the caller, e.g. FrameClock::now_ms())
     uint32_t reset();
+    uint32_t reset(uint32_t in_now);
     uint32_t get_elapsed_time(bool seconds=true) const;
+    uint32_t get_elapsed_time(bool seconds, uint32_t in_now) const;
 };
 
 
@@ -186,113 +440,327 @@ public:
     uint32_t run();    // Clock running (time passing)
     uint32_t stop();   // Clock stoped (preserve/stop clock time)
     uint32_t update(); // Update clock time (if running)
+    uint32_t update(uint32_t in_now);
     void print() const;
 };
 
 
-// Need a IR sensor
-class IRBasketSensor
+// TimerWheel (begin)
+/* Hashed timer wheel for one-shot and periodic callbacks: SLOTS buckets of TICK_MS milliseconds each, with the timers
+   kept in a fixed pool of CAPACITY entries (no heap). A tick only visits the bucket it lands on, so its cost depends
+   on the timers hashed to that bucket and not on every registered timer. All methods take the current millis() value,
+   so the wheel runs the same against FrameClock::now_ms() or a simulated clock, and the unsigned differences keep it
+   correct across the millis() overflow (as Timer does). */
+template<uint16_t CAPACITY, uint16_t SLOTS = 16, uint16_t TICK_MS = 10>
+class TimerWheel
 {
-    uint8_t m_out_pin;
+public:
+    typedef void (*Callback)(void* in_ctx);
+    static const uint16_t INVALID_ID = 0xFFFF;
+
+private:
+    static_assert(CAPACITY > 0 && CAPACITY < INVALID_ID, "TimerWheel: invalid capacity");
+    static_assert(SLOTS > 0 && TICK_MS > 0, "TimerWheel: invalid wheel size");
 
-    // Separate hoop state that handle the cooldown for checking sensor after a ball is detected (all in-lined for simplicity)
-    struct HoopCooldown
+    struct Entry
     {
-        Timer mil_timer;
-        bool on_cooldown;
-        uint16_t cooldown_time;
+        Callback callback; // nullptr while the entry is free
+        void* ctx;
+        uint32_t period;   // Period in milliseconds, 0 for one-shot timers
+        uint32_t rounds;   // Full turns of the wheel left before firing
+        uint16_t slot;
+        uint16_t prev;
+        uint16_t next;     // Next entry in the same slot, the free list or the expired list
+    };
 
-        // Constructor
-        HoopCooldown() : on_cooldown(false), cooldown_time(0) { mil_timer.reset(); }
+    Entry m_entries[CAPACITY];
+    uint16_t m_slots[SLOTS]; // Head entry of each slot
+    uint16_t m_free;         // Head of the free entries list
+    uint16_t m_cursor;       // Slot of the last processed tick
+    uint16_t m_active;       // Number of scheduled timers
+    uint32_t m_wheel_time;   // millis() of the last processed tick
+    bool m_started;
 
-        // Methods
-        void set_cooldown(uint32_t in_cooldown_amount)
-        {
-            mil_timer.reset();
-            cooldown_time = in_cooldown_amount;
-            on_cooldown = true;
+public:
+    // Constructor
+    TimerWheel() { clear(); }
+
+    // Accessors
+    uint16_t get_active() const { return m_active; }
+    bool is_active(uint16_t in_id) const { return in_id < CAPACITY && m_entries[in_id].callback; }
+
+    // Methods
+    // Register a callback to fire in_delay_ms after in_now, then every in_period_ms if not zero
+    // Returns the timer id (valid until a one-shot timer fires or is cancelled) or INVALID_ID if the pool is full
+    uint16_t schedule(uint32_t in_now, uint32_t in_delay_ms, Callback in_callback, void* in_ctx = nullptr, uint32_t in_period_ms = 0)
+    {
+        if (!in_callback || m_free == INVALID_ID) return INVALID_ID;
+        start(in_now);
+
+        uint16_t id = m_free;
+        m_free = m_entries[id].next;
+
+        Entry& entry = m_entries[id];
+        entry.callback = in_callback;
+        entry.ctx = in_ctx;
+        entry.period = in_period_ms;
+        // Count the delay from the last processed tick, so the timer never fires early
+        insert(id, ticks_for(in_now - m_wheel_time + in_delay_ms));
+        ++m_active;
+        return id;
+    }
+
+    bool cancel(uint16_t in_id)
+    {
+        if (!is_active(in_id)) return false;
+
+        --m_active;
+        if (m_entries[in_id].slot == INVALID_ID)
+        {   // Due in the tick being processed, process_slot() frees it
+            m_entries[in_id].callback = nullptr;
+            return true;
         }
+        unlink(in_id);
+        release(in_id);
+        return true;
+    }
+
+    // Advance the wheel up to in_now and fire the due callbacks, returns the number of callbacks fired
+    uint16_t tick(uint32_t in_now)
+    {
+        start(in_now);
 
-        void update()
+        uint16_t fired = 0;
+        while (in_now - m_wheel_time >= TICK_MS)
         {
-            if (on_cooldown && mil_timer.get_elapsed_time(false) > cooldown_time)
-            {
-                on_cooldown = false;
-                cooldown_time = 0;
-            }
+            m_wheel_time += TICK_MS;
+            m_cursor = (m_cursor + 1) % SLOTS;
+            fired += process_slot();
         }
+        return fired;
+    }
 
-        void reset()
+    void clear()
+    {
+        for (uint16_t i = 0; i < SLOTS; ++i)
         {
-            mil_timer.reset();
-            on_cooldown = false;
-            cooldown_time = 0;
+            m_slots[i] = INVALID_ID;
         }
-    } m_hoop_cooldown;
-
-public:
-    // Constructor
-    IRBasketSensor(uint8_t in_out_pin); 
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            m_entries[i].callback = nullptr;
+            m_entries[i].next = (i + 1 < CAPACITY) ? i + 1 : INVALID_ID;
+        }
+        m_free = 0;
+        m_cursor = 0;
+        m_active = 0;
+        m_wheel_time = 0;
+        m_started = false;
+    }
 
-    // Method
-    bool ball_detected();
-};
+private:
+    void start(uint32_t in_now)
+    {
+        if (!m_started)
+        {
+            m_wheel_time = in_now;
+            m_started = true;
+        }
+    }
 
+    // Number of ticks (at least one) to cover in_ms milliseconds, rounding up
+    static uint32_t ticks_for(uint32_t in_ms)
+    {
+        uint32_t ticks = (in_ms + TICK_MS - 1) / TICK_MS;
+        return ticks ? ticks : 1;
+    }
 
-// Need a HC-SR04 sensor
-class BasketSensor
-{
-    // Pins used by the ultrasonic sensor
-    uint8_t m_trig_pin;
-    uint8_t m_echo_pin;
+    // Link an entry in the slot visited in_ticks ticks after the cursor
+    void insert(uint16_t in_id, uint32_t in_ticks)
+    {
+        Entry& entry = m_entries[in_id];
+        entry.slot = (m_cursor + in_ticks) % SLOTS;
+        entry.rounds = (in_ticks - 1) / SLOTS;
+        entry.prev = INVALID_ID;
+        entry.next = m_slots[entry.slot];
+        if (entry.next != INVALID_ID) m_entries[entry.next].prev = in_id;
+        m_slots[entry.slot] = in_id;
+    }
 
-    // Separate hoop state that handle the cooldown for checking sensor after a ball is detected (all in-lined for simplicity)
-    struct HoopCooldown
+    void unlink(uint16_t in_id)
     {
-        Timer mil_timer;
-        bool on_cooldown;
-        uint16_t cooldown_time;
+        Entry& entry = m_entries[in_id];
+        if (entry.prev != INVALID_ID) m_entries[entry.prev].next = entry.next;
+        else m_slots[entry.slot] = entry.next;
+        if (entry.next != INVALID_ID) m_entries[entry.next].prev = entry.prev;
+    }
 
-        // Constructor
-        HoopCooldown() : on_cooldown(false), cooldown_time(0) { mil_timer.reset(); }
+    void release(uint16_t in_id)
+    {
+        m_entries[in_id].callback = nullptr;
+        m_entries[in_id].next = m_free;
+        m_free = in_id;
+    }
 
-        // Methods
-        void set_cooldown(uint32_t in_cooldown_amount)
+    /* Unlink the due entries of the cursor slot first and then fire them, so callbacks can safely schedule or cancel
+       timers. While due, an entry has no slot (INVALID_ID) and its prev field chains the due list instead. */
+    uint16_t process_slot()
+    {
+        uint16_t due = INVALID_ID;
+        uint16_t id = m_slots[m_cursor];
+        while (id != INVALID_ID)
         {
-            mil_timer.reset();
-            cooldown_time = in_cooldown_amount;
-            on_cooldown = true;
+            uint16_t next = m_entries[id].next;
+            if (m_entries[id].rounds)
+            {
+                --m_entries[id].rounds;
+            }
+            else
+            {
+                unlink(id);
+                m_entries[id].slot = INVALID_ID;
+                m_entries[id].prev = due;
+                due = id;
+            }
+            id = next;
         }
 
-        void update()
+        uint16_t fired = 0;
+        while (due != INVALID_ID)
         {
-            if (on_cooldown && mil_timer.get_elapsed_time(false) > cooldown_time)
+            id = due;
+            Entry& entry = m_entries[id];
+            due = entry.prev;
+
+            Callback callback = entry.callback;
+            if (!callback)
+            {   // Cancelled by a callback fired before it
+                release(id);
+                continue;
+            }
+
+            void* ctx = entry.ctx;
+            if (entry.period)
+            {   // Periodic timers keep their id
+                insert(id, ticks_for(entry.period));
+            }
+            else
             {
-                on_cooldown = false;
-                cooldown_time = 0;
+                release(id);
+                --m_active;
             }
-        }
 
-        void reset()
-        {
-            mil_timer.reset();
-            on_cooldown = false;
-            cooldown_time = 0;
+            callback(ctx);
+            ++fired;
         }
-    } m_hoop_cooldown;
+        return fired;
+    }
+};
+// TimerWheel (end)
+
+
+// TaskScheduler (begin)
+/* Stackless cooperative tasks (protothread style) run round-robin from loop(). A task is a function that resumes
+   where it last yielded, written between TASK_BEGIN(task) and TASK_END(task). Local variables don't survive a yield
+   (keep the state in globals or in the struct pointed by task.ctx), and yields can't be placed inside a switch. */
+enum TaskState : uint8_t
+{
+    TASK_WAITING, // Yielded, resumes on the next run
+    TASK_DONE     // Reached TASK_END
+};
+
+struct Task;
+typedef TaskState (*TaskFunc)(Task& in_task);
+
+struct Task
+{
+    TaskFunc func;
+    void* ctx;      // User data for the task function
+    uint32_t now;   // millis() passed to the scheduler run that is calling the task
+    uint32_t wake;  // Deadline used by TASK_SLEEP() and TASK_YIELD_UNTIL_TIME()
+    uint16_t line;  // Resume point (the __LINE__ of the last yield), 0 starts from the beginning
+    bool running;
+};
+
+#define TASK_BEGIN(task) switch ((task).line) { case 0:
+#define TASK_END(task) } (task).line = 0; return TASK_DONE
+// Return to the scheduler and resume from here on the next run
+#define TASK_YIELD(task) do { (task).line = __LINE__; return TASK_WAITING; case __LINE__:; } while (0)
+// Resume from here once cond is true (cond is evaluated on every run)
+#define TASK_YIELD_UNTIL(task, cond) do { (task).line = __LINE__; case __LINE__: if (!(cond)) return TASK_WAITING; } while (0)
+// Resume from here once the millis() deadline in_time is reached (overflow safe)
+#define TASK_YIELD_UNTIL_TIME(task, in_time) do { (task).wake = (in_time); TASK_YIELD_UNTIL(task, static_cast<int32_t>((task).now - (task).wake) >= 0); } while (0)
+// Non-blocking replacement for delay(in_ms)
+#define TASK_SLEEP(task, in_ms) TASK_YIELD_UNTIL_TIME(task, (task).now + (in_ms))
+
+template<uint8_t N>
+class TaskScheduler
+{
+    Task m_tasks[N];
+    uint8_t m_count;
 
 public:
-    // Constructors
-    BasketSensor(uint8_t in_trig_pin, uint8_t in_echo_pin);
+    static const uint8_t INVALID_TASK = 0xFF;
 
-    // Acessors
-    const uint8_t& get_trig_pin() const { return m_trig_pin; }
-    const uint8_t& get_echo_pin() const { return m_echo_pin; }
+    // Constructor
+    TaskScheduler() : m_count(0) {}
+
+    // Accessors
+    bool is_running(uint8_t in_index) const { return in_index < m_count && m_tasks[in_index].running; }
+    Task& get_task(uint8_t in_index) { return m_tasks[in_index]; }
 
     // Methods
-    float get_ultrasonic_distance();
-    bool ball_detected();
+    // Register a task, returns its index or INVALID_TASK if the scheduler is full
+    uint8_t add(TaskFunc in_func, void* in_ctx = nullptr, bool in_start = true)
+    {
+        if (!in_func || m_count >= N) return INVALID_TASK;
+
+        Task& task = m_tasks[m_count];
+        task.func = in_func;
+        task.ctx = in_ctx;
+        task.now = 0;
+        task.wake = 0;
+        task.line = 0;
+        task.running = in_start;
+        return m_count++;
+    }
+
+    // (Re)start a task from its beginning
+    void start(uint8_t in_index)
+    {
+        if (in_index >= m_count) return;
+        m_tasks[in_index].line = 0;
+        m_tasks[in_index].running = true;
+    }
+
+    void stop(uint8_t in_index)
+    {
+        if (in_index < m_count) m_tasks[in_index].running = false;
+    }
+
+    // Resume every running task once, returns the number of tasks still running
+    uint8_t run(uint32_t in_now)
+    {
+        uint8_t running = 0;
+        for (uint8_t i = 0; i < m_count; ++i)
+        {
+            Task& task = m_tasks[i];
+            if (!task.running) continue;
+
+            task.now = in_now;
+            if (task.func(task) == TASK_DONE)
+            {
+                task.running = false;
+            }
+            else
+            {
+                ++running;
+            }
+        }
+        return running;
+    }
 };
+// TaskScheduler (end)
 
 
 // Bitmap for all possible patterns for three hoops
@@ -312,206 +780,1233 @@ enum BitmapPattern : uint8_t
 };
 
 
-// ThreeBasketSensors (begin)
-// Used to check and interpret readings from three ultrasonic sensors (HC-SR04) simultaneously
-class ThreeBasketSensors
+// Pick uint8_t, uint16_t or uint32_t from two size checks (no <type_traits> on AVR)
+template<bool FITS_8, bool FITS_16> struct HoopMaskSelect { typedef uint32_t type; };
+template<bool FITS_16> struct HoopMaskSelect<true, FITS_16> { typedef uint8_t type; };
+template<> struct HoopMaskSelect<false, true> { typedef uint16_t type; };
+
+/* Pattern types for N hoops, bit i of a pattern is hoop i. As with BitmapPattern, the value with only bit N set
+   is the sentinel (LAYOUT_STOP), so a pattern needs N + 1 bits: up to 7 hoops fit an uint8_t, up to 15 an uint16_t.
+   The three hoops specialization keeps the BitmapPattern enum as the pattern type. */
+template<uint8_t N>
+struct HoopTraits
+{
+    static_assert(N > 0 && N < 32, "HoopTraits: supports 1 to 31 hoops");
+    typedef typename HoopMaskSelect<(N < 8), (N < 16)>::type mask_t;
+    typedef mask_t pattern_t;
+    static const mask_t ALL_HOOPS = (mask_t(1) << N) - 1;
+    static const mask_t LAYOUT_STOP = mask_t(1) << N;
+};
+
+template<>
+struct HoopTraits<3>
+{
+    typedef uint8_t mask_t;
+    typedef BitmapPattern pattern_t;
+    static const mask_t ALL_HOOPS = 0b0111u;
+    static const mask_t LAYOUT_STOP = BitmapPattern::LAYOUT_STOP;
+};
+
+// Number of hoops in a pattern
+inline uint8_t count_hoops(uint32_t in_pattern) { return __builtin_popcountl(in_pattern); }
+
+
+// SPSCQueue (begin)
+/* Fixed-size single-producer/single-consumer ring buffer, to hand events from interrupt context (producer) to loop()
+   (consumer) without disabling interrupts. Head and tail are free-running uint8_t counters, each written by one side
+   only with release stores and read by the other with acquire loads; a single byte access is atomic on AVR too.
+   A push on a full queue is dropped and counted in the overflow counter. */
+template<typename T, uint8_t CAPACITY>
+class SPSCQueue
 {
-    uint8_t m_trig_pins[3];
-    uint8_t m_echo_pins[3];
-    bool m_ready; // Flag that indicates if the pin arrays where initialized correctly
+    static_assert(CAPACITY >= 2 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SPSCQueue: CAPACITY must be a power of two between 2 and 128");
+    static const uint8_t MASK = CAPACITY - 1;
+
+    T m_buffer[CAPACITY];
+    uint8_t m_head;       // Next slot to pop, written by the consumer only
+    uint8_t m_tail;       // Next slot to push, written by the producer only
+    uint16_t m_overflows; // Pushes dropped on a full queue, written by the producer only
 
-    // Separate hoops state that handle the cooldown for checking sensor after a ball is detected (all in-lined for simplicity)
-    struct ThreeHoopsCooldown
+public:
+    // Constructor
+    SPSCQueue() : m_head(0), m_tail(0), m_overflows(0) {}
+
+    // Accessors
+    static uint8_t capacity() { return CAPACITY; }
+
+    uint8_t size() const
     {
-        Timer mil_timer[3];
-        BitmapPattern on_cooldown_pattern;
+        return static_cast<uint8_t>(__atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&m_head, __ATOMIC_ACQUIRE));
+    }
 
-        // Constructor
-        ThreeHoopsCooldown() : on_cooldown_pattern(BitmapPattern::LAYOUT_0)
-        {
-            for (uint8_t i = 0; i < 3; ++i) mil_timer[i].reset();
-        }
+    bool empty() const { return size() == 0; }
 
-        // Methods
-        void set_cooldown(uint8_t in_hoop_index)
-        {
-            if (in_hoop_index > 2)
-            {
-                debugLib("[ThreeHoopsCooldown::set_cooldown] Invalid arg for in_hoop_index\n");
-            }
-            else
-            {
-                mil_timer[in_hoop_index].reset();
-                // Set cooldown pattern
-                switch (in_hoop_index)
-                {   // Activate the bit that corresponds to the hoop_index
-                    case 0:
-                        on_cooldown_pattern |= 0b0001u;
-                        break;
-                    case 1:
-                        on_cooldown_pattern |= 0b0010u;
-                        break;
-                    case 2:
-                        on_cooldown_pattern |= 0b0100u;
-                        break;
-                    default:
-                        debugLib("[ThreeHoopsCooldown::set_cooldown] Should never get here\n");
-                }
-            }
-        }
+    uint16_t get_overflows() const
+    {
+#if defined(__AVR__)
+        uint8_t sreg = SREG; // Two bytes read, keep the ISR out without enabling interrupts if called from one
+        noInterrupts();
+        uint16_t overflows = m_overflows;
+        SREG = sreg;
+        return overflows;
+#else
+        return __atomic_load_n(&m_overflows, __ATOMIC_RELAXED);
+#endif
+    }
 
-        // Check each hoop cooldown sequentially and update the bitmap pattern using a bitmask
-        void update()
+    // Methods
+    // Producer side, returns false (and counts an overflow) if the queue is full
+    bool push(const T& in_item)
+    {
+        uint8_t tail = __atomic_load_n(&m_tail, __ATOMIC_RELAXED);
+        if (static_cast<uint8_t>(tail - __atomic_load_n(&m_head, __ATOMIC_ACQUIRE)) >= CAPACITY)
         {
-            uint8_t mask = 0b0000u;
+#if defined(__AVR__)
+            ++m_overflows;
+#else
+            __atomic_store_n(&m_overflows, static_cast<uint16_t>(m_overflows + 1), __ATOMIC_RELAXED);
+#endif
+            return false;
+        }
 
-            // Check the first sensor
-            if ((on_cooldown_pattern & 0b0001u) && (mil_timer[0].get_elapsed_time(false) > BALL_DETECTION_COOLDOWN))
-            {   // Deactivate cooldown on first sensor
-                debugLib("Deactivate cooldown on first sensor\n");
-                mask |= 0b0001u;
-            }
+        m_buffer[tail & MASK] = in_item;
+        __atomic_store_n(&m_tail, static_cast<uint8_t>(tail + 1), __ATOMIC_RELEASE);
+        return true;
+    }
 
-            // Check the second sensor
-            if ((on_cooldown_pattern & 0b0010u) && (mil_timer[1].get_elapsed_time(false) > BALL_DETECTION_COOLDOWN))
-            {   // Deactivate cooldown on second sensor
-                debugLib("Deactivate cooldown on second sensor\n");
-                mask |= 0b0010u;
-            }
+    // Consumer side, returns false if the queue is empty
+    bool pop(T& out_item)
+    {
+        uint8_t head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+        if (head == __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE)) return false;
 
-            // Check the third sensor
-            if ((on_cooldown_pattern & 0b0100u) && (mil_timer[2].get_elapsed_time(false) > BALL_DETECTION_COOLDOWN))
-            {   // Deactivate cooldown on third sensor
-                debugLib("Deactivate cooldown on third sensor\n");
-                mask |= 0b0100u;
-            }
+        out_item = m_buffer[head & MASK];
+        __atomic_store_n(&m_head, static_cast<uint8_t>(head + 1), __ATOMIC_RELEASE);
+        return true;
+    }
 
-            // Apply mask to the bitmap of the sensor on cooldown
-            on_cooldown_pattern &= ~mask;
-        }
+    // Consumer side, pop up to in_max items into out_items with a single head update, returns the number popped
+    uint8_t pop(T* out_items, uint8_t in_max)
+    {
+        uint8_t head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+        uint8_t count = static_cast<uint8_t>(__atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) - head);
+        if (count > in_max) count = in_max;
 
-        void reset()
+        for (uint8_t i = 0; i < count; ++i)
         {
-            for (uint8_t i = 0; i < 3; ++i)
-            {
-                mil_timer[i].reset();
-            }
-            on_cooldown_pattern = BitmapPattern::LAYOUT_0;
+            out_items[i] = m_buffer[static_cast<uint8_t>(head + i) & MASK];
         }
-    } m_hoops_cooldown;
+        __atomic_store_n(&m_head, static_cast<uint8_t>(head + count), __ATOMIC_RELEASE);
+        return count;
+    }
 
-public:
-    // Constructors
-    ThreeBasketSensors()
-        : m_trig_pins{0, 0, 0}, m_echo_pins{0, 0, 0}, m_ready(false) {}
+    // Consumer side, drop every queued item
+    void clear() { __atomic_store_n(&m_head, __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE); }
+};
 
-    ThreeBasketSensors(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2,
-                       const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2)
-        : m_trig_pins{in_trig0, in_trig1, in_trig2},
-          m_echo_pins{in_echo0, in_echo1, in_echo2},
-          m_ready(true)
-          {}
+// Ball detection pushed by a sensor ISR
+struct HoopEvent
+{
+    uint8_t hoop;    // Hoop (sensor) index
+    uint32_t micros; // micros() of the detection
+};
+
+#ifndef HOOP_EVENT_QUEUE_SIZE
+    #define HOOP_EVENT_QUEUE_SIZE 16U // Power of two
+#endif
 
-    ThreeBasketSensors(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr);
+typedef SPSCQueue<HoopEvent, HOOP_EVENT_QUEUE_SIZE> HoopEventQueue;
+// SPSCQueue (end)
 
-    // Methods
-    bool init(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2, const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2);
-    bool init(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr);
 
-    BitmapPattern check_sensors();
-    uint8_t filter_sensor_readings(BitmapPattern in_curr_pattern, BitmapPattern in_sensor_checks);
+// SensorTrace (begin)
+/* Capture of the raw sensor readings for offline replay (extras/host/trace): the sensors given a trace with
+   set_trace() record every echo duration and IR beam edge with its micros() timestamp, and the sketch can add the
+   active pattern. send() writes the queued events as one packet to a Print: a UDP packet between beginPacket() and
+   endPacket(), or a SLIPEncoder frame over Serial.
+   Packet (little-endian): "NBTR", version, event count, sequence number (uint16_t), events dropped since the previous
+   packet (uint16_t), then TRACE_EVENT_LEN bytes per event: micros (uint32_t), value (uint16_t), type, sensor. */
+#ifndef TRACE_QUEUE_SIZE
+    #define TRACE_QUEUE_SIZE 32U // Events (8 bytes each), power of two
+#endif
+#define TRACE_VERSION 1U
+#define TRACE_HEADER_LEN 10U
+#define TRACE_EVENT_LEN 8U
+
+enum TraceType : uint8_t
+{
+    TRACE_SWEEP,   // Echo duration in microseconds (0 = timeout) of sensor `sensor` in a BasketSensorArray sweep
+    TRACE_ECHO,    // Echo duration in microseconds (0 = timeout) of a BasketSensor
+    TRACE_IR_EDGE, // Level of an IRBasketSensor output after an edge (LOW = beam broken)
+    TRACE_PATTERN, // Active hoops pattern set by the sketch (LAYOUT_0 while no game is running)
+    TRACE_NUM_TYPES
 };
 
+struct TraceEvent
+{
+    uint32_t micros;
+    uint16_t value;
+    uint8_t type;
+    uint8_t sensor;
+};
 
-// Handle the multiple states and the dynamic layouts of the MVP Competition basketball rims
-// Needs to point to an array of Layout instances with the last Layout.active being a BitmapPattern::LAYOUT_STOP
-class MVPHoops
+class SensorTrace
 {
+    SPSCQueue<TraceEvent, TRACE_QUEUE_SIZE> m_queue;
+    uint16_t m_sequence;
+    uint16_t m_reported_overflows; // Queue overflows already reported in a packet
+
 public:
-    struct Layout
-    {
+    // Constructor
+    SensorTrace() : m_sequence(0), m_reported_overflows(0) {}
+
+    // Methods
+    // From loop(), interrupts are held off while the event is queued since the sensor ISRs also record
+    bool record(TraceType in_type, uint8_t in_sensor, uint32_t in_value, uint32_t in_micros);
+    // From an ISR (interrupts already disabled)
+    bool record_isr(TraceType in_type, uint8_t in_sensor, uint32_t in_value, uint32_t in_micros);
+
+    // Write up to in_max_events queued events as one packet, returns the events written (nothing is written if none)
+    uint8_t send(Print& in_p, uint8_t in_max_events = TRACE_QUEUE_SIZE);
+
+    // Accessors
+    uint8_t get_pending() const { return m_queue.size(); }
+    uint16_t get_dropped() const { return m_queue.get_overflows(); } // Since construction, wraps around
+    uint16_t get_sequence() const { return m_sequence; }
+
+    // Values longer than 16 bits (e.g. a late echo) are saturated
+    static uint16_t clamp_value(uint32_t in_value) { return (in_value > UINT16_MAX) ? UINT16_MAX : in_value; }
+};
+// SensorTrace (end)
+
+
+// HoopsCooldown (begin)
+/* Cooldown engine shared by the sensor classes: one expiry timestamp and cooldown length per hoop plus a single
+   bitmask of the hoops on cooldown. update() expires every hoop whose deadline passed with one time read and
+   branch-free mask arithmetic, so its cost stays flat as hoops are added. */
+template<uint8_t N>
+class HoopsCooldown
+{
+public:
+    typedef typename HoopTraits<N>::mask_t mask_t;
+
+private:
+    uint32_t m_expiry[N];        // millis() deadline of each hoop on cooldown
+    uint16_t m_cooldown_time[N]; // Cooldown length of each hoop in milliseconds
+    mask_t m_active;             // Bitmask of the hoops on cooldown
+
+public:
+    // Constructor
+    HoopsCooldown() : m_expiry{}, m_active(0)
+    {
+        set_cooldown_time(HoopTraits<N>::ALL_HOOPS, BALL_DETECTION_COOLDOWN);
+    }
+
+    // Accessors
+    mask_t get_active() const { return m_active; }
+    bool is_on_cooldown(uint8_t in_hoop_index) const { return (m_active >> in_hoop_index) & 1; }
+
+    // Methods
+    // Cooldown length used by the next set_cooldown() of every hoop in in_mask
+    void set_cooldown_time(mask_t in_mask, uint16_t in_cooldown_ms)
+    {
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            if ((in_mask >> i) & 1) m_cooldown_time[i] = in_cooldown_ms;
+        }
+    }
+
+    // Put every hoop set in in_mask on cooldown, starting at in_now (millis())
+    void set_cooldown(mask_t in_mask, uint32_t in_now)
+    {
+        in_mask &= HoopTraits<N>::ALL_HOOPS;
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            if ((in_mask >> i) & 1) m_expiry[i] = in_now + m_cooldown_time[i];
+        }
+        m_active |= in_mask;
+    }
+
+    // Clear the hoops whose cooldown ended (elapsed time greater than its length) and return them as a mask
+    // The signed difference keeps the comparison correct across the millis() overflow
+    mask_t update(uint32_t in_now)
+    {
+        mask_t expired = 0;
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            expired |= mask_t(static_cast<int32_t>(in_now - m_expiry[i]) > 0) << i;
+        }
+        expired &= m_active;
+        m_active &= ~expired;
+        return expired;
+    }
+
+    void reset() { m_active = 0; }
+};
+// HoopsCooldown (end)
+
+
+// Need a IR sensor
+class IRBasketSensor
+{
+public:
+    static const uint8_t MAX_IRQ_SENSORS = 6; // Sensors that can be in interrupt mode at the same time (external interrupts on the Mega)
+
+private:
+    uint8_t m_out_pin;
+
+    HoopsCooldown<1> m_hoop_cooldown; // Cooldown for checking sensor after a ball is detected
+
+    // Interrupt mode state, written by the pin ISR
+    volatile uint32_t m_fall_micros;      // micros() when the beam was broken (falling edge)
+    volatile uint32_t m_detection_micros; // Falling edge timestamp of the last detection
+    volatile uint8_t m_detections;        // Detections latched by the ISR (wraps around)
+    volatile bool m_beam_broken;
+    uint8_t m_detections_seen;            // Value of m_detections at the last report
+    uint16_t m_min_break_us;              // Minimum beam break duration in microseconds
+    uint8_t m_irq_slot;                   // Index in s_irq_instances, MAX_IRQ_SENSORS if polling
+    uint8_t m_hoop_index;                 // Hoop index of the events pushed to m_event_queue
+    HoopEventQueue* m_event_queue;        // Optional queue fed by the ISR with every detection
+    SensorTrace* m_trace;                 // Optional trace of the output edges
+    uint8_t m_trace_sensor;               // Sensor index of the trace events
+    uint8_t m_trace_level;                // Last output level traced in polling mode
+
+    static IRBasketSensor* s_irq_instances[MAX_IRQ_SENSORS];
+
+    template<uint8_t I> friend void ir_basket_sensor_isr();
+
+public:
+    // Constructor
+    IRBasketSensor(uint8_t in_out_pin); 
+
+    // Accessors
+    bool is_irq_mode() const { return m_irq_slot < MAX_IRQ_SENSORS; }
+    uint32_t get_detection_micros() const;
+
+    // Method
+    bool ball_detected();
+    bool ball_detected(uint32_t in_now);
+    void set_cooldown_time(uint16_t in_cooldown_ms) { m_hoop_cooldown.set_cooldown_time(1, in_cooldown_ms); }
+    void reset();
+
+    /* Interrupt mode: a CHANGE interrupt on the output pin latches the falling edge (beam broken) with its timestamp and,
+       if the beam stayed broken for at least the minimum break duration, counts a detection when it is restored.
+       ball_detected() then reports it on the next poll, whatever the loop latency was, by comparing a single volatile byte.
+       Fails if the pin can't be attached or MAX_IRQ_SENSORS sensors are already attached. */
+    bool attach_interrupt();
+    void detach_interrupt();
+    void set_min_break_duration(uint16_t in_min_break_us) { m_min_break_us = in_min_break_us; }
+    void set_event_queue(HoopEventQueue* in_queue, uint8_t in_hoop_index) { m_hoop_index = in_hoop_index; m_event_queue = in_queue; }
+
+    /* Record the output edges (TRACE_IR_EDGE) in in_trace, nullptr to stop. In interrupt mode every edge is recorded by
+       the ISR, when polling the level is read on each ball_detected() call (cooldown included) and recorded if it changed. */
+    void set_trace(SensorTrace* in_trace, uint8_t in_sensor) { m_trace_sensor = in_sensor; m_trace_level = HIGH; m_trace = in_trace; }
+
+    // Edge handler called by the ISR, public so a simulated pin-change source can drive it off-board
+    void handle_edge(uint8_t in_level, uint32_t in_micros);
+};
+
+
+// Need a HC-SR04 sensor
+class BasketSensor
+{
+public:
+    static const uint8_t MAX_IRQ_SENSORS = 6; // Sensors that can have their echo in interrupt mode at the same time
+
+private:
+    // Pins used by the ultrasonic sensor
+    uint8_t m_trig_pin;
+    uint8_t m_echo_pin;
+
+    HoopsCooldown<1> m_hoop_cooldown; // Cooldown for checking sensor after a ball is detected
+
+public:
+    // States of the non-blocking measurement (async mode)
+    enum EchoState : uint8_t
+    {
+        ECHO_IDLE,      // No measurement in flight
+        ECHO_ARMED,     // Trigger pulse sent, waiting for the echo to go HIGH
+        ECHO_MEASURING, // Echo HIGH, waiting for it to go LOW
+        ECHO_RESULT     // Measurement done (or timed out), m_last_distance holds the result
+    };
+
+private:
+    // Async mode state
+    bool m_async;
+    EchoState m_echo_state;
+    uint32_t m_trigger_micros; // micros() when the trigger pulse ended, also spaces the ball_detected() pings
+    uint32_t m_rise_micros;    // micros() when the echo went HIGH
+    float m_last_distance;     // Distance of the last completed measurement (-1 on timeout)
+
+    // Echo interrupt state, written by the pin ISR while a measurement is armed
+    volatile uint32_t m_echo_rise;  // micros() of the rising edge
+    volatile uint32_t m_echo_width; // Echo pulse width in microseconds
+    volatile bool m_echo_armed;     // Edges are only taken between trigger() and the result
+    volatile bool m_echo_high;
+    volatile bool m_echo_done;
+    uint8_t m_irq_slot;             // Index in s_irq_instances, MAX_IRQ_SENSORS if sampling
+
+    SensorTrace* m_trace;      // Optional trace of the echo durations
+    uint8_t m_trace_sensor;    // Sensor index of the trace events
+
+    static BasketSensor* s_irq_instances[MAX_IRQ_SENSORS];
+
+    template<uint8_t I> friend void basket_sensor_echo_isr();
+
+public:
+    // Constructors
+    BasketSensor(uint8_t in_trig_pin, uint8_t in_echo_pin);
+
+    // Acessors
+    const uint8_t& get_trig_pin() const { return m_trig_pin; }
+    const uint8_t& get_echo_pin() const { return m_echo_pin; }
+    bool is_async() const { return m_async; }
+    EchoState get_echo_state() const { return m_echo_state; }
+    float get_last_distance() const { return m_last_distance; }
+
+    // Methods
+    float get_ultrasonic_distance();
+    bool ball_detected();
+    bool ball_detected(uint32_t in_now);
+    void set_cooldown_time(uint16_t in_cooldown_ms) { m_hoop_cooldown.set_cooldown_time(1, in_cooldown_ms); }
+
+    /* Async mode: ball_detected() stops blocking on pulseIn() and reports from the latest completed measurement,
+       triggering the next one by itself once BALL_DETECTION_PING_INTERVAL passed since the last trigger (the gap
+       BALL_DETECTION_READ_DELAY gives the blocking sketches). trigger() and update() can also be called directly to
+       drive the measurement, the spacing is then up to the caller.
+       With attach_interrupt() a CHANGE interrupt on the echo pin timestamps both edges, so the result is exact whatever
+       the loop period. Without it update() samples the echo pin once per call: the calls must come much faster than the
+       echo width (~58 us per cm, so every ~100 us or less for a ball at 10 cm), or echoes are missed and distances are
+       off by up to one loop period. Keep the blocking mode for loops with delay() or long prints. */
+    void set_async(bool in_async);
+    bool trigger();
+    EchoState update();
+
+    // Fails if the echo pin has no external interrupt or MAX_IRQ_SENSORS sensors are already attached
+    bool attach_interrupt();
+    void detach_interrupt();
+    bool is_irq_mode() const { return m_irq_slot < MAX_IRQ_SENSORS; }
+
+    // Edge handler called by the ISR, public so a simulated pin-change source can drive it off-board
+    void handle_echo_edge(uint8_t in_level, uint32_t in_micros);
+
+    // Record every echo duration (TRACE_ECHO, 0 on timeout) in in_trace, nullptr to stop
+    void set_trace(SensorTrace* in_trace, uint8_t in_sensor) { m_trace_sensor = in_sensor; m_trace = in_trace; }
+
+private:
+    void send_trigger_pulse();
+    bool ping_due() const { return micros() - m_trigger_micros >= BALL_DETECTION_PING_INTERVAL; }
+};
+
+
+// Attach the echo ISR of each index (0 to I - 1) of a BasketSensorArray, unrolled at compile time
+template<class SENSORS, uint8_t I>
+struct EchoIsrAttacher
+{
+    static void attach(const uint8_t* in_echo_pins)
+    {
+        EchoIsrAttacher<SENSORS, I - 1>::attach(in_echo_pins);
+        attachInterrupt(digitalPinToInterrupt(in_echo_pins[I - 1]), SENSORS::template echo_isr<I - 1>, CHANGE);
+    }
+};
+
+template<class SENSORS>
+struct EchoIsrAttacher<SENSORS, 0>
+{
+    static void attach(const uint8_t*) {}
+};
+
+
+// BasketSensorArray (begin)
+// Used to check and interpret readings from N ultrasonic sensors (HC-SR04) simultaneously
+template<uint8_t N>
+class BasketSensorArray
+{
+public:
+    typedef typename HoopTraits<N>::mask_t mask_t;
+    typedef typename HoopTraits<N>::pattern_t pattern_t;
+
+protected:
+    uint8_t m_trig_pins[N];
+    uint8_t m_echo_pins[N];
+    bool m_ready;            // Flag that indicates if the pin arrays where initialized correctly
+    uint16_t m_last_samples; // Number of times the echo pins were sampled in the last check_sensors() call
+
+private:
+    // Interrupt mode state, written by the echo ISRs between a trigger() and the poll() that completes the sweep
+    volatile uint32_t m_echo_rise[N];      // micros() of the rising edge of each echo
+    volatile uint32_t m_echo_durations[N]; // Width of each echo pulse in microseconds
+    volatile mask_t m_echo_high;           // Bitmask of the echoes that already went HIGH in the current sweep
+    volatile mask_t m_echo_done;           // Bitmask of the echoes that already went back LOW in the current sweep
+    volatile bool m_sweep_active;
+    uint32_t m_sweep_start;                // micros() when the trigger pulse ended
+    bool m_irq_mode;                       // Flag that indicates if the echo pins are attached to interrupts
+    HoopEventQueue* m_event_queue;         // Optional queue fed by the echo ISRs with every detection
+    SensorTrace* m_trace;                  // Optional trace of the sweeps
+
+    static BasketSensorArray* s_irq_instance; // Only one instance (per N) can own the echo interrupts at a time
+
+    HoopsCooldown<N> m_hoops_cooldown; // Cooldown for checking each sensor after a ball is detected
+
+    template<class SENSORS, uint8_t I> friend struct EchoIsrAttacher;
+
+public:
+    // Constructors
+    BasketSensorArray()
+        : m_trig_pins{}, m_echo_pins{}, m_ready(false), m_last_samples(0),
+          m_echo_rise{}, m_echo_durations{}, m_echo_high(0), m_echo_done(0),
+          m_sweep_active(false), m_sweep_start(0), m_irq_mode(false), m_event_queue(nullptr), m_trace(nullptr) {}
+
+    // Three hoops only (ThreeBasketSensors)
+    BasketSensorArray(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2,
+                      const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2)
+        : m_trig_pins{in_trig0, in_trig1, in_trig2},
+          m_echo_pins{in_echo0, in_echo1, in_echo2},
+          m_ready(true), m_last_samples(0),
+          m_echo_rise{}, m_echo_durations{}, m_echo_high(0), m_echo_done(0),
+          m_sweep_active(false), m_sweep_start(0), m_irq_mode(false), m_event_queue(nullptr), m_trace(nullptr)
+    {
+        static_assert(N == 3, "BasketSensorArray: the six pins constructor is for three hoops");
+    }
+
+    BasketSensorArray(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr)
+        : m_last_samples(0),
+          m_echo_rise{}, m_echo_durations{}, m_echo_high(0), m_echo_done(0),
+          m_sweep_active(false), m_sweep_start(0), m_irq_mode(false), m_event_queue(nullptr), m_trace(nullptr)
+    {
+        m_ready = init(in_trig_pin_arr, in_echo_pin_arr);
+    }
+
+    // Methods
+    bool init(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2, const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2);
+    bool init(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr);
+
+    pattern_t check_sensors();
+    uint8_t filter_sensor_readings(pattern_t in_curr_pattern, pattern_t in_sensor_checks);
+    uint8_t filter_sensor_readings(pattern_t in_curr_pattern, pattern_t in_sensor_checks, uint32_t in_now);
+
+    /* Interrupt mode: the echo pins timestamp their own edges (CHANGE interrupts), so a sweep is split into a
+       non-blocking trigger() and a poll() that only returns true once all echoes are in or BALL_DETECTION_TIMEOUT passed.
+       Every echo pin must have an external interrupt (digitalPinToInterrupt()): pins 2, 3, 18, 19, 20 and 21 on the Mega.
+       The Uno and Nano only have pins 2 and 3, so three echoes can't be attached there and attach_interrupts() fails,
+       leaving the sensors on the blocking check_sensors(). */
+    bool attach_interrupts();
+    void detach_interrupts();
+    bool trigger();
+    bool poll(pattern_t& out_pattern);
+
+    // Edge handler called by the ISRs, public so a simulated pin-change source can drive it off-board
+    void handle_echo_edge(uint8_t in_index, uint8_t in_level, uint32_t in_micros);
+
+    /* With a queue set, each echo that detects a ball is also pushed as a HoopEvent (falling edge timestamp) from the ISR,
+       so the loop can drain detections in batches. Cooldowns are not applied to the events, filter_sensor_readings() does that. */
+    void set_event_queue(HoopEventQueue* in_queue) { m_event_queue = in_queue; }
+
+    // Record the echo durations of every sweep (TRACE_SWEEP, 0 on timeout) in in_trace, nullptr to stop
+    void set_trace(SensorTrace* in_trace) { m_trace = in_trace; }
+
+    // Accessors
+    bool is_irq_mode() const { return m_irq_mode; }
+    bool is_sweep_active() const { return m_sweep_active; }
+    uint16_t get_last_sample_count() const { return m_last_samples; }
+    void set_cooldown_time(mask_t in_mask, uint16_t in_cooldown_ms) { m_hoops_cooldown.set_cooldown_time(in_mask, in_cooldown_ms); }
+
+protected:
+    void send_trigger_pulse();
+    pattern_t durations_to_pattern(const uint32_t* in_durations) const;
+    static bool duration_detects(uint32_t in_duration);
+    void trace_sweep(const uint32_t* in_durations, uint32_t in_micros);
+
+private:
+    template<uint8_t I>
+    static void echo_isr()
+    {
+        s_irq_instance->handle_echo_edge(I, digitalRead(s_irq_instance->m_echo_pins[I]), micros());
+    }
+};
+
+template<uint8_t N>
+BasketSensorArray<N>* BasketSensorArray<N>::s_irq_instance = nullptr;
+
+// For the method just assign each argument to the corresponding index element in the pin arrays
+// Pin number validation can be added
+template<uint8_t N>
+bool BasketSensorArray<N>::init(const uint8_t in_trig0, const uint8_t in_trig1, const uint8_t in_trig2,
+                                const uint8_t in_echo0, const uint8_t in_echo1, const uint8_t in_echo2)
+{
+    static_assert(N == 3, "BasketSensorArray: the six pins init() is for three hoops");
+    const uint8_t trig_pins[3] = {in_trig0, in_trig1, in_trig2};
+    const uint8_t echo_pins[3] = {in_echo0, in_echo1, in_echo2};
+    return init(trig_pins, echo_pins);
+}
+
+// Initializes m_trig_pins and m_echo_pins arrays through an input array as argument
+// Can be dangerous if arguments are pointers to an array with less than N elements
+template<uint8_t N>
+bool BasketSensorArray<N>::init(const uint8_t* in_trig_pin_arr, const uint8_t* in_echo_pin_arr)
+{
+    // Check for null
+    if (!in_trig_pin_arr || !in_echo_pin_arr)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        m_trig_pins[i] = in_trig_pin_arr[i];
+        m_echo_pins[i] = in_echo_pin_arr[i];
+        pinMode(m_trig_pins[i], OUTPUT);
+        pinMode(m_echo_pins[i], INPUT);
+    }
+    return true;
+}
+
+// Check all sensors at the same time and returns a bitmap of the reading, bit i set if sensor i detected a ball
+template<uint8_t N>
+typename BasketSensorArray<N>::pattern_t BasketSensorArray<N>::check_sensors()
+{
+    if (!m_ready) return static_cast<pattern_t>(HoopTraits<N>::LAYOUT_STOP);
+
+    uint32_t pulse_starts[N] = {};
+    uint32_t pulse_durations[N] = {};
+    uint8_t sensor_states[N] = {}; // 0 = waiting for HIGH, 1 = measuring HIGH, 2 = done
+    uint8_t sensors_done = 0;
+
+    send_trigger_pulse();
+
+    // Monitor echo pins
+    uint16_t samples = 0;
+    uint32_t start_micros = micros();
+    while (micros() - start_micros < BALL_DETECTION_TIMEOUT)
+    {
+        ++samples;
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            if (sensor_states[i] == 0 && digitalRead(m_echo_pins[i]) == HIGH)
+            {   // Start timing the pulse
+                pulse_starts[i] = micros();
+                sensor_states[i] = 1;
+            }
+            else if (sensor_states[i] == 1 && digitalRead(m_echo_pins[i]) == LOW)
+            {   // Pulse ended, calculate duration
+                pulse_durations[i] = micros() - pulse_starts[i];
+                sensor_states[i] = 2;
+                ++sensors_done;
+            }
+        }
+
+        // Exit early if all sensors are done
+        if (sensors_done == N)
+        {
+            break;
+        }
+    }
+
+    m_last_samples = samples;
+    PROFILE_COUNT(Profiler::sensor_timeouts, N - sensors_done);
+    trace_sweep(pulse_durations, start_micros);
+    return durations_to_pattern(pulse_durations);
+}
+
+// Return amount of shots converted by validating which sensors where triggered and which ones where valid
+// at any given time, by using a bitwise AND on the current valid Layout of rims and the (inputed) sensor readings
+template<uint8_t N>
+uint8_t BasketSensorArray<N>::filter_sensor_readings(const pattern_t in_curr_pattern, const pattern_t in_sensor_checks)
+{
+    return filter_sensor_readings(in_curr_pattern, in_sensor_checks, millis());
+}
+
+template<uint8_t N>
+uint8_t BasketSensorArray<N>::filter_sensor_readings(const pattern_t in_curr_pattern, const pattern_t in_sensor_checks, const uint32_t in_now)
+{
+    if (!m_ready || in_sensor_checks >= HoopTraits<N>::LAYOUT_STOP) return 0;
+
+    mask_t expired = m_hoops_cooldown.update(in_now);
+    if (expired)
+    {
+        debugLibLog(LOG_COOLDOWN_ENDED, expired);
+    }
+    mask_t valid_rims = in_curr_pattern & in_sensor_checks & ~m_hoops_cooldown.get_active(); // Clear bits of the sensors on cooldown
+
+    debugLibLog(LOG_VALID_RIMS, valid_rims);
+
+    // Every valid rim is one shot converted
+    m_hoops_cooldown.set_cooldown(valid_rims, in_now);
+    return count_hoops(valid_rims);
+}
+
+// Send a pulse to the ultrasonic sensor on each trigger pin
+template<uint8_t N>
+void BasketSensorArray<N>::send_trigger_pulse()
+{
+    for (uint8_t i = 0; i < N; ++i) digitalWrite(m_trig_pins[i], LOW);
+    delayMicroseconds(2);
+    for (uint8_t i = 0; i < N; ++i) digitalWrite(m_trig_pins[i], HIGH);
+    delayMicroseconds(10);
+    for (uint8_t i = 0; i < N; ++i) digitalWrite(m_trig_pins[i], LOW);
+}
+
+// Convert durations to distances and then binary representation (zero durations are timeouts)
+template<uint8_t N>
+typename BasketSensorArray<N>::pattern_t BasketSensorArray<N>::durations_to_pattern(const uint32_t* in_durations) const
+{
+    mask_t result = 0;
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        result |= mask_t(duration_detects(in_durations[i]) ? 1 : 0) << i;
+    }
+
+    return static_cast<pattern_t>(result);
+}
+
+// True if an echo pulse width (microseconds) is a ball inside the detection threshold
+template<uint8_t N>
+bool BasketSensorArray<N>::duration_detects(const uint32_t in_duration)
+{
+    if (!in_duration) return false;
+
+    uint32_t distance = (in_duration * SOUND_SPEED) / 2;
+    return distance > 1 && distance < BALL_DETECTION_THRESHOLD;
+}
+
+// Record one TRACE_SWEEP event per sensor, all with the timestamp of the sweep
+template<uint8_t N>
+void BasketSensorArray<N>::trace_sweep(const uint32_t* in_durations, const uint32_t in_micros)
+{
+    if (!m_trace) return;
+
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        m_trace->record(TRACE_SWEEP, i, in_durations[i], in_micros);
+    }
+}
+
+// Attach a CHANGE interrupt to each echo pin, fails if any pin can't be attached or another instance owns the ISRs
+template<uint8_t N>
+bool BasketSensorArray<N>::attach_interrupts()
+{
+    if (!m_ready || (s_irq_instance && s_irq_instance != this)) return false;
+
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        if (digitalPinToInterrupt(m_echo_pins[i]) == NOT_AN_INTERRUPT)
+        {
+            debugLib("[BasketSensorArray::attach_interrupts] Echo pin without interrupt support\n");
+            return false;
+        }
+    }
+
+    m_sweep_active = false;
+    s_irq_instance = this;
+    EchoIsrAttacher<BasketSensorArray, N>::attach(m_echo_pins);
+    m_irq_mode = true;
+    return true;
+}
+
+template<uint8_t N>
+void BasketSensorArray<N>::detach_interrupts()
+{
+    if (!m_irq_mode) return;
+
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        detachInterrupt(digitalPinToInterrupt(m_echo_pins[i]));
+    }
+    m_irq_mode = false;
+    m_sweep_active = false;
+    s_irq_instance = nullptr;
+}
+
+// Start a sweep and return right away, the result is collected by poll()
+// Returns false if not in interrupt mode or if the previous sweep was not polled to completion yet
+template<uint8_t N>
+bool BasketSensorArray<N>::trigger()
+{
+    if (!m_irq_mode || m_sweep_active) return false;
+
+    noInterrupts();
+    m_echo_high = 0;
+    m_echo_done = 0;
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        m_echo_durations[i] = 0;
+    }
+    interrupts();
+
+    send_trigger_pulse();
+    m_sweep_start = micros();
+    m_sweep_active = true;
+    return true;
+}
+
+// Non-blocking, returns true and writes out_pattern once all echoes are in or BALL_DETECTION_TIMEOUT has passed since trigger()
+template<uint8_t N>
+bool BasketSensorArray<N>::poll(pattern_t& out_pattern)
+{
+    if (!m_sweep_active) return false;
+
+    /* One snapshot of the done mask and the durations it guards: for N >= 8 the mask is a uint16_t, read in two byte
+       loads on AVR that an echo ISR could fire between. The sweep is closed in the same section when complete, so late
+       edges can't touch the durations. */
+    uint32_t elapsed = micros() - m_sweep_start;
+    uint32_t durations[N];
+    noInterrupts();
+    mask_t done = m_echo_done;
+    bool complete = done == HoopTraits<N>::ALL_HOOPS || elapsed >= BALL_DETECTION_TIMEOUT;
+    if (complete)
+    {
+        m_sweep_active = false;
+        for (uint8_t i = 0; i < N; ++i)
+        {
+            durations[i] = (done & (mask_t(1) << i)) ? m_echo_durations[i] : 0;
+        }
+    }
+    interrupts();
+
+    if (!complete) return false; // Echoes still in flight
+    for (uint8_t i = 0; i < N; ++i)
+    {
+        PROFILE_COUNT(Profiler::sensor_timeouts, !(done & (mask_t(1) << i)));
+    }
+
+    trace_sweep(durations, m_sweep_start);
+    out_pattern = durations_to_pattern(durations);
+    return true;
+}
+
+// Timestamp the rising edge of an echo and store the pulse width on its falling edge (one pulse per echo per sweep)
+template<uint8_t N>
+void BasketSensorArray<N>::handle_echo_edge(uint8_t in_index, uint8_t in_level, uint32_t in_micros)
+{
+    if (!m_sweep_active || in_index >= N) return;
+
+    mask_t bit = mask_t(1) << in_index;
+    if (m_echo_done & bit) return;
+
+    if (in_level == HIGH)
+    {
+        m_echo_rise[in_index] = in_micros;
+        m_echo_high |= bit;
+    }
+    else if (m_echo_high & bit)
+    {
+        uint32_t duration = in_micros - m_echo_rise[in_index];
+        m_echo_durations[in_index] = duration;
+        m_echo_done |= bit;
+
+        if (m_event_queue && duration_detects(duration))
+        {
+            HoopEvent event;
+            event.hoop = in_index;
+            event.micros = in_micros;
+            m_event_queue->push(event);
+        }
+    }
+}
+
+// The original three hoops API (BitmapPattern readings)
+typedef BasketSensorArray<3> ThreeBasketSensors;
+// BasketSensorArray (end)
+
+
+// FastThreeBasketSensors (begin)
+// Direct port I/O is available for the Uno/Nano (ATmega328P/168) and Mega (ATmega2560) pinouts, and on the host build
+// (extras/host), which emulates the ATmega328P port registers
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega2560__) || defined(NBAPARK_HOST_PORTS)
+    #define NBAPARK_FAST_PINS 1
+#else
+    #define NBAPARK_FAST_PINS 0
+#endif
+
+#if NBAPARK_FAST_PINS
+// Port (Arduino PA..PL numbering) and bit of a digital pin, resolved at compile time
+template<uint8_t PIN>
+struct FastPin
+{
+#if defined(__AVR_ATmega2560__)
+    static_assert(PIN < 70, "FastPin: invalid pin for the ATmega2560");
+    static const uint8_t port = "EEEEGEHHHHBBBBJJHHDDDDAAAAAAAACCCCCCCCDGGGLLLLLLLLBBBBFFFFFFFFKKKKKKKK"[PIN] - 'A' + 1;
+    static const uint8_t mask = 1 << ("0145533456456710103210012345677654321072107654321032100123456701234567"[PIN] - '0');
+#else
+    static_assert(PIN < 20, "FastPin: invalid pin for the ATmega328P");
+    static const uint8_t port = (PIN < 8) ? PD : ((PIN < 14) ? PB : PC);
+    static const uint8_t mask = 1 << ((PIN < 8) ? PIN : ((PIN < 14) ? PIN - 8 : PIN - 14));
+#endif
+};
+
+// Input register of a port, the switch folds away when in_port is a compile-time constant
+inline __attribute__((always_inline)) uint8_t fast_port_read(const uint8_t in_port)
+{
+    switch (in_port)
+    {
+#if defined(__AVR_ATmega2560__)
+        case PA: return PINA;
+        case PB: return PINB;
+        case PC: return PINC;
+        case PD: return PIND;
+        case PE: return PINE;
+        case PF: return PINF;
+        case PG: return PING;
+        case PH: return PINH;
+        case PJ: return PINJ;
+        case PK: return PINK;
+        default: return PINL;
+#else
+        case PB: return PINB;
+        case PC: return PINC;
+        default: return PIND;
+#endif
+    }
+}
+#endif // NBAPARK_FAST_PINS
+
+/* Same API as ThreeBasketSensors, but with the pins as template parameters so check_sensors() can sample all echo pins
+   with direct register reads (one read per port, a single one when all echoes share a port) and one micros() per sample.
+   On other boards it falls back to the runtime-pin ThreeBasketSensors::check_sensors(). */
+template<uint8_t TRIG0, uint8_t TRIG1, uint8_t TRIG2, uint8_t ECHO0, uint8_t ECHO1, uint8_t ECHO2>
+class FastThreeBasketSensors : public ThreeBasketSensors
+{
+public:
+    // Constructor
+    FastThreeBasketSensors() : ThreeBasketSensors()
+    {
+        m_ready = init(TRIG0, TRIG1, TRIG2, ECHO0, ECHO1, ECHO2);
+    }
+
+    // Methods
+    BitmapPattern check_sensors()
+    {
+#if NBAPARK_FAST_PINS
+        if (!m_ready) return BitmapPattern::LAYOUT_STOP;
+
+        uint32_t pulse_starts[3] = {0, 0, 0};
+        uint32_t pulse_durations[3] = {0, 0, 0};
+        uint8_t high = 0; // Bitmask of the echoes measuring HIGH
+        uint8_t done = 0; // Bitmask of the echoes already measured
+        uint16_t samples = 0;
+
+        send_trigger_pulse();
+
+        // Monitor echo pins
+        uint32_t start_micros = micros();
+        uint32_t now = start_micros;
+        while (done != 0b0111u && now - start_micros < BALL_DETECTION_TIMEOUT)
+        {
+            uint8_t levels = sample_echoes();
+            uint8_t rising = levels & ~(high | done);
+            uint8_t falling = high & ~levels;
+            now = micros();
+            ++samples;
+
+            if (rising | falling)
+            {
+                for (uint8_t i = 0; i < 3; ++i)
+                {
+                    if (rising & (1 << i)) pulse_starts[i] = now;
+                    else if (falling & (1 << i)) pulse_durations[i] = now - pulse_starts[i];
+                }
+                high = (high | rising) & ~falling;
+                done |= falling;
+            }
+        }
+
+        m_last_samples = samples;
+        PROFILE_COUNT(Profiler::sensor_timeouts, !(done & 0b001u) + !(done & 0b010u) + !(done & 0b100u));
+        trace_sweep(pulse_durations, start_micros);
+        return durations_to_pattern(pulse_durations);
+#else
+        return ThreeBasketSensors::check_sensors();
+#endif
+    }
+
+private:
+#if NBAPARK_FAST_PINS
+    // Read the level of all echo pins as 0000_0[e2][e1][e0], reading each distinct port only once
+    static inline __attribute__((always_inline)) uint8_t sample_echoes()
+    {
+        const uint8_t port0 = FastPin<ECHO0>::port;
+        const uint8_t port1 = FastPin<ECHO1>::port;
+        const uint8_t port2 = FastPin<ECHO2>::port;
+
+        uint8_t reg0 = fast_port_read(port0);
+        uint8_t reg1 = (port1 == port0) ? reg0 : fast_port_read(port1);
+        uint8_t reg2 = (port2 == port0) ? reg0 : ((port2 == port1) ? reg1 : fast_port_read(port2));
+
+        return ((reg0 & FastPin<ECHO0>::mask) ? 0b0001u : 0)
+             | ((reg1 & FastPin<ECHO1>::mask) ? 0b0010u : 0)
+             | ((reg2 & FastPin<ECHO2>::mask) ? 0b0100u : 0);
+    }
+#endif
+};
+// FastThreeBasketSensors (end)
+
+
+// Handle the multiple states and the dynamic layouts of the MVP Competition basketball rims (N hoops)
+// Needs to point to an array of Layout instances with the last Layout.active being the sentinel HoopTraits<N>::LAYOUT_STOP
+template<uint8_t N>
+class MVPHoopsArray
+{
+public:
+    typedef typename HoopTraits<N>::mask_t mask_t;
+    typedef typename HoopTraits<N>::pattern_t pattern_t;
+
+    struct Layout
+    {
         uint32_t time;
-        BitmapPattern active;
+        pattern_t active;
+
+        // Layout constructors
+        Layout() : time(0), active(static_cast<pattern_t>(0)) {}
+        Layout(uint32_t in_time, pattern_t in_active) : time(in_time), active(in_active) {}
+    };
+
+    enum MVPState : uint8_t
+    {
+        MVP_GAME_OVER,
+        MVP_RUNNING,
+        MVP_HOLD
+    };
+
+private:
+    // Member variables
+    const Layout* m_layouts_arr;
+    uint8_t m_curr;           // Index for the current Layout obj
+    uint8_t m_next;           // Index for the next Layout obj
+    pattern_t m_curr_pattern; // Copy of the pattern member variable Layout.active
+
+public:
+    // Constructors
+    MVPHoopsArray() : m_layouts_arr(nullptr), m_curr(0), m_next(1), m_curr_pattern(static_cast<pattern_t>(0)) {} // Default Layout
+    MVPHoopsArray(const Layout* in_layouts_arr, const uint8_t in_size)
+        : m_layouts_arr(nullptr), m_curr(0), m_next(1), m_curr_pattern(static_cast<pattern_t>(0))
+    {
+        init(in_layouts_arr, in_size);
+    }
+
+    // Methods
+    bool init(const Layout* in_layout_arr, const uint8_t in_size);
+    MVPState update(uint32_t in_time);
+    MVPState reset(); // Always return MVP_GAME_OVER
+
+    // Accessors (copy)
+    pattern_t get_curr_pattern() const { return m_curr_pattern; }
+
+private:
+    // Method to iterate over layouts and ensure correct boundary checking
+    bool validate_layouts_arr(const Layout* in_layouts_arr, const uint8_t in_size);
+    void copy_pattern(const Layout* in_layout) { m_curr_pattern = in_layout->active; }
+};
+
+template<uint8_t N>
+bool MVPHoopsArray<N>::init(const Layout* in_layouts_arr, const uint8_t in_size)
+{
+    if (!validate_layouts_arr(in_layouts_arr, in_size))
+    {   // Invalid - raise error
+        return false;
+    }
+    m_layouts_arr = in_layouts_arr;
+
+    // Copy the pattern from the Layout obj id
+    copy_pattern(&m_layouts_arr[m_curr]);
+    return true;
+}
+
+// Iterate over the array to validate its layouts and check its size argument
+template<uint8_t N>
+bool MVPHoopsArray<N>::validate_layouts_arr(const Layout* in_layouts_arr, const uint8_t in_size)
+{
+    if (!in_layouts_arr)
+    {   // Handle nullptr error
+        return false;
+    }
+    else if (in_layouts_arr[0].active == HoopTraits<N>::LAYOUT_STOP || in_size < 2)
+    {   // Empty array or without valid layouts
+        return false;
+    }
+
+    uint8_t i = 0;
+    Layout curr_layout = in_layouts_arr[0];
+
+    // Iterate until the second to last element
+    for(; i < in_size - 1 && curr_layout.active != HoopTraits<N>::LAYOUT_STOP; curr_layout = in_layouts_arr[++i])
+    {
+        if (curr_layout.active > HoopTraits<N>::LAYOUT_STOP) return false;
+    }
+
+    // Checks the in_size and if the last element in in_layouts_arr is the sentinel value
+    return (i == in_size - 1 && curr_layout.active == HoopTraits<N>::LAYOUT_STOP);
+}
+
+// Update the current valid layout by dereferencing the next available Layout obj by checking the in_time argument and returning the "game state"
+template<uint8_t N>
+typename MVPHoopsArray<N>::MVPState MVPHoopsArray<N>::update(const uint32_t in_time)
+{
+    if (!m_layouts_arr)
+    {
+        return MVP_GAME_OVER;
+    }
+    else if (in_time >= m_layouts_arr[m_next].time)
+    {
+        if (m_layouts_arr[++m_curr].active == HoopTraits<N>::LAYOUT_STOP)
+        {
+            // End of the transitions
+            reset();
+            return MVP_GAME_OVER;
+        }
+        copy_pattern(&m_layouts_arr[m_next++]);
+    }
+    else if (in_time < m_layouts_arr[m_curr].time)
+    {
+        return MVP_HOLD;
+    }
+
+    return MVP_RUNNING;
+}
+
+template<uint8_t N>
+typename MVPHoopsArray<N>::MVPState MVPHoopsArray<N>::reset()
+{
+    m_curr = 0;
+    m_next = 1;
+    if (m_layouts_arr)
+        copy_pattern(&m_layouts_arr[m_curr]);
+
+    return MVP_GAME_OVER;
+}
 
-        // Layout constructors
-        Layout() : time(0), active(LAYOUT_0) {}
-        Layout(uint32_t in_time, BitmapPattern in_active) : time(in_time), active(in_active) {}
-    };
+// The original three hoops API (BitmapPattern layouts)
+typedef MVPHoopsArray<3> MVPHoops;
 
-    enum MVPState : uint8_t
-    {
-        MVP_GAME_OVER,
-        MVP_RUNNING,
-        MVP_HOLD
-    };
 
-private:
-    // Member variables
-    const Layout* m_layouts_arr;
-    uint8_t m_curr;               // Index for the current Layout obj  
-    uint8_t m_next;               // Index for the next Layout obj
-    BitmapPattern m_curr_pattern; // Copy of the BitmapPattern member variable Layout.active
+// Store in_value in out_buffer in big-endian byte order (OSC wire format), no alignment needed
+inline void osc_write_be32(uint8_t* out_buffer, uint32_t in_value)
+{
+    out_buffer[0] = in_value >> 24;
+    out_buffer[1] = in_value >> 16;
+    out_buffer[2] = in_value >> 8;
+    out_buffer[3] = in_value;
+}
 
-public:
-    // Constructors
-    MVPHoops();
-    MVPHoops(const Layout* in_layout_arr, const uint8_t in_size);
+inline uint32_t osc_read_be32(const uint8_t* in_buffer)
+{
+    return (uint32_t(in_buffer[0]) << 24) | (uint32_t(in_buffer[1]) << 16) | (uint32_t(in_buffer[2]) << 8) | in_buffer[3];
+}
+
+
+// OSCHeaderTemplate (begin)
+/* Pre-encoded OSC message header: the address and type tag strings already null padded to 4 bytes, as they go on the
+   wire. A char array initialized from a shorter string literal is zero filled, so the aggregate initialization done by
+   OSC_HEADER_TEMPLATE() builds the padding at compile time, and the object lives in flash (PROGMEM). Sending is then
+   one copy of the header plus the argument bytes, with no address copies, strnlen() or padding loops at runtime.
+   ADDR_LEN and TAGS_LEN are the sizes of the literals (null terminator included). The write methods don't check the
+   type tags, use the one that matches the tags of the template (",i", ",f", ",s", or "," for an address only message). */
+template<uint8_t ADDR_LEN, uint8_t TAGS_LEN>
+struct OSCHeaderTemplate
+{
+    static const uint8_t ADDR_SIZE = (ADDR_LEN + 3) & ~3;
+    static const uint8_t TAGS_SIZE = (TAGS_LEN + 3) & ~3;
+    static const uint8_t SIZE = ADDR_SIZE + TAGS_SIZE;
 
-    // Methods
-    bool init(const Layout* in_layout_arr, const uint8_t in_size);
-    MVPState update(uint32_t in_time);
-    MVPState reset(); // Always return MVP_GAME_OVER
+    char addr[ADDR_SIZE];
+    char tags[TAGS_SIZE];
 
-    // Accessors (copy)
-    BitmapPattern get_curr_pattern() const { return m_curr_pattern; }
+    // Header only, returns the number of bytes written or 0 if in_capacity is too small
+    size_t write(uint8_t* out_buffer, size_t in_capacity) const
+    {
+        if (!out_buffer || in_capacity < SIZE) return 0;
+        memcpy_P(out_buffer, this, SIZE);
+        return SIZE;
+    }
 
-private:
-    // Method to iterate over layouts and ensure correct boundary checking
-    bool validate_layouts_arr(const Layout* in_layouts_arr, const uint8_t in_size);
-    void copy_pattern(const Layout* in_layout);
-};
+    // Header followed by one big-endian 32 bits argument (",i" or ",f" tags)
+    size_t write_int(uint8_t* out_buffer, size_t in_capacity, int32_t in_int) const
+    {
+        if (!write(out_buffer, in_capacity) || in_capacity < SIZE + 4U) return 0;
+        osc_write_be32(out_buffer + SIZE, static_cast<uint32_t>(in_int));
+        return SIZE + 4U;
+    }
 
+    size_t write_float(uint8_t* out_buffer, size_t in_capacity, float in_float) const
+    {
+        int32_t bits;
+        memcpy(&bits, &in_float, sizeof(bits));
+        return write_int(out_buffer, in_capacity, bits);
+    }
 
-class OSCPark
-{
-    // Struct used to store the value data from OSCMessages
-    struct Value
+    // Header followed by one null padded string argument (",s" tags)
+    size_t write_string(uint8_t* out_buffer, size_t in_capacity, const char* in_str) const
     {
-        char type_tag;
-        union Data
-        {
-            int32_t i_value;
-            float f_value;
-            char* s_value;
-        } data;
+        size_t str_len = strlen(in_str);
+        size_t total = SIZE + ((str_len + 4) & ~static_cast<size_t>(3));
+        if (!write(out_buffer, in_capacity) || in_capacity < total) return 0;
 
-        void setup(const char in_type_tag, const uint8_t* in_ptr);
-    };
+        memcpy(out_buffer + SIZE, in_str, str_len);
+        memset(out_buffer + SIZE + str_len, 0, total - SIZE - str_len);
+        return total;
+    }
+};
+
+// Define a PROGMEM OSCHeaderTemplate named name, e.g. OSC_HEADER_TEMPLATE(score_header, "/score", ",s");
+#define OSC_HEADER_TEMPLATE(name, address, tags) \
+    const OSCHeaderTemplate<sizeof(address), sizeof(tags)> name PROGMEM = { address, tags }
+// OSCHeaderTemplate (end)
 
+
+/* OSC message with up to OSC_MAX_ARGS arguments, any mix of the types i, f, s, b (blob), h (int64), d (double),
+   t (timetag), T, F and N. The arguments are kept in the OSC wire format (big-endian, strings and blobs null padded to
+   4 bytes), in the inline storage of OSC_MAX_DATA_LEN bytes or in a caller owned buffer bound with bind_data_buffer(),
+   without heap allocations. The typed accessors convert them on demand, and serialize() copies them as they are.
+   An argument that doesn't fit the storage is dropped, except strings which are truncated. */
+class OSCPark
+{
     char m_addr[80];
-    char m_type_tags[8];
-    Value m_value;
+    char m_type_tags[OSC_MAX_ARGS + 1];
+    uint16_t m_arg_offsets[OSC_MAX_ARGS]; // Offset of each argument in m_data
+
+    uint8_t m_data_inline[OSC_MAX_DATA_LEN];
+    uint8_t* m_data;      // Argument storage, m_data_inline or the buffer bound by the caller
+    uint16_t m_data_size; // Size of m_data in bytes
+    uint16_t m_data_len;  // Bytes of m_data in use
 
     uint8_t m_addr_len;
-    uint8_t m_type_len;
-    uint8_t m_values_len;
+    uint8_t m_type_len; // Number of arguments
 
 public:
     // Constructors
     OSCPark();
-    OSCPark(const uint8_t* in_buffer);
+    OSCPark(const uint8_t* in_buffer, size_t in_len = OSC_MAX_PACKET_LEN);
     OSCPark(const char* in_address);
-
-    // Destructor
-    ~OSCPark() { clear(); }
+    OSCPark(const OSCPark& in_other);
+    OSCPark& operator=(const OSCPark& in_other);
 
     // Methods
-    void init(const uint8_t* in_buffer);
+    /* Extract a received packet of in_len bytes (OSC_MAX_PACKET_LEN if unknown, e.g. the receive buffer size).
+       Returns false if an argument was unsupported, didn't fit the storage or ran past the end of the packet. */
+    bool init(const uint8_t* in_buffer, size_t in_len = OSC_MAX_PACKET_LEN);
     void init(const char* in_address);
-    void set_int(const int in_int);
+
+    // Replace the arguments with a single value
+    void set_int(const int32_t in_int);
     void set_float(const float in_float);
-    void set_string(const char* in_str);
-    void send(Print& in_p);
+    bool set_string(const char* in_str);
+
+    // Append an argument, false if the message already has OSC_MAX_ARGS arguments or the value doesn't fit the storage
+    bool add_int(int32_t in_int);
+    bool add_float(float in_float);
+    bool add_string(const char* in_str);
+    bool add_blob(const uint8_t* in_blob, uint16_t in_len);
+    bool add_int64(int64_t in_int);
+    bool add_double(double in_double);
+    bool add_timetag(uint32_t in_seconds, uint32_t in_fraction);
+    bool add_bool(bool in_bool);
+    bool add_nil();
+    void clear_args();
+
+    void bind_data_buffer(uint8_t* in_buffer, uint16_t in_size);
+    size_t serialized_size() const;
+    size_t serialize(uint8_t* out_buffer, size_t in_capacity) const;
+    bool send(Print& in_p) const;
     void clear();
 
     // Prints to DEBUG_OUTPUT
@@ -522,12 +2017,620 @@ public:
     const char* get_addr() const { return m_addr; }
     const char* get_addr_cmp() { return m_addr; } // Non-const return to be used in strncmp
     const char* get_type() const { return m_type_tags; }
-    int32_t get_int() const { return m_value.data.i_value; }
-    float get_float() const { return m_value.data.f_value; }
-    char* get_str() const { return m_value.data.s_value; }
+    uint8_t get_arg_count() const { return m_type_len; }
+    char get_arg_type(uint8_t in_index) const { return (in_index < m_type_len) ? m_type_tags[in_index] : '\0'; }
+
+    /* Typed argument accessors (first argument by default). Numbers convert between i, f, h and d (and T/F for the
+       integers), other mismatches return 0, false or nullptr. */
+    int32_t get_int(uint8_t in_index = 0) const;
+    float get_float(uint8_t in_index = 0) const;
+    int64_t get_int64(uint8_t in_index = 0) const;
+    double get_double(uint8_t in_index = 0) const;
+    char* get_str(uint8_t in_index = 0) const;
+    const uint8_t* get_blob(uint8_t in_index, uint16_t& out_len) const;
+    bool get_timetag(uint8_t in_index, uint32_t& out_seconds, uint32_t& out_fraction) const;
+    bool get_bool(uint8_t in_index = 0) const;
+
     uint8_t get_addr_len() const { return m_addr_len; }
     uint8_t get_type_len() const { return m_type_len; }
-    uint8_t get_values_len() const { return m_values_len; }
+    uint8_t get_values_len() const { return m_type_len; }
+    uint16_t get_data_len() const { return m_data_len; }
+
+private:
+    uint8_t* reserve_arg(char in_type, uint16_t in_size);
+    const uint8_t* arg_data(uint8_t in_index) const { return (in_index < m_type_len) ? m_data + m_arg_offsets[in_index] : nullptr; }
+};
+
+
+/* Zero-copy view of a received OSC message: parse() validates alignment and bounds of the whole (in_buffer, in_len)
+   packet in one pass and keeps offsets into it, so the address, type tags and arguments are read in place. The buffer
+   must outlive the view. Prefer it to OSCPark::init() on untrusted input, which only bounds the arguments by the packet
+   length and reads the address and type tags up to OSC_MAX_ADDRESS_LEN ahead. */
+class OSCView
+{
+    const uint8_t* m_buffer;
+    size_t m_len;
+    uint16_t m_addr_len;
+    const char* m_type_tags; // Points into m_buffer (after the ','), "" if none
+    uint8_t m_arg_count;
+    uint16_t m_arg_offsets[OSC_MAX_ARGS]; // Offset of each argument in m_buffer
+    bool m_valid;
+
+public:
+    // Constructors
+    OSCView();
+    OSCView(const uint8_t* in_buffer, size_t in_len);
+
+    // Methods
+    bool parse(const uint8_t* in_buffer, size_t in_len);
+    bool addr_equals(const char* in_address) const;
+
+    // Accessors
+    bool is_valid() const { return m_valid; }
+    const char* get_addr() const { return m_valid ? reinterpret_cast<const char*>(m_buffer) : ""; }
+    uint16_t get_addr_len() const { return m_valid ? m_addr_len : 0; }
+    const char* get_type() const { return m_type_tags; }
+    uint8_t get_arg_count() const { return m_arg_count; }
+    char get_arg_type(uint8_t in_index) const { return (in_index < m_arg_count) ? m_type_tags[in_index] : '\0'; }
+
+    // Typed argument accessors, same conversions as OSCPark
+    int32_t get_int(uint8_t in_index = 0) const;
+    float get_float(uint8_t in_index = 0) const;
+    int64_t get_int64(uint8_t in_index = 0) const;
+    double get_double(uint8_t in_index = 0) const;
+    const char* get_str(uint8_t in_index = 0) const;
+    const uint8_t* get_blob(uint8_t in_index, uint16_t& out_len) const;
+    bool get_timetag(uint8_t in_index, uint32_t& out_seconds, uint32_t& out_fraction) const;
+    bool get_bool(uint8_t in_index = 0) const;
+
+private:
+    const uint8_t* arg_data(uint8_t in_index) const { return (in_index < m_arg_count) ? m_buffer + m_arg_offsets[in_index] : nullptr; }
+};
+
+
+// OSCRouter (begin)
+/* OSC address pattern helpers used by OSCRouter (also usable on their own). osc_address_hash() is a 32-bit FNV-1a
+   of the first in_len chars, osc_pattern_match() matches a whole address against a pattern with the OSC 1.0
+   wildcards: '?' (one char), '*' (any run of chars), "[a-z]" / "[!abc]" (one char from a set or range) and
+   "{foo,bar}" (one of the strings). Wildcards never match a '/', so they stay inside one address part. */
+uint32_t osc_address_hash(const char* in_address, uint16_t in_len);
+bool osc_pattern_match(const char* in_pattern, const char* in_address);
+bool osc_is_pattern(const char* in_address);
+
+/* Fixed table of address -> handler routes. Literal routes are kept sorted by their precomputed hash, so dispatching
+   a literal address costs one hash, a binary search and one confirming strcmp() whatever the number of routes.
+   Routes registered with wildcards are matched against every incoming address, and an incoming address containing
+   wildcards (allowed by OSC) is matched against every literal route, calling each match.
+   MSG is the message type passed to the handlers, anything with get_addr() and get_addr_len() (OSCView, OSCPark).
+   The route addresses aren't copied, they must stay valid (string literals or globals). */
+template<uint8_t N, typename MSG = OSCView>
+class OSCRouter
+{
+public:
+    typedef void (*Handler)(const MSG& in_msg, void* in_ctx);
+
+private:
+    struct Route
+    {
+        const char* address;
+        uint32_t hash;
+        Handler handler;
+        void* ctx;
+    };
+
+    Route m_routes[N]; // Literal routes sorted by hash, then the pattern routes from the end of the table
+    uint8_t m_literal_count;
+    uint8_t m_pattern_count;
+
+public:
+    // Constructor
+    OSCRouter() : m_literal_count(0), m_pattern_count(0) {}
+
+    // Accessors
+    uint8_t get_count() const { return m_literal_count + m_pattern_count; }
+
+    // Methods
+    // Register a route, returns false if the table is full or an argument is null
+    bool add(const char* in_address, Handler in_handler, void* in_ctx = nullptr)
+    {
+        if (!in_address || !in_handler || get_count() >= N) return false;
+
+        if (osc_is_pattern(in_address))
+        {
+            ++m_pattern_count;
+            Route& route = m_routes[N - m_pattern_count];
+            route.address = in_address;
+            route.hash = 0;
+            route.handler = in_handler;
+            route.ctx = in_ctx;
+            return true;
+        }
+
+        // Insertion keeps the literal routes sorted (setup() only)
+        uint32_t hash = osc_address_hash(in_address, strlen(in_address));
+        uint8_t i = m_literal_count;
+        while (i > 0 && m_routes[i - 1].hash > hash)
+        {
+            m_routes[i] = m_routes[i - 1];
+            --i;
+        }
+        m_routes[i].address = in_address;
+        m_routes[i].hash = hash;
+        m_routes[i].handler = in_handler;
+        m_routes[i].ctx = in_ctx;
+        ++m_literal_count;
+        return true;
+    }
+
+    void clear()
+    {
+        m_literal_count = 0;
+        m_pattern_count = 0;
+    }
+
+    // Call the handler of every route matching the address of in_msg, returns the number of handlers called
+    uint8_t dispatch(const MSG& in_msg) const
+    {
+        const char* address = in_msg.get_addr();
+        uint8_t called = 0;
+
+        if (osc_is_pattern(address))
+        {
+            for (uint8_t i = 0; i < m_literal_count; ++i)
+            {
+                if (osc_pattern_match(address, m_routes[i].address))
+                {
+                    m_routes[i].handler(in_msg, m_routes[i].ctx);
+                    ++called;
+                }
+            }
+            return called;
+        }
+
+        // Lower bound of the hash, then confirm (hash collisions are adjacent)
+        uint32_t hash = osc_address_hash(address, in_msg.get_addr_len());
+        uint8_t low = 0;
+        uint8_t high = m_literal_count;
+        while (low < high)
+        {
+            uint8_t mid = (low + high) / 2;
+            if (m_routes[mid].hash < hash) low = mid + 1;
+            else high = mid;
+        }
+        for (uint8_t i = low; i < m_literal_count && m_routes[i].hash == hash; ++i)
+        {
+            if (strcmp(m_routes[i].address, address) == 0)
+            {
+                m_routes[i].handler(in_msg, m_routes[i].ctx);
+                ++called;
+            }
+        }
+
+        for (uint8_t i = N - m_pattern_count; i < N; ++i)
+        {
+            if (osc_pattern_match(m_routes[i].address, address))
+            {
+                m_routes[i].handler(in_msg, m_routes[i].ctx);
+                ++called;
+            }
+        }
+        return called;
+    }
+};
+// OSCRouter (end)
+
+
+// OSC bundles (begin)
+/* Writes an OSC bundle ("#bundle", 64 bits NTP timetag, then each element prefixed by its big-endian size) into a
+   caller owned buffer, so several messages go out in one datagram with a single write. Elements can be OSCPark
+   messages, already encoded bytes, or encoded in place between begin_element() and end_element(). */
+class OSCBundleWriter
+{
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_size;
+    uint8_t m_count; // Number of elements
+
+public:
+    static const uint8_t HEADER_SIZE = 16; // "#bundle\0" + timetag
+
+    // Constructor, the default timetag (seconds 0, fraction 1) means "immediately"
+    OSCBundleWriter(uint8_t* in_buffer, size_t in_capacity, uint32_t in_seconds = 0, uint32_t in_fraction = 1);
+
+    // Methods
+    static void write_header(uint8_t* out_header, uint32_t in_seconds = 0, uint32_t in_fraction = 1);
+    bool reset(uint32_t in_seconds = 0, uint32_t in_fraction = 1);
+    bool add(const OSCPark& in_msg);
+    bool add(const uint8_t* in_msg, size_t in_len);
+    uint8_t* begin_element(size_t& out_capacity);
+    bool end_element(size_t in_len);
+    bool send(Print& in_p) const;
+
+    // Accessors
+    const uint8_t* get_buffer() const { return m_buffer; }
+    size_t get_size() const { return m_size; }
+    uint8_t get_count() const { return m_count; }
+};
+
+/* Iterates over the elements of a received bundle without copying them. next() stops at the end of the buffer or at
+   the first malformed element size. An element can be a bundle itself (check with is_bundle()). */
+class OSCBundleReader
+{
+    const uint8_t* m_buffer;
+    size_t m_len;
+    size_t m_pos;
+
+public:
+    // Constructor
+    OSCBundleReader(const uint8_t* in_buffer, size_t in_len);
+
+    // Methods
+    static bool is_bundle(const uint8_t* in_buffer, size_t in_len);
+    bool next(const uint8_t*& out_element, size_t& out_len);
+    void rewind() { m_pos = is_valid() ? OSCBundleWriter::HEADER_SIZE : m_len; }
+
+    // Accessors
+    bool is_valid() const { return is_bundle(m_buffer, m_len); }
+    uint32_t get_timetag_seconds() const { return is_valid() ? osc_read_be32(m_buffer + 8) : 0; }
+    uint32_t get_timetag_fraction() const { return is_valid() ? osc_read_be32(m_buffer + 12) : 0; }
+};
+// OSC bundles (end)
+
+
+// SLIP (begin)
+/* OSC 1.1 over a serial link: each packet is a SLIP (RFC 1055) frame ended by END, END and ESC bytes inside the
+   packet are sent as ESC ESC_END and ESC ESC_ESC. */
+#define SLIP_END 0xC0U
+#define SLIP_ESC 0xDBU
+#define SLIP_ESC_END 0xDCU
+#define SLIP_ESC_ESC 0xDDU
+
+/* Incremental SLIP decoder into a caller owned buffer. Bytes are fed one at a time or in chunks as they arrive and a
+   complete packet is reported as soon as its END is fed, never blocking for the rest of it. The packet stays in the
+   buffer (get_frame(), get_frame_len()) until the next byte is fed. Empty frames are skipped, frames larger than the
+   buffer or with an invalid escape are dropped and counted. */
+class SLIPDecoder
+{
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_len;
+    size_t m_frame_len; // Length of the last complete frame, 0 while receiving
+    bool m_escape;      // Last byte was SLIP_ESC
+    bool m_error;       // Current frame is dropped at its END
+    uint16_t m_dropped;
+
+public:
+    // Constructor
+    SLIPDecoder(uint8_t* in_buffer, size_t in_capacity);
+
+    // Methods
+    bool feed(uint8_t in_byte);
+    size_t feed(const uint8_t* in_data, size_t in_len, bool& out_frame);
+    bool read(Stream& in_stream);
+    void reset();
+
+    // Accessors
+    bool has_frame() const { return m_frame_len > 0; }
+    const uint8_t* get_frame() const { return m_buffer; }
+    size_t get_frame_len() const { return m_frame_len; }
+    uint16_t get_dropped() const { return m_dropped; }
+};
+
+/* Print wrapper that SLIP encodes everything written through it, so any send(Print&) of the library (OSCPark,
+   OSCBundleWriter) writes a frame when called between begin() and end(). Runs of bytes that need no escape are
+   passed to the wrapped Print in a single write(). */
+class SLIPEncoder : public Print
+{
+    Print& m_out;
+
+public:
+    // Constructor
+    SLIPEncoder(Print& in_out) : m_out(in_out) {}
+
+    // Methods
+    bool begin() { return m_out.write(SLIP_END) == 1; } // Flushes any line noise received before the frame
+    bool end() { return m_out.write(SLIP_END) == 1; }
+    bool send(const uint8_t* in_packet, size_t in_len);
+    bool send(const OSCPark& in_msg);
+    size_t write(uint8_t in_byte);
+    size_t write(const uint8_t* in_buffer, size_t in_len);
+    using Print::write;
+};
+// SLIP (end)
+
+
+// OSCPump (begin)
+/* Drains every pending UDP datagram in one call instead of one packet per loop(), up to a time budget, so a stream of
+   messages (e.g. the Resolume transport position at its frame rate) doesn't back up in the socket buffer and go
+   stale. Bundles are split into their messages, malformed or oversized packets are dropped, and consecutive messages
+   to the same address are coalesced: only the newest one is dispatched. Valid messages are passed as an OSCView to
+   in_sink.dispatch() (e.g. an OSCRouter) in the order they were received.
+   The caller owned buffer is split in two halves (the largest packet accepted), one keeps the message waiting to be
+   coalesced while the next packet is read in place into the other. */
+class OSCPump
+{
+    uint8_t* m_buffers[2];
+    size_t m_capacity; // Of each half
+    OSCView m_held;    // Newest message not dispatched yet
+    uint8_t m_held_buffer;
+    bool m_holding;
+
+    // Stats
+    uint32_t m_drained;   // Packets read from the socket
+    uint32_t m_coalesced; // Messages replaced by a newer one to the same address
+    uint32_t m_dropped;   // Malformed, oversized or unreadable packets and messages
+
+public:
+    // Constructor
+    OSCPump(uint8_t* in_buffer, size_t in_size);
+
+    // Methods
+    /* Read and dispatch packets from in_udp (EthernetUDP, WiFiUDP or anything with parsePacket() and read()) until
+       none is pending or in_budget_us is spent. At least one packet is read per call, returns the packets read. */
+    template<typename UDP_T, typename SINK>
+    uint8_t poll(UDP_T& in_udp, SINK& in_sink, uint32_t in_budget_us = OSC_RECEIVE_BUDGET)
+    {
+        uint32_t start = micros();
+        uint8_t packets = 0;
+
+        while (packets < 0xFF && (packets == 0 || micros() - start < in_budget_us))
+        {
+            int size = in_udp.parsePacket();
+            if (size <= 0) break;
+
+            ++packets;
+            ++m_drained;
+            if (static_cast<size_t>(size) > m_capacity)
+            {   // Left unread, the next parsePacket() skips it
+                ++m_dropped;
+                continue;
+            }
+
+            // Read into the half that isn't holding a message
+            uint8_t index = (m_holding && m_held_buffer == 0) ? 1 : 0;
+            int len = in_udp.read(m_buffers[index], m_capacity);
+            if (len <= 0)
+            {
+                ++m_dropped;
+                continue;
+            }
+
+            if (OSCBundleReader::is_bundle(m_buffers[index], len))
+            {
+                OSCBundleReader bundle(m_buffers[index], len);
+                const uint8_t* element;
+                size_t element_len;
+                while (bundle.next(element, element_len))
+                {
+                    offer(index, element, element_len, in_sink);
+                }
+            }
+            else
+            {
+                offer(index, m_buffers[index], len, in_sink);
+            }
+        }
+
+        flush(in_sink);
+        return packets;
+    }
+
+    // Dispatch the message held for coalescing (poll() already does it before returning)
+    template<typename SINK>
+    void flush(SINK& in_sink)
+    {
+        if (!m_holding) return;
+        m_holding = false;
+        in_sink.dispatch(m_held);
+    }
+
+    void reset_stats();
+
+    // Accessors
+    uint32_t get_drained() const { return m_drained; }
+    uint32_t get_coalesced() const { return m_coalesced; }
+    uint32_t get_dropped() const { return m_dropped; }
+
+private:
+    template<typename SINK>
+    void offer(uint8_t in_buffer_index, const uint8_t* in_msg, size_t in_len, SINK& in_sink)
+    {
+        OSCView msg(in_msg, in_len);
+        if (!msg.is_valid())
+        {
+            ++m_dropped;
+            return;
+        }
+
+        if (m_holding)
+        {
+            if (same_address(m_held, msg)) ++m_coalesced;
+            else in_sink.dispatch(m_held);
+        }
+        m_held = msg;
+        m_held_buffer = in_buffer_index;
+        m_holding = true;
+    }
+
+    static bool same_address(const OSCView& in_a, const OSCView& in_b);
+};
+// OSCPump (end)
+
+
+// OSCOutbox (begin)
+/* Outgoing messages keyed by OSC address, keeping only the latest value posted for each one until the next flush, so
+   a burst of updates (e.g. several baskets in the same frame) costs no network time where it happens and reaches the
+   receiver as one datagram with only the final values. flush() writes the pending messages to a Print (one message
+   as is, more as a bundle), is_due() rate limits the flushes to one per min interval.
+   Each of the N slots holds one encoded message of up to SLOT_SIZE bytes (multiple of 4), plus one spare slot that
+   post() encodes into before it replaces the pending value of the same address (no copy). Messages to different
+   addresses aren't kept in posting order inside a flush. */
+template<uint8_t N, uint8_t SLOT_SIZE = 96>
+class OSCOutbox
+{
+    struct Slot
+    {
+        uint8_t len; // Encoded message size, 0 when free
+        uint8_t data[SLOT_SIZE];
+    };
+
+    Slot m_slots[N + 1];
+    uint8_t m_spare;   // Slot the next post is encoded into
+    uint8_t m_pending; // Number of slots waiting for a flush
+    uint16_t m_min_interval;
+    uint32_t m_last_flush;
+    bool m_flushed;
+
+    // Stats
+    uint32_t m_suppressed; // Pending messages replaced by a newer value before being sent
+    uint32_t m_dropped;    // Posts rejected (outbox full or message larger than SLOT_SIZE)
+    uint32_t m_sent;       // Messages written by flush()
+
+public:
+    // Constructor
+    OSCOutbox(uint16_t in_min_interval = OSC_OUTBOX_INTERVAL)
+        : m_spare(N), m_pending(0), m_min_interval(in_min_interval), m_last_flush(0), m_flushed(false), m_suppressed(0), m_dropped(0), m_sent(0)
+    {
+        for (uint8_t i = 0; i <= N; ++i) m_slots[i].len = 0;
+    }
+
+    // Methods
+    bool post(const OSCPark& in_msg)
+    {
+        size_t capacity;
+        uint8_t* element = begin_post(capacity);
+        return end_post(in_msg.serialize(element, capacity));
+    }
+
+    bool post(const uint8_t* in_msg, size_t in_len)
+    {
+        size_t capacity;
+        uint8_t* element = begin_post(capacity);
+        if (!in_msg || in_len > capacity)
+        {
+            ++m_dropped;
+            return false;
+        }
+        memcpy(element, in_msg, in_len);
+        return end_post(in_len);
+    }
+
+    // Encode a message in place (e.g. with an OSCHeaderTemplate) then call end_post() with its size
+    uint8_t* begin_post(size_t& out_capacity)
+    {
+        out_capacity = SLOT_SIZE;
+        return m_slots[m_spare].data;
+    }
+
+    // Queue the message encoded after begin_post(), replacing the pending one with the same address
+    bool end_post(size_t in_len)
+    {
+        Slot& spare = m_slots[m_spare];
+        if (!in_len || in_len > SLOT_SIZE || (in_len & 3) || !memchr(spare.data, '\0', in_len))
+        {
+            ++m_dropped;
+            return false;
+        }
+
+        // Pending message with the same address, the spare takes its place
+        for (uint8_t i = 0; i <= N; ++i)
+        {
+            if (i == m_spare || !m_slots[i].len) continue;
+            if (strcmp(reinterpret_cast<const char*>(m_slots[i].data), reinterpret_cast<const char*>(spare.data)) == 0)
+            {
+                spare.len = in_len;
+                m_slots[i].len = 0;
+                m_spare = i;
+                ++m_suppressed;
+                return true;
+            }
+        }
+
+        if (m_pending >= N)
+        {
+            ++m_dropped;
+            return false;
+        }
+
+        spare.len = in_len;
+        ++m_pending;
+        for (uint8_t i = 0; i <= N; ++i)
+        {
+            if (!m_slots[i].len)
+            {
+                m_spare = i;
+                break;
+            }
+        }
+        return true;
+    }
+
+    // True if messages are pending and the min interval elapsed since the last flush (overflow safe)
+    bool is_due(uint32_t in_now) const
+    {
+        return m_pending && (!m_flushed || in_now - m_last_flush >= m_min_interval);
+    }
+
+    // Write every pending message to in_p (e.g. between udp.beginPacket() and udp.endPacket()), returns how many
+    uint8_t flush(Print& in_p, uint32_t in_now)
+    {
+        if (!m_pending) return 0;
+
+        if (m_pending > 1)
+        {
+            uint8_t header[OSCBundleWriter::HEADER_SIZE];
+            OSCBundleWriter::write_header(header);
+            in_p.write(header, sizeof(header));
+        }
+
+        uint8_t sent = 0;
+        for (uint8_t i = 0; i <= N; ++i)
+        {
+            Slot& slot = m_slots[i];
+            if (!slot.len) continue;
+
+            if (m_pending > 1)
+            {
+                uint8_t size[4];
+                osc_write_be32(size, slot.len);
+                in_p.write(size, sizeof(size));
+            }
+            in_p.write(slot.data, slot.len);
+            slot.len = 0;
+            ++sent;
+        }
+
+        m_pending = 0;
+        m_sent += sent;
+        m_last_flush = in_now;
+        m_flushed = true;
+        return sent;
+    }
+
+    // Forget the pending messages without sending them
+    void clear()
+    {
+        for (uint8_t i = 0; i <= N; ++i)
+        {
+            if (i != m_spare) m_slots[i].len = 0;
+        }
+        m_pending = 0;
+    }
+
+    void set_min_interval(uint16_t in_min_interval) { m_min_interval = in_min_interval; }
+    void reset_stats()
+    {
+        m_suppressed = 0;
+        m_dropped = 0;
+        m_sent = 0;
+    }
+
+    // Accessors
+    uint8_t get_pending() const { return m_pending; }
+    uint32_t get_suppressed() const { return m_suppressed; }
+    uint32_t get_dropped() const { return m_dropped; }
+    uint32_t get_sent() const { return m_sent; }
 };
+// OSCOutbox (end)
 
 #endif // NBAPARK_H